@@ -71,6 +71,9 @@
             Create random points in a cap, or disc, centered at the
             input ra,dec location and with radius rad.
 
+        For random points in a footprint, see the random_footprint method
+        of esutil.htm.HTM
+
         rect_area(lon_min, lon_max, lat_min, lat_max)
             Calculate the area of a rectangle on the sphere.
 
@@ -103,6 +106,12 @@ try:
 except:
     have_numpy=False
 
+try:
+    from esutil.htm import htmc
+    have_htmc=True
+except:
+    have_htmc=False
+
 import math
 PI=math.pi
 HALFPI = PI/2.0
@@ -1064,12 +1073,25 @@ def _check_range(rng, allowed):
             raise ValueError("lon_range should be within [%s,%s]" % allowed)
     return rng
 
-def randsphere(num, ra_range=None, dec_range=None, system='eq'):
+def _get_rand_seed(seed):
+    if seed is None:
+        seed = numpy.random.randint(0, 2**31-1)
+    return int(seed)
+
+def _get_numpy_rng(seed, stream):
+    # for the numpy versions, when the htm extension is not available
+    if seed is None:
+        return numpy.random
+    return numpy.random.RandomState([int(seed), int(stream)])
+
+def randsphere(num, ra_range=None, dec_range=None, system='eq',
+               seed=None, stream=0, nthreads=1):
     """
     Generate random points on the sphere
 
     You can limit the range in ra and dec.  To generate on a spherical cap, see
-    randcap() 
+    randcap().  For a footprint defined by htm ids, see the random_footprint
+    method of esutil.htm.HTM
 
     parameters
     ----------
@@ -1081,6 +1103,15 @@ def randsphere(num, ra_range=None, dec_range=None, system='eq'):
         Should be within range [-90,90].  Default [-90,90]
     system: string
         Default is 'eq' for the ra-dec system.  Can also be 'xyz'.
+    seed: int, optional
+        Seed for the random number generator.  If None, a seed is drawn
+        from numpy.random
+    stream: int, optional
+        Stream of the generator.  Different streams with the same seed give
+        independent points, for example for different processes.  Default 0
+    nthreads: int, optional
+        Number of threads to use.  The points do not depend on nthreads.
+        Default 1
 
     output
     ------
@@ -1094,12 +1125,29 @@ def randsphere(num, ra_range=None, dec_range=None, system='eq'):
         ra,dec = randsphere(2000, ra_range=[10,35], dec_range=[-25,15])
         x,y,z = randsphere(2000, system='xyz')
 
+    The points are made in C++ and written directly into the outputs, with
+    a counter based generator.  If the htm extension is not available they
+    are made with numpy.random, and nthreads is ignored.
     """
 
     ra_range = _check_range(ra_range, [0.0,360.0])
     dec_range = _check_range(dec_range, [-90.0,90.0])
 
-    ra = numpy.random.random(num)
+    if have_htmc:
+        if system == 'xyz':
+            xyz=1
+        else:
+            xyz=0
+
+        return htmc.crandsphere(int(num),
+                                float(ra_range[0]), float(ra_range[1]),
+                                float(dec_range[0]), float(dec_range[1]),
+                                _get_rand_seed(seed), int(stream),
+                                int(nthreads), xyz)
+
+    rng = _get_numpy_rng(seed, stream)
+
+    ra = rng.random_sample(num)
     ra *= (ra_range[1]-ra_range[0])
     if ra_range[0] > 0:
         ra += ra_range[0]
@@ -1107,7 +1155,7 @@ def randsphere(num, ra_range=None, dec_range=None, system='eq'):
     # number [-1,1)
     cosdec_min = cos(deg2rad(90.0+dec_range[0]))
     cosdec_max = cos(deg2rad(90.0+dec_range[1]))
-    v = numpy.random.random(num)
+    v = rng.random_sample(num)
     v *= (cosdec_max-cosdec_min)
     v += cosdec_min
 
@@ -1126,7 +1174,8 @@ def randsphere(num, ra_range=None, dec_range=None, system='eq'):
     else:
         return ra, dec
 
-def randcap(nrand, ra, dec, rad, get_radius=False):
+def randcap(nrand, ra, dec, rad, get_radius=False,
+            seed=None, stream=0, nthreads=1):
     """
     Generate random points in a sherical cap
 
@@ -1143,16 +1192,29 @@ def randcap(nrand, ra, dec, rad, get_radius=False):
 
     get_radius: bool, optional
         if true, return radius of each point in radians
+    seed, stream, nthreads: optional
+        See randsphere for these keywords.
+
+    The points are uniform in area, with ra in [0,360).  For a single cap
+    they are made in C++.  If arrays of centers are sent, or the htm
+    extension is not available, the points are made in numpy and nthreads
+    is ignored.
     """
-    # generate uniformly in r**2
-    rand_r = numpy.random.random(nrand)
-    rand_r = sqrt(rand_r)*rad
+    if (have_htmc and numpy.isscalar(ra) and numpy.isscalar(dec)
+            and numpy.isscalar(rad)):
+        return htmc.crandcap(int(nrand), float(ra), float(dec), float(rad),
+                             _get_rand_seed(seed), int(stream), int(nthreads),
+                             int(bool(get_radius)))
+
+    rng = _get_numpy_rng(seed, stream)
 
-    # put in degrees
-    numpy.deg2rad(rand_r,rand_r)
+    # generate uniformly in area, which is uniform in cos(r)
+    cosrad = cos(deg2rad(rad))
+    cosr = 1.0 - rng.random_sample(nrand)*(1.0-cosrad)
+    rand_r = arccos(cosr)
 
     # generate position angle uniformly 0,2*PI
-    rand_posangle = numpy.random.random(nrand)*2*PI
+    rand_posangle = rng.random_sample(nrand)*2*PI
 
     theta = numpy.array(dec, dtype='f8',ndmin=1,copy=True)
     phi = numpy.array(ra,dtype='f8',ndmin=1,copy=True)
@@ -1167,7 +1229,6 @@ def randcap(nrand, ra, dec, rad, get_radius=False):
     cosphi = cos(phi)
 
     sinr = sin(rand_r)
-    cosr = cos(rand_r)
 
     cospsi = cos(rand_posangle)
     costheta2 = costheta*cosr + sintheta*sinr*cospsi
@@ -1188,7 +1249,7 @@ def randcap(nrand, ra, dec, rad, get_radius=False):
 
     numpy.rad2deg(phi2,phi2)
     numpy.rad2deg(theta2,theta2)
-    rand_ra  = phi2
+    rand_ra  = numpy.mod(phi2, 360.0)
     rand_dec = theta2-90.0
 
     if get_radius:
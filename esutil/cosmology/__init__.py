@@ -17,11 +17,16 @@ Cosmo:
     dV: Volume element.
     V:  Volume between two redshifts.
     distmod: Distance modulus.
+    z_of_Dc: Redshift at a given comoving distance.
+    z_of_V: Redshift enclosing a given comoving volume.
     sigmacritinv: Inverse critical density for lensing.
+    sigmacritinv_matrix: Inverse critical density for all lens-source pairs.
 
     Ez_inverse: Calculate 1/E(z)
     Ezinv_integral: Calculate the integral of 1/E(z) from zmin to zmax
 
+    make_table: Tabulate the 1/E(z) integral for fast distance calculations.
+
 
 """
 from . import cosmology
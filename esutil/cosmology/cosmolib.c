@@ -1,7 +1,19 @@
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "cosmolib.h"
 
+// The gauss-legendre points are the same for all cosmologies, so they are
+// calculated once and copied
+static double gl_x[NPTS], gl_w[NPTS], gl_vx[VNPTS], gl_vw[VNPTS];
+static pthread_once_t gl_once = PTHREAD_ONCE_INIT;
+
+static void gl_init(void) {
+    gauleg(-1.0,1.0, NPTS,  gl_x,  gl_w);
+    gauleg(-1.0,1.0, VNPTS, gl_vx, gl_vw);
+}
 
 struct cosmo* cosmo_new(
         double DH, 
@@ -32,12 +44,137 @@ struct cosmo* cosmo_new(
         }
     }
 
-    gauleg(-1.0,1.0, NPTS,  c->x,  c->w);
-    gauleg(-1.0,1.0, VNPTS, c->vx, c->vw);
+    pthread_once(&gl_once, gl_init);
+    memcpy(c->x,  gl_x,  sizeof(gl_x));
+    memcpy(c->w,  gl_w,  sizeof(gl_w));
+    memcpy(c->vx, gl_vx, sizeof(gl_vx));
+    memcpy(c->vw, gl_vw, sizeof(gl_vw));
 
     return c;
 }
 
+void cosmo_free(struct cosmo* c) {
+    if (c != NULL) {
+        cosmo_free_table(c);
+        free(c);
+    }
+}
+
+void cosmo_set_tol(struct cosmo* c, double tol) {
+    c->tol = (tol > 0) ? tol : 0;
+}
+
+void cosmo_free_table(struct cosmo* c) {
+    free(c->tab_int);
+    free(c->tab_ezinv);
+    c->tab_int=NULL;
+    c->tab_ezinv=NULL;
+    c->ntab=0;
+    c->tab_zmax=0;
+    c->tab_dz=0;
+    c->tab_err=0;
+}
+
+// the gauss-legendre integral, never using the table
+static double ez_inverse_integral_gl(struct cosmo* c, double zmin, double zmax);
+
+typedef double (*cosmo_func1)(struct cosmo* c, double z);
+static double gk_integral(struct cosmo* c, cosmo_func1 func,
+                          double zmin, double zmax);
+
+/*
+   Fill the table with ntab nodes on [0,zmax] and return the maximum error
+   of the interpolation.  For cubic hermite interpolation the error term is
+   proportional to t^2(1-t)^2 within each cell, so it peaks at the cell
+   midpoints where we compare to the direct integral.  The cells are small
+   so the gauss-legendre integrals are accurate to machine precision.
+*/
+static double fill_table(struct cosmo* c, size_t ntab, double zmax) {
+    size_t i;
+    double dz, z, zmid, interp, exact, err, maxerr=0;
+
+    dz = zmax/(ntab-1);
+    c->ntab = ntab;
+    c->tab_zmax = zmax;
+    c->tab_dz = dz;
+
+    c->tab_int[0] = 0.0;
+    c->tab_ezinv[0] = ez_inverse(c, 0.0);
+    for (i=1; i<ntab; i++) {
+        z = i*dz;
+        c->tab_int[i] = c->tab_int[i-1] + ez_inverse_integral_gl(c, z-dz, z);
+        c->tab_ezinv[i] = ez_inverse(c, z);
+    }
+
+    for (i=0; i<ntab-1; i++) {
+        zmid = (i+0.5)*dz;
+        interp = cosmo_table_eval(c, zmid);
+        exact = c->tab_int[i] + ez_inverse_integral_gl(c, i*dz, zmid);
+        err = fabs(interp-exact);
+        if (err > maxerr) {
+            maxerr = err;
+        }
+    }
+
+    return maxerr;
+}
+
+int cosmo_make_table(struct cosmo* c, double zmax, double tol) {
+    size_t ntab;
+    double err;
+
+    cosmo_free_table(c);
+
+    if (zmax <= 0 || tol <= 0) {
+        return 0;
+    }
+
+    // start with cells of width 0.01 and double the resolution until the
+    // tolerance is met
+    ntab = (size_t)(zmax/0.01) + 2;
+    while (ntab <= COSMO_MAX_NTAB) {
+        c->tab_int = (double*) malloc(ntab*sizeof(double));
+        c->tab_ezinv = (double*) malloc(ntab*sizeof(double));
+        if (c->tab_int == NULL || c->tab_ezinv == NULL) {
+            cosmo_free_table(c);
+            return 0;
+        }
+
+        err = fill_table(c, ntab, zmax);
+        if (err < tol) {
+            c->tab_err = err;
+            return 1;
+        }
+
+        cosmo_free_table(c);
+        ntab = 2*(ntab-1) + 1;
+    }
+
+    return 0;
+}
+
+double cosmo_table_eval(struct cosmo* c, double z) {
+    size_t i;
+    double u, t, t2, t3, h00, h10, h01, h11;
+
+    u = z/c->tab_dz;
+    i = (size_t) u;
+    if (i >= c->ntab-1) {
+        i = c->ntab-2;
+    }
+    t = u - i;
+    t2 = t*t;
+    t3 = t2*t;
+
+    h00 =  2*t3 - 3*t2 + 1;
+    h10 =    t3 - 2*t2 + t;
+    h01 = -2*t3 + 3*t2;
+    h11 =    t3 -   t2;
+
+    return h00*c->tab_int[i] + h01*c->tab_int[i+1]
+        + c->tab_dz*(h10*c->tab_ezinv[i] + h11*c->tab_ezinv[i+1]);
+}
+
 
 /* comoving distance in Mpc */
 double Dc(struct cosmo* c, double zmin, double zmax) {
@@ -104,6 +241,10 @@ double V(struct cosmo* c, double zmin, double zmax) {
     double dv;
     double v=0;
 
+    if (c->tol > 0) {
+        return gk_integral(c, dV, zmin, zmax)*4.*M_PI;
+    }
+
     f1 = (zmax-zmin)/2.;
     f2 = (zmax+zmin)/2.;
 
@@ -134,6 +275,431 @@ double scinv(struct cosmo* c, double zl, double zs) {
 
 
 
+
+/*
+   Threading.  The threads share a counter which is the start of the next
+   chunk to be processed; each thread takes the next chunk under the lock
+   until the data are exhausted.  Chunks keep the threads busy even when the
+   cost per element varies, e.g. for scinv where zs <= zl returns
+   immediately.
+*/
+
+struct chunk_sched {
+    size_t n;
+    size_t chunksize;
+    size_t next;
+    pthread_mutex_t lock;
+};
+
+static int chunk_sched_next(struct chunk_sched* sched, size_t* start, size_t* end) {
+    int have=0;
+
+    pthread_mutex_lock(&sched->lock);
+    if (sched->next < sched->n) {
+        *start = sched->next;
+        *end = sched->next + sched->chunksize;
+        if (*end > sched->n) {
+            *end = sched->n;
+        }
+        sched->next = *end;
+        have=1;
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return have;
+}
+
+int cosmo_nproc(void) {
+    long nproc=1;
+#ifdef _SC_NPROCESSORS_ONLN
+    nproc = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (nproc < 1) {
+        nproc=1;
+    }
+    return (int) nproc;
+}
+
+/*
+   Run worker(arg) in nthreads threads, including the calling thread.  The
+   worker should pull work from sched until it is exhausted, so if threads
+   cannot be created the work is still completed; in that case zero is
+   returned.
+*/
+static int run_threads(void* (*worker)(void*), void* arg,
+                       struct chunk_sched* sched,
+                       size_t n, size_t chunksize, int nthreads) {
+    pthread_t* threads=NULL;
+    size_t nchunk;
+    int i, ncreated=0, status=1;
+
+    sched->n=n;
+    sched->chunksize=chunksize;
+    sched->next=0;
+
+    if (nthreads <= 0) {
+        nthreads = cosmo_nproc();
+    }
+    // no point in more threads than chunks
+    nchunk = (n + chunksize - 1)/chunksize;
+    if ((size_t)nthreads > nchunk) {
+        nthreads = (int) nchunk;
+    }
+
+    pthread_mutex_init(&sched->lock, NULL);
+
+    // the calling thread also does work, so we create nthreads-1
+    if (nthreads > 1) {
+        threads = (pthread_t*) malloc((nthreads-1)*sizeof(pthread_t));
+        if (threads == NULL) {
+            status=0;
+        } else {
+            for (i=0; i<nthreads-1; i++) {
+                if (pthread_create(&threads[i], NULL, worker, arg) != 0) {
+                    status=0;
+                    break;
+                }
+                ncreated++;
+            }
+        }
+    }
+
+    worker(arg);
+
+    for (i=0; i<ncreated; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&sched->lock);
+    return status;
+}
+
+struct vec_job {
+    struct cosmo* c;
+    cosmo_func2 func;
+    const double* z1;
+    int z1_is_array;
+    const double* z2;
+    int z2_is_array;
+    double* res;
+
+    struct chunk_sched sched;
+};
+
+static void* vec_job_run(void* arg) {
+    struct vec_job* job = (struct vec_job*) arg;
+    size_t i, start, end;
+    double z1, z2;
+
+    z1 = job->z1[0];
+    z2 = job->z2[0];
+    while (chunk_sched_next(&job->sched, &start, &end)) {
+        for (i=start; i<end; i++) {
+            if (job->z1_is_array) {
+                z1 = job->z1[i];
+            }
+            if (job->z2_is_array) {
+                z2 = job->z2[i];
+            }
+            job->res[i] = job->func(job->c, z1, z2);
+        }
+    }
+    return NULL;
+}
+
+int cosmo_vec_eval(struct cosmo* c,
+                   cosmo_func2 func,
+                   const double* z1, int z1_is_array,
+                   const double* z2, int z2_is_array,
+                   double* res,
+                   size_t n,
+                   int nthreads) {
+    struct vec_job job;
+
+    if (n == 0) {
+        return 1;
+    }
+
+    job.c=c;
+    job.func=func;
+    job.z1=z1;
+    job.z1_is_array=z1_is_array;
+    job.z2=z2;
+    job.z2_is_array=z2_is_array;
+    job.res=res;
+
+    return run_threads(vec_job_run, &job, &job.sched,
+                       n, COSMO_VEC_CHUNK, nthreads);
+}
+
+/*
+   Matrix of scinv values.
+
+   With chi = Dc(0,z)/DH and k = sqrt(|omega_k|), the transverse comoving
+   distance is Dm = DH*sinn(k*chi)/k.  Because Dc is additive, the addition
+   formula for sinn gives
+
+       Dm(zl,zs) = Dm(0,zs)*cosn(k*chi_l) - Dm(0,zl)*cosn(k*chi_s)
+
+   where sinn,cosn are sinh,cosh for omega_k > 0, sin,cos for omega_k < 0,
+   and cosn=1 for flat.  This is equivalent to Hogg eq. 19 but also holds
+   for closed universes.  The factors of 1+zs cancel in scinv, so
+
+       scinv = 4 pi G/c^2 * Dm_l/(1+zl) * (cosn_l - Dm_l*cosn_s/Dm_s)
+
+   and only one integral is needed per redshift.
+*/
+
+void cosmo_dm_cosn(struct cosmo* c, double dc, double* dm, double* cosn) {
+    double x;
+    if (c->flat) {
+        *dm = dc;
+        *cosn = 1.0;
+    } else {
+        x = dc*c->tcfac;
+        if (c->omega_k > 0) {
+            *dm = sinh(x)/c->tcfac;
+            *cosn = cosh(x);
+        } else {
+            *dm = sin(x)/c->tcfac;
+            *cosn = cos(x);
+        }
+    }
+}
+
+struct scinv_matrix_job {
+    const double* zl;
+    size_t nl;
+    const double* zs;
+    size_t ns;
+
+    // per lens
+    const double* lfac; // 4 pi G/c^2 Dm_l/(1+zl)
+    const double* ldm;
+    const double* lcosn;
+
+    // per source, cosn_s/Dm_s
+    const double* sratio;
+
+    double* res;
+
+    struct chunk_sched sched;
+};
+
+static void* scinv_matrix_job_run(void* arg) {
+    struct scinv_matrix_job* job = (struct scinv_matrix_job*) arg;
+    size_t il, is, start, end;
+    double zl, lfac, ldm, lcosn;
+    double* row;
+
+    while (chunk_sched_next(&job->sched, &start, &end)) {
+        for (il=0; il<job->nl; il++) {
+            zl = job->zl[il];
+            lfac = job->lfac[il];
+            ldm = job->ldm[il];
+            lcosn = job->lcosn[il];
+            row = job->res + il*job->ns;
+
+            for (is=start; is<end; is++) {
+                if (job->zs[is] <= zl) {
+                    row[is] = 0.0;
+                } else {
+                    row[is] = lfac*(lcosn - ldm*job->sratio[is]);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+int scinv_matrix(struct cosmo* c,
+                 const double* zl, size_t nl,
+                 const double* zs, size_t ns,
+                 double* res,
+                 int nthreads) {
+    struct scinv_matrix_job job;
+    double *work=NULL, *lfac, *ldm, *lcosn, *sratio, dm, cosn, zero=0;
+    size_t i;
+
+    if (nl == 0 || ns == 0) {
+        return 1;
+    }
+
+    work = (double*) malloc((3*nl + ns)*sizeof(double));
+    if (work == NULL) {
+        return 0;
+    }
+    lfac = work;
+    ldm = lfac + nl;
+    lcosn = ldm + nl;
+    sratio = lcosn + nl;
+
+    // comoving distances, one integral per redshift
+    cosmo_vec_eval(c, Dc, &zero, 0, zl, 1, ldm, nl, nthreads);
+    cosmo_vec_eval(c, Dc, &zero, 0, zs, 1, sratio, ns, nthreads);
+
+    for (i=0; i<nl; i++) {
+        cosmo_dm_cosn(c, ldm[i], &ldm[i], &lcosn[i]);
+        lfac[i] = FOUR_PI_G_OVER_C_SQUARED*ldm[i]/(1.+zl[i]);
+    }
+    for (i=0; i<ns; i++) {
+        cosmo_dm_cosn(c, sratio[i], &dm, &cosn);
+        // only used when zs > zl >= 0, where dm > 0
+        sratio[i] = (dm != 0) ? cosn/dm : 0;
+    }
+
+    job.zl=zl;
+    job.nl=nl;
+    job.zs=zs;
+    job.ns=ns;
+    job.lfac=lfac;
+    job.ldm=ldm;
+    job.lcosn=lcosn;
+    job.sratio=sratio;
+    job.res=res;
+
+    run_threads(scinv_matrix_job_run, &job, &job.sched,
+                ns, COSMO_VEC_CHUNK, nthreads);
+
+    free(work);
+    return 1;
+}
+
+/*
+   Inverse functions.
+
+   The fixed gauss-legendre integrals are not monotone in z over wide
+   intervals, e.g. the 5 point Dc(0,z) turns over near z=33, so they cannot
+   be inverted.  We instead invert the adaptive gauss-kronrod integrals, or
+   the table where it covers z; both increase monotonically from f(0)=0 to
+   within their tolerance.  A bracket [lo,hi] is kept around the root and we
+   fall back to bisection if a newton step would leave it.
+*/
+
+// Copy of the cosmology that integrates adaptively.  The table, if any, is
+// shared; it is only read
+static void inv_cosmo(struct cosmo* c, struct cosmo* ci) {
+    *ci = *c;
+    if (ci->tol <= 0) {
+        ci->tol = COSMO_INV_GKTOL;
+    }
+}
+
+static double Dc0(struct cosmo* c, double z) {
+    return Dc(c, 0.0, z);
+}
+static double dDc0(struct cosmo* c, double z) {
+    return c->DH*ez_inverse(c, z);
+}
+static double V0(struct cosmo* c, double z) {
+    return V(c, 0.0, z);
+}
+static double dV0(struct cosmo* c, double z) {
+    return 4.*M_PI*dV(c, z);
+}
+
+static double invert_monotone(struct cosmo* c,
+                              cosmo_func1 func,
+                              cosmo_func1 deriv,
+                              double target,
+                              double z) {
+    int iter;
+    double lo=0, hi=-1, diff, fp, znew;
+
+    if (!(z >= 0)) {
+        z = 1.0;
+    }
+
+    for (iter=0; iter<COSMO_INV_MAXIT; iter++) {
+        diff = func(c, z) - target;
+        if (isnan(diff)) {
+            return NAN;
+        } else if (fabs(diff) <= COSMO_INV_TOL*target) {
+            break;
+        } else if (diff < 0) {
+            lo = z;
+        } else {
+            hi = z;
+        }
+
+        fp = deriv(c, z);
+        znew = z - diff/fp;
+        if (znew <= lo || (hi >= 0 && znew >= hi) || !(fp > 0)) {
+            znew = (hi >= 0) ? 0.5*(lo+hi) : 2*z + 1;
+        }
+
+        if (hi < 0 && znew > COSMO_INV_ZMAX) {
+            if (lo >= COSMO_INV_ZMAX) {
+                return NAN;
+            }
+            znew = COSMO_INV_ZMAX;
+        }
+
+        if (fabs(znew-z) <= COSMO_INV_TOL*(1.+znew)) {
+            z = znew;
+            break;
+        }
+        z = znew;
+    }
+
+    return z;
+}
+
+// initial guess for z_of_Dc
+static double z_of_Dc_guess(struct cosmo* c, double dc) {
+    size_t lo, hi, mid;
+    double x, x1, x2;
+
+    x = dc/c->DH;
+    if (c->ntab == 0 || x >= c->tab_int[c->ntab-1]) {
+        // 1/E(z) <= 1 so this is a lower bound for normal cosmologies
+        return x;
+    }
+
+    // binary search the table, which is monotonic
+    lo=0;
+    hi=c->ntab-1;
+    while (hi-lo > 1) {
+        mid = (lo+hi)/2;
+        if (c->tab_int[mid] > x) {
+            hi=mid;
+        } else {
+            lo=mid;
+        }
+    }
+
+    x1 = c->tab_int[lo];
+    x2 = c->tab_int[hi];
+    return c->tab_dz*(lo + (x-x1)/(x2-x1));
+}
+
+double z_of_Dc(struct cosmo* c, double dc) {
+    struct cosmo ci;
+    if (dc <= 0) {
+        return 0.0;
+    }
+    inv_cosmo(c, &ci);
+    return invert_monotone(&ci, Dc0, dDc0, dc, z_of_Dc_guess(c, dc));
+}
+
+double z_of_V(struct cosmo* c, double v) {
+    struct cosmo ci;
+    double dc, z;
+    if (v <= 0) {
+        return 0.0;
+    }
+    // euclidean guess, exact in the flat case for small z.  Large volumes
+    // can put dc beyond the horizon, in which case z is NaN and
+    // invert_monotone starts from z=1 instead
+    dc = cbrt(3.*v/(4.*M_PI));
+    z = z_of_Dc(c, dc);
+
+    inv_cosmo(c, &ci);
+    return invert_monotone(&ci, V0, dV0, v, z);
+}
+
+
 double ez_inverse(struct cosmo* c, double z) {
     double oneplusz, oneplusz2;
     double ezi;
@@ -151,6 +717,18 @@ double ez_inverse(struct cosmo* c, double z) {
 
 
 double ez_inverse_integral(struct cosmo* c, double zmin, double zmax) {
+    if (c->ntab > 0
+            && zmin >= 0 && zmin <= c->tab_zmax
+            && zmax >= 0 && zmax <= c->tab_zmax) {
+        return cosmo_table_eval(c, zmax) - cosmo_table_eval(c, zmin);
+    }
+    if (c->tol > 0) {
+        return gk_integral(c, ez_inverse, zmin, zmax);
+    }
+    return ez_inverse_integral_gl(c, zmin, zmax);
+}
+
+static double ez_inverse_integral_gl(struct cosmo* c, double zmin, double zmax) {
     int i;
     double f1, f2, z, ezinv_int=0, ezinv;
 
@@ -170,6 +748,100 @@ double ez_inverse_integral(struct cosmo* c, double zmin, double zmax) {
 
 }
 
+/*
+   Adaptive gauss-kronrod integration.
+
+   Each interval is integrated with the 15 point kronrod rule, and the
+   difference from the embedded 7 point gauss rule is used as the error
+   estimate.  This estimate is conservative: the kronrod result is typically
+   far more accurate.  Intervals are bisected until the error is below the
+   tolerance, so smooth integrals over short intervals cost a single 15
+   point evaluation, and only wide or high redshift intervals are refined.
+
+   The nodes and weights are from QUADPACK qk15.
+*/
+
+static const double gk15_x[8] = {
+    0.991455371120812639206854697526329,
+    0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926,
+    0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013,
+    0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245,
+    0.000000000000000000000000000000000
+};
+static const double gk15_wk[8] = {
+    0.022935322010529224963732008058970,
+    0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518,
+    0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550,
+    0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649,
+    0.209482141084727828012999174891714
+};
+// gauss weights for the odd kronrod nodes, last is the center
+static const double gk15_wg[4] = {
+    0.129484966168869693270611432679082,
+    0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975,
+    0.417959183673469387755102040816327
+};
+
+static double gk15(struct cosmo* c, cosmo_func1 func,
+                   double a, double b, double* err) {
+    int i;
+    double f1, f2, center, hlength, fc, fsum, resk, resg;
+
+    center = 0.5*(a+b);
+    hlength = 0.5*(b-a);
+
+    fc = func(c, center);
+    resk = fc*gk15_wk[7];
+    resg = fc*gk15_wg[3];
+    for (i=0; i<7; i++) {
+        f1 = func(c, center - hlength*gk15_x[i]);
+        f2 = func(c, center + hlength*gk15_x[i]);
+        fsum = f1+f2;
+        resk += gk15_wk[i]*fsum;
+        if (i % 2 == 1) {
+            resg += gk15_wg[i/2]*fsum;
+        }
+    }
+
+    resk *= hlength;
+    resg *= hlength;
+    *err = fabs(resk-resg);
+    return resk;
+}
+
+static double gk_adapt(struct cosmo* c, cosmo_func1 func,
+                       double a, double b,
+                       double res, double err,
+                       double abstol, int depth) {
+    double m, res1, res2, err1, err2;
+
+    if (err <= abstol || depth >= COSMO_GK_MAXDEPTH) {
+        return res;
+    }
+
+    m = 0.5*(a+b);
+    res1 = gk15(c, func, a, m, &err1);
+    res2 = gk15(c, func, m, b, &err2);
+
+    return gk_adapt(c, func, a, m, res1, err1, 0.5*abstol, depth+1)
+         + gk_adapt(c, func, m, b, res2, err2, 0.5*abstol, depth+1);
+}
+
+static double gk_integral(struct cosmo* c, cosmo_func1 func,
+                          double zmin, double zmax) {
+    double res, err;
+
+    res = gk15(c, func, zmin, zmax, &err);
+    return gk_adapt(c, func, zmin, zmax, res, err, c->tol*fabs(res), 0);
+}
+
 void gauleg(double x1, double x2, int npts, double* x, double* w) {
 	int i, j, m;
 	double xm, xl, z1, z, p1, p2, p3, pp=0, EPS, abszdiff;
@@ -3,6 +3,18 @@
 
 #define NPTS 5
 #define VNPTS 10
+#define COSMO_MAX_NTAB 10000000
+// number of elements handed to a thread at a time in cosmo_vec_eval
+#define COSMO_VEC_CHUNK 4096
+// convergence and iteration limit for the inverse functions
+#define COSMO_INV_TOL 1.0e-13
+#define COSMO_INV_MAXIT 100
+#define COSMO_INV_ZMAX 1.0e4
+// relative tolerance of the integrals used by the inverse functions when
+// no tolerance is set
+#define COSMO_INV_GKTOL 1.0e-12
+// maximum interval bisections for adaptive integration
+#define COSMO_GK_MAXDEPTH 30
 #define FOUR_PI_G_OVER_C_SQUARED 6.0150504541630152e-07
 #define CLIGHT 2.99792458e5
 
@@ -17,11 +29,25 @@ struct cosmo {
     // this is sqrt(abs(omega_k))/DH
     double tcfac;
 
+    // relative tolerance for adaptive gauss-kronrod integration.  If zero,
+    // the fixed NPTS and VNPTS gauss-legendre integrations are used
+    double tol;
+
     double x[NPTS];
     double w[NPTS];
 
     double vx[VNPTS];
     double vw[VNPTS];
+
+    // optional table of the 1/E(z) integral from 0 to z on a uniform grid,
+    // interpolated with cubic hermite splines using the exact derivative
+    // 1/E(z).  Only used when ntab > 0, see cosmo_make_table
+    size_t ntab;
+    double tab_zmax;
+    double tab_dz;
+    double tab_err; // max interpolation error, measured at cell midpoints
+    double* tab_int;
+    double* tab_ezinv;
 };
 
 struct cosmo* cosmo_new(
@@ -31,6 +57,23 @@ struct cosmo* cosmo_new(
         double omega_l,
         double omega_k);
 
+void cosmo_free(struct cosmo* c);
+
+// Set the relative tolerance for adaptive integration, 0 to use the fixed
+// gauss-legendre integrations.  The table, if present, takes precedence
+void cosmo_set_tol(struct cosmo* c, double tol);
+
+// Tabulate the 1/E(z) integral on [0,zmax].  The grid is refined until the
+// interpolation error at the midpoints is less than tol, an absolute bound
+// in units of the hubble distance.  Distances are differences of two table
+// values, so may be off by 2*tol.
+// Returns 1 on success, 0 on allocation failure or if tol cannot be reached.
+int cosmo_make_table(struct cosmo* c, double zmax, double tol);
+void cosmo_free_table(struct cosmo* c);
+
+// evaluate the table; z must be in [0,tab_zmax]
+double cosmo_table_eval(struct cosmo* c, double z);
+
 double ez_inverse(struct cosmo* c, double z);
 double ez_inverse_integral(struct cosmo* c, double zmin, double zmax);
 
@@ -55,6 +98,69 @@ double V(struct cosmo* c, double zmin, double zmax);
 // inverse critical density for lensing
 double scinv(struct cosmo* c, double zl, double zs);
 
+/*
+   Inverse functions: the redshift z such that Dc(0,z)=dc or V(0,z)=v.  These
+   use safeguarded newton iterations, started from the table if one exists.
+
+   The fixed gauss-legendre integrals are not monotone over wide intervals,
+   so the inversion always uses the table, where it covers z, or adaptive
+   integration with the tolerance set by cosmo_set_tol, or COSMO_INV_GKTOL if
+   none is set.  With a tolerance or a table covering z the results are
+   consistent with the forward functions to that precision.  Without them
+   they invert the accurate distances, which differ from the fixed
+   integrations at high redshift.
+
+   Inputs <= 0 give z=0.  NaN is returned for inputs that would require
+   z > COSMO_INV_ZMAX, e.g. beyond the horizon, and for NaN inputs.
+*/
+double z_of_Dc(struct cosmo* c, double dc);
+double z_of_V(struct cosmo* c, double v);
+
+// signature shared by Dc, Dm, Da, Dl and scinv
+typedef double (*cosmo_func2)(struct cosmo* c, double z1, double z2);
+
+/*
+   Evaluate func for n pairs of redshifts, writing into res.  If z1_is_array
+   is zero then z1[0] is used for all elements, likewise for z2.  The work is
+   split into chunks of COSMO_VEC_CHUNK elements which are handed out to
+   nthreads threads as they become free.  If nthreads <= 0 the number of
+   online processors is used.
+
+   The cosmo struct is only read, but it must not be modified, e.g. with
+   cosmo_make_table, while this is running.
+
+   Returns 1 on success, 0 if threads could not be created; in that case the
+   remaining work is still done in the calling thread.
+*/
+int cosmo_vec_eval(struct cosmo* c,
+                   cosmo_func2 func,
+                   const double* z1, int z1_is_array,
+                   const double* z2, int z2_is_array,
+                   double* res,
+                   size_t n,
+                   int nthreads);
+
+/*
+   Inverse critical density for all pairs of lens and source redshifts,
+   written into res as a dense nl x ns row-major matrix.  Distances are
+   calculated once per redshift, so the integration cost is O(nl+ns) rather
+   than O(nl*ns).  For very large ns, call with blocks of sources.
+
+   Returns 1 on success, 0 on allocation failure.
+*/
+int scinv_matrix(struct cosmo* c,
+                 const double* zl, size_t nl,
+                 const double* zs, size_t ns,
+                 double* res,
+                 int nthreads);
+
+// transverse comoving distance and the corresponding cosine-like factor
+// cosn(sqrt(|omega_k|)*dc/DH) for comoving distance dc from z=0
+void cosmo_dm_cosn(struct cosmo* c, double dc, double* dm, double* cosn);
+
+// get the number of online processors, at least 1
+int cosmo_nproc(void);
+
 // generate gauss-legendre abcissa and weights
 void gauleg(double x1, double x2, int npts, double* x, double* w);
 
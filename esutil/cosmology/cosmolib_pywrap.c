@@ -31,14 +31,29 @@
 struct PyCosmoObject {
   PyObject_HEAD
   struct cosmo* cosmo;
+  int nthreads; // threads for the vectorized functions, <= 0 means all
+  // number of calculations running with the GIL released.  The cosmo
+  // struct must not be changed or freed while this is nonzero
+  int busy;
 };
 
+static int
+PyCosmoObject_check_busy(struct PyCosmoObject* self) {
+    if (self->busy > 0) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "Cannot modify the cosmology while a calculation "
+                        "is running in another thread");
+        return 1;
+    }
+    return 0;
+}
+
 
 
 static void
 PyCosmoObject_dealloc(struct PyCosmoObject* self)
 {
-    free(self->cosmo);
+    cosmo_free(self->cosmo);
     self->ob_type->tp_free((PyObject*)self);
 }
 
@@ -50,7 +65,11 @@ PyCosmoObject_init(struct PyCosmoObject* self, PyObject *args, PyObject *kwds)
     int flat;
     double omega_m, omega_l, omega_k;
 
-    free(self->cosmo);
+    if (PyCosmoObject_check_busy(self)) {
+        return -1;
+    }
+    cosmo_free(self->cosmo);
+    self->cosmo=NULL;
 
     if (!PyArg_ParseTuple(args, 
                           (char*)"diddd", 
@@ -59,6 +78,8 @@ PyCosmoObject_init(struct PyCosmoObject* self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    self->nthreads=1;
+
     self->cosmo = cosmo_new(DH, flat, omega_m, omega_l, omega_k);
     if (self->cosmo == NULL) {
         PyErr_SetString(PyExc_MemoryError, "Failed to allocate struct cosmo");
@@ -103,13 +124,154 @@ static PyObject* PyCosmoObject_omega_k(struct PyCosmoObject* self) {
     return PyFloat_FromDouble(self->cosmo->omega_k);
 }
 
+static PyObject* PyCosmoObject_tol(struct PyCosmoObject* self) {
+    return PyFloat_FromDouble(self->cosmo->tol);
+}
+static PyObject*
+PyCosmoObject_set_tol(struct PyCosmoObject* self, PyObject* args) {
+    double tol;
+
+    if (!PyArg_ParseTuple(args, (char*)"d", &tol)) {
+        return NULL;
+    }
+    if (PyCosmoObject_check_busy(self)) {
+        return NULL;
+    }
+
+    cosmo_set_tol(self->cosmo, tol);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject*
+PyCosmoObject_make_table(struct PyCosmoObject* self, PyObject* args) {
+    double zmax, tol;
+
+    if (!PyArg_ParseTuple(args, (char*)"dd", &zmax, &tol)) {
+        return NULL;
+    }
+    if (PyCosmoObject_check_busy(self)) {
+        return NULL;
+    }
+
+    if (!cosmo_make_table(self->cosmo, zmax, tol)) {
+        PyErr_Format(PyExc_ValueError,
+                     "Failed to make table for zmax=%g tol=%g", zmax, tol);
+        return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+static PyObject*
+PyCosmoObject_free_table(struct PyCosmoObject* self) {
+    if (PyCosmoObject_check_busy(self)) {
+        return NULL;
+    }
+    cosmo_free_table(self->cosmo);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+static PyObject*
+PyCosmoObject_table_info(struct PyCosmoObject* self) {
+    return Py_BuildValue("(ldd)",
+                         (long)self->cosmo->ntab,
+                         self->cosmo->tab_zmax,
+                         self->cosmo->tab_err);
+}
+
+static PyObject* PyCosmoObject_nthreads(struct PyCosmoObject* self) {
+    return PyInt_FromLong(self->nthreads);
+}
+static PyObject*
+PyCosmoObject_set_nthreads(struct PyCosmoObject* self, PyObject* args) {
+    int nthreads;
+
+    if (!PyArg_ParseTuple(args, (char*)"i", &nthreads)) {
+        return NULL;
+    }
+
+    self->nthreads=nthreads;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 /*
    The wrapper methods and vectorizations.
 
    For the array inputs, the caller is responsible for making sure the input is
    an array, contiguous, of the right data type.  That is much more easily
    done in the python wrapper.
+
+   All vectorized versions go through PyCosmoObject_vec_eval, which releases
+   the GIL and splits the work over self->nthreads threads.  self->busy is
+   held while the GIL is released, so that set_tol, make_table, free_table
+   and init from other python threads raise rather than change the struct
+   being read.
+*/
+
+// adapters for the single argument functions
+static double ez_inverse_func2(struct cosmo* c, double z, double unused) {
+    (void) unused;
+    return ez_inverse(c, z);
+}
+static double dV_func2(struct cosmo* c, double z, double unused) {
+    (void) unused;
+    return dV(c, z);
+}
+static double z_of_Dc_func2(struct cosmo* c, double dc, double unused) {
+    (void) unused;
+    return z_of_Dc(c, dc);
+}
+static double z_of_V_func2(struct cosmo* c, double v, double unused) {
+    (void) unused;
+    return z_of_V(c, v);
+}
+
+/*
+   Evaluate func for the inputs.  If z1Obj is NULL the scalar z1 is used for
+   all elements, likewise for z2.  At least one must be an array, and if both
+   are arrays they must be the same size.
 */
+static PyObject*
+PyCosmoObject_vec_eval(struct PyCosmoObject* self,
+                       cosmo_func2 func,
+                       PyObject* z1Obj, double z1,
+                       PyObject* z2Obj, double z2) {
+    PyObject* resObj=NULL;
+    const double *z1ptr=&z1, *z2ptr=&z2;
+    double* res;
+    npy_intp n;
+
+    if (z1Obj != NULL) {
+        n = PyArray_SIZE(z1Obj);
+        z1ptr = (const double* )PyArray_DATA(z1Obj);
+    } else {
+        n = PyArray_SIZE(z2Obj);
+    }
+    if (z2Obj != NULL) {
+        z2ptr = (const double* )PyArray_DATA(z2Obj);
+    }
+
+    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
+    if (resObj == NULL) {
+        return NULL;
+    }
+    res = (double* )PyArray_DATA(resObj);
+
+    self->busy++;
+    Py_BEGIN_ALLOW_THREADS
+    cosmo_vec_eval(self->cosmo, func,
+                   z1ptr, z1Obj != NULL,
+                   z2ptr, z2Obj != NULL,
+                   res, (size_t) n, self->nthreads);
+    Py_END_ALLOW_THREADS
+    self->busy--;
+
+    return resObj;
+}
 
 
 static PyObject*
@@ -126,26 +288,13 @@ PyCosmoObject_ez_inverse(struct PyCosmoObject* self, PyObject* args) {
 }
 static PyObject*
 PyCosmoObject_ez_inverse_vec(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zObj=NULL, *resObj=NULL;;
-    double *z, *res;
-    npy_intp n, i;
+    PyObject* zObj=NULL;
 
     if (!PyArg_ParseTuple(args, (char*)"O", &zObj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zObj);
-    z = (double* )PyArray_DATA(zObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = ez_inverse(self->cosmo, z[i]);
-    }
-
-    return resObj;
-
+    return PyCosmoObject_vec_eval(self, ez_inverse_func2, zObj, 0.0, NULL, 0.0);
 }
 
 
@@ -184,73 +333,37 @@ PyCosmoObject_Dc(struct PyCosmoObject* self, PyObject* args) {
 
 static PyObject*
 PyCosmoObject_Dc_vec1(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zminObj=NULL, *resObj=NULL;;
-    double *zmin, zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL;
+    double z2;
 
-    if (!PyArg_ParseTuple(args, (char*)"Od", &zminObj, &zmax)) {
+    if (!PyArg_ParseTuple(args, (char*)"Od", &z1Obj, &z2)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = self->cosmo->DH*ez_inverse_integral(self->cosmo, zmin[i], zmax); 
-    }
-
-    return resObj;
-
+    return PyCosmoObject_vec_eval(self, Dc, z1Obj, 0.0, NULL, z2);
 }
 
 static PyObject*
 PyCosmoObject_Dc_vec2(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj=NULL, *resObj=NULL;;
-    double zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z2Obj=NULL;
+    double z1;
 
-    if (!PyArg_ParseTuple(args, (char*)"dO", &zmin, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"dO", &z1, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zmaxObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = self->cosmo->DH*ez_inverse_integral(self->cosmo, zmin, zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Dc, NULL, z1, z2Obj, 0.0);
 }
 
 static PyObject*
 PyCosmoObject_Dc_2vec(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj, *zminObj=NULL, *resObj=NULL;
-    double *zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL, *z2Obj=NULL;
 
-    if (!PyArg_ParseTuple(args, (char*)"OO", &zminObj, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"OO", &z1Obj, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = self->cosmo->DH*ez_inverse_integral(self->cosmo, zmin[i], zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Dc, z1Obj, 0.0, z2Obj, 0.0);
 }
 
 // transverse comoving distance and vectorizations
@@ -270,73 +383,37 @@ PyCosmoObject_Dm(struct PyCosmoObject* self, PyObject* args) {
 
 static PyObject*
 PyCosmoObject_Dm_vec1(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zminObj=NULL, *resObj=NULL;;
-    double *zmin, zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL;
+    double z2;
 
-    if (!PyArg_ParseTuple(args, (char*)"Od", &zminObj, &zmax)) {
+    if (!PyArg_ParseTuple(args, (char*)"Od", &z1Obj, &z2)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Dm(self->cosmo, zmin[i], zmax); 
-    }
-
-    return resObj;
-
+    return PyCosmoObject_vec_eval(self, Dm, z1Obj, 0.0, NULL, z2);
 }
 
 static PyObject*
 PyCosmoObject_Dm_vec2(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj=NULL, *resObj=NULL;;
-    double zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z2Obj=NULL;
+    double z1;
 
-    if (!PyArg_ParseTuple(args, (char*)"dO", &zmin, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"dO", &z1, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zmaxObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Dm(self->cosmo, zmin, zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Dm, NULL, z1, z2Obj, 0.0);
 }
 
 static PyObject*
 PyCosmoObject_Dm_2vec(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj, *zminObj=NULL, *resObj=NULL;
-    double *zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL, *z2Obj=NULL;
 
-    if (!PyArg_ParseTuple(args, (char*)"OO", &zminObj, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"OO", &z1Obj, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Dm(self->cosmo, zmin[i], zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Dm, z1Obj, 0.0, z2Obj, 0.0);
 }
 
 
@@ -357,73 +434,37 @@ PyCosmoObject_Da(struct PyCosmoObject* self, PyObject* args) {
 
 static PyObject*
 PyCosmoObject_Da_vec1(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zminObj=NULL, *resObj=NULL;;
-    double *zmin, zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL;
+    double z2;
 
-    if (!PyArg_ParseTuple(args, (char*)"Od", &zminObj, &zmax)) {
+    if (!PyArg_ParseTuple(args, (char*)"Od", &z1Obj, &z2)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Da(self->cosmo, zmin[i], zmax); 
-    }
-
-    return resObj;
-
+    return PyCosmoObject_vec_eval(self, Da, z1Obj, 0.0, NULL, z2);
 }
 
 static PyObject*
 PyCosmoObject_Da_vec2(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj=NULL, *resObj=NULL;;
-    double zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z2Obj=NULL;
+    double z1;
 
-    if (!PyArg_ParseTuple(args, (char*)"dO", &zmin, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"dO", &z1, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zmaxObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Da(self->cosmo, zmin, zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Da, NULL, z1, z2Obj, 0.0);
 }
 
 static PyObject*
 PyCosmoObject_Da_2vec(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj, *zminObj=NULL, *resObj=NULL;
-    double *zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL, *z2Obj=NULL;
 
-    if (!PyArg_ParseTuple(args, (char*)"OO", &zminObj, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"OO", &z1Obj, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Da(self->cosmo, zmin[i], zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Da, z1Obj, 0.0, z2Obj, 0.0);
 }
 
 
@@ -444,73 +485,37 @@ PyCosmoObject_Dl(struct PyCosmoObject* self, PyObject* args) {
 
 static PyObject*
 PyCosmoObject_Dl_vec1(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zminObj=NULL, *resObj=NULL;;
-    double *zmin, zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL;
+    double z2;
 
-    if (!PyArg_ParseTuple(args, (char*)"Od", &zminObj, &zmax)) {
+    if (!PyArg_ParseTuple(args, (char*)"Od", &z1Obj, &z2)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Dl(self->cosmo, zmin[i], zmax); 
-    }
-
-    return resObj;
-
+    return PyCosmoObject_vec_eval(self, Dl, z1Obj, 0.0, NULL, z2);
 }
 
 static PyObject*
 PyCosmoObject_Dl_vec2(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj=NULL, *resObj=NULL;;
-    double zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z2Obj=NULL;
+    double z1;
 
-    if (!PyArg_ParseTuple(args, (char*)"dO", &zmin, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"dO", &z1, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zmaxObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Dl(self->cosmo, zmin, zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Dl, NULL, z1, z2Obj, 0.0);
 }
 
 static PyObject*
 PyCosmoObject_Dl_2vec(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zmaxObj, *zminObj=NULL, *resObj=NULL;
-    double *zmin, *zmax, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL, *z2Obj=NULL;
 
-    if (!PyArg_ParseTuple(args, (char*)"OO", &zminObj, &zmaxObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"OO", &z1Obj, &z2Obj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zminObj);
-    zmin = (double* )PyArray_DATA(zminObj);
-    zmax = (double* )PyArray_DATA(zmaxObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = Dl(self->cosmo, zmin[i], zmax[i]); 
-    }
-
-    return resObj;
+    return PyCosmoObject_vec_eval(self, Dl, z1Obj, 0.0, z2Obj, 0.0);
 }
 
 // Comoving volume element and vectorization
@@ -530,26 +535,13 @@ PyCosmoObject_dV(struct PyCosmoObject* self, PyObject* args) {
 
 static PyObject*
 PyCosmoObject_dV_vec(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zObj=NULL, *resObj=NULL;;
-    double *z, *res;
-    npy_intp n, i;
+    PyObject* zObj=NULL;
 
     if (!PyArg_ParseTuple(args, (char*)"O", &zObj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zObj);
-    z = (double* )PyArray_DATA(zObj);
-
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
-
-    for (i=0; i<n; i++) {
-        res[i] = dV(self->cosmo, z[i]); 
-    }
-
-    return resObj;
-
+    return PyCosmoObject_vec_eval(self, dV_func2, zObj, 0.0, NULL, 0.0);
 }
 
 // Comoving volume between zmin and zmax
@@ -586,84 +578,141 @@ PyCosmoObject_scinv(struct PyCosmoObject* self, PyObject* args) {
 
 static PyObject*
 PyCosmoObject_scinv_vec1(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zlObj=NULL, *resObj=NULL;;
-    double *zl, zs, *res;
-    npy_intp n, i;
+    PyObject* z1Obj=NULL;
+    double z2;
 
-    if (!PyArg_ParseTuple(args, (char*)"Od", &zlObj, &zs)) {
+    if (!PyArg_ParseTuple(args, (char*)"Od", &z1Obj, &z2)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zlObj);
-    zl = (double* )PyArray_DATA(zlObj);
+    return PyCosmoObject_vec_eval(self, scinv, z1Obj, 0.0, NULL, z2);
+}
 
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
+static PyObject*
+PyCosmoObject_scinv_vec2(struct PyCosmoObject* self, PyObject* args) {
+    PyObject* z2Obj=NULL;
+    double z1;
 
-    for (i=0; i<n; i++) {
-        res[i] = scinv(self->cosmo, zl[i], zs); 
+    if (!PyArg_ParseTuple(args, (char*)"dO", &z1, &z2Obj)) {
+        return NULL;
     }
 
-    return resObj;
+    return PyCosmoObject_vec_eval(self, scinv, NULL, z1, z2Obj, 0.0);
+}
+
+static PyObject*
+PyCosmoObject_scinv_2vec(struct PyCosmoObject* self, PyObject* args) {
+    PyObject* z1Obj=NULL, *z2Obj=NULL;
 
+    if (!PyArg_ParseTuple(args, (char*)"OO", &z1Obj, &z2Obj)) {
+        return NULL;
+    }
+
+    return PyCosmoObject_vec_eval(self, scinv, z1Obj, 0.0, z2Obj, 0.0);
 }
 
+
+// inverse functions and vectorizations
 static PyObject*
-PyCosmoObject_scinv_vec2(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zsObj=NULL, *resObj=NULL;;
-    double zl, *zs, *res;
-    npy_intp n, i;
+PyCosmoObject_z_of_Dc(struct PyCosmoObject* self, PyObject* args) {
+    double dc;
 
-    if (!PyArg_ParseTuple(args, (char*)"dO", &zl, &zsObj)) {
+    if (!PyArg_ParseTuple(args, (char*)"d", &dc)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zsObj);
-    zs = (double* )PyArray_DATA(zsObj);
+    return PyFloat_FromDouble(z_of_Dc(self->cosmo, dc));
+}
+static PyObject*
+PyCosmoObject_z_of_Dc_vec(struct PyCosmoObject* self, PyObject* args) {
+    PyObject* dcObj=NULL;
 
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
-    res = (double* )PyArray_DATA(resObj);
+    if (!PyArg_ParseTuple(args, (char*)"O", &dcObj)) {
+        return NULL;
+    }
 
-    for (i=0; i<n; i++) {
-        res[i] = scinv(self->cosmo, zl, zs[i]); 
+    return PyCosmoObject_vec_eval(self, z_of_Dc_func2, dcObj, 0.0, NULL, 0.0);
+}
+static PyObject*
+PyCosmoObject_z_of_V(struct PyCosmoObject* self, PyObject* args) {
+    double v;
+
+    if (!PyArg_ParseTuple(args, (char*)"d", &v)) {
+        return NULL;
     }
 
-    return resObj;
+    return PyFloat_FromDouble(z_of_V(self->cosmo, v));
+}
+static PyObject*
+PyCosmoObject_z_of_V_vec(struct PyCosmoObject* self, PyObject* args) {
+    PyObject* vObj=NULL;
+
+    if (!PyArg_ParseTuple(args, (char*)"O", &vObj)) {
+        return NULL;
+    }
+
+    return PyCosmoObject_vec_eval(self, z_of_V_func2, vObj, 0.0, NULL, 0.0);
 }
 
+/*
+   scinv for all pairs of the lens and source redshift arrays, returned as
+   an array of shape (nl, ns)
+*/
 static PyObject*
-PyCosmoObject_scinv_2vec(struct PyCosmoObject* self, PyObject* args) {
-    PyObject* zsObj, *zlObj=NULL, *resObj=NULL;
-    double *zl, *zs, *res;
-    npy_intp n, i;
+PyCosmoObject_scinv_matrix(struct PyCosmoObject* self, PyObject* args) {
+    PyObject* zlObj=NULL, *zsObj=NULL, *resObj=NULL;
+    const double *zl, *zs;
+    double* res;
+    npy_intp dims[2];
+    int status;
 
     if (!PyArg_ParseTuple(args, (char*)"OO", &zlObj, &zsObj)) {
         return NULL;
     }
 
-    n = PyArray_SIZE(zlObj);
-    zl = (double* )PyArray_DATA(zlObj);
-    zs = (double* )PyArray_DATA(zsObj);
+    dims[0] = PyArray_SIZE(zlObj);
+    dims[1] = PyArray_SIZE(zsObj);
+    zl = (const double* )PyArray_DATA(zlObj);
+    zs = (const double* )PyArray_DATA(zsObj);
 
-    resObj = PyArray_ZEROS(1, &n, NPY_FLOAT64, 0);
+    resObj = PyArray_ZEROS(2, dims, NPY_FLOAT64, 0);
+    if (resObj == NULL) {
+        return NULL;
+    }
     res = (double* )PyArray_DATA(resObj);
 
-    for (i=0; i<n; i++) {
-        res[i] = scinv(self->cosmo, zl[i], zs[i]); 
+    self->busy++;
+    Py_BEGIN_ALLOW_THREADS
+    status = scinv_matrix(self->cosmo,
+                          zl, (size_t) dims[0],
+                          zs, (size_t) dims[1],
+                          res, self->nthreads);
+    Py_END_ALLOW_THREADS
+    self->busy--;
+
+    if (!status) {
+        Py_DECREF(resObj);
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate scinv work space");
+        return NULL;
     }
 
     return resObj;
 }
 
 
-
-
 static PyMethodDef PyCosmoObject_methods[] = {
     {"DH",          (PyCFunction)PyCosmoObject_DH,          METH_VARARGS, "DH\n\nGet the Hubble distance"},
     {"flat",          (PyCFunction)PyCosmoObject_flat,          METH_VARARGS, "flat\n\nReturn if universe if flat"},
     {"omega_m",          (PyCFunction)PyCosmoObject_omega_m,          METH_VARARGS, "omega_m\n\nGet omega matter"},
     {"omega_l",          (PyCFunction)PyCosmoObject_omega_l,          METH_VARARGS, "omega_m\n\nGet omega lambda"},
     {"omega_k",          (PyCFunction)PyCosmoObject_omega_k,          METH_VARARGS, "omega_m\n\nGet omega curvature"},
+    {"nthreads",            (PyCFunction)PyCosmoObject_nthreads,            METH_NOARGS, "nthreads()\n\nGet the number of threads used for vectorized calculations"},
+    {"set_nthreads",        (PyCFunction)PyCosmoObject_set_nthreads,        METH_VARARGS, "set_nthreads(n)\n\nSet the number of threads used for vectorized calculations.  n <= 0 means use all processors"},
+    {"tol",                 (PyCFunction)PyCosmoObject_tol,                 METH_NOARGS, "tol()\n\nGet the relative tolerance for adaptive integration, 0 for fixed gauss-legendre"},
+    {"set_tol",             (PyCFunction)PyCosmoObject_set_tol,             METH_VARARGS, "set_tol(tol)\n\nSet the relative tolerance for adaptive integration, 0 for fixed gauss-legendre"},
+    {"make_table",          (PyCFunction)PyCosmoObject_make_table,          METH_VARARGS, "make_table(zmax, tol)\n\nTabulate the 1/E(z) integral on [0,zmax] with interpolation error less than tol"},
+    {"free_table",          (PyCFunction)PyCosmoObject_free_table,          METH_NOARGS, "free_table()\n\nFree the table, reverting to direct integration"},
+    {"table_info",          (PyCFunction)PyCosmoObject_table_info,          METH_NOARGS, "table_info()\n\nGet (ntab, zmax, maxerr) for the table. ntab is zero if there is no table"},
     {"ez_inverse",          (PyCFunction)PyCosmoObject_ez_inverse,          METH_VARARGS, "ez_inverse(z)\n\nGet 1/E(z)"},
     {"ez_inverse_vec",          (PyCFunction)PyCosmoObject_ez_inverse_vec,          METH_VARARGS, "ez_inverse_vec(z)\n\nGet 1/E(z) for z an array"},
     {"ez_inverse_integral", (PyCFunction)PyCosmoObject_ez_inverse_integral, METH_VARARGS, "ez_inverse_integral(zmin, zmax)\n\nGet integral of 1/E(z) from zmin to zmax"},
@@ -690,6 +739,11 @@ static PyMethodDef PyCosmoObject_methods[] = {
     {"scinv_vec1",          (PyCFunction)PyCosmoObject_scinv_vec1,          METH_VARARGS, "scinv_vec1(zl,zs)\n\nInverse critical density distance between zl(array) and zs"},
     {"scinv_vec2",          (PyCFunction)PyCosmoObject_scinv_vec2,          METH_VARARGS, "scinv_vec2(zl,zs)\n\nInverse critical density distance between zl and zs(array)"},
     {"scinv_2vec",          (PyCFunction)PyCosmoObject_scinv_2vec,          METH_VARARGS, "scinv_2vec(zl,zs)\n\nInverse critical density distance between zl and zs both arrays"},
+    {"z_of_Dc",             (PyCFunction)PyCosmoObject_z_of_Dc,             METH_VARARGS, "z_of_Dc(dc)\n\nRedshift at comoving distance dc"},
+    {"z_of_Dc_vec",         (PyCFunction)PyCosmoObject_z_of_Dc_vec,         METH_VARARGS, "z_of_Dc_vec(dc)\n\nRedshift at comoving distance dc(array)"},
+    {"z_of_V",              (PyCFunction)PyCosmoObject_z_of_V,              METH_VARARGS, "z_of_V(v)\n\nRedshift enclosing comoving volume v"},
+    {"z_of_V_vec",          (PyCFunction)PyCosmoObject_z_of_V_vec,          METH_VARARGS, "z_of_V_vec(v)\n\nRedshift enclosing comoving volume v(array)"},
+    {"scinv_matrix",        (PyCFunction)PyCosmoObject_scinv_matrix,        METH_VARARGS, "scinv_matrix(zl,zs)\n\nInverse critical density for all pairs of zl(array) and zs(array), shape (nl,ns)"},
 
     {NULL}  /* Sentinel */
 };
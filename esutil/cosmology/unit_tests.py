@@ -0,0 +1,109 @@
+import esutil
+import numpy
+from numpy import where
+
+# COSMO_INV_ZMAX in cosmolib.h
+_INV_ZMAX = 1.e4
+
+def _cosmologies(**keys):
+    """
+    flat, open and closed cosmologies
+    """
+    return [esutil.cosmology.Cosmo(omega_m=0.3, **keys),
+            esutil.cosmology.Cosmo(flat=False, omega_m=0.3, omega_l=0.6,
+                                   omega_k=0.1, **keys),
+            esutil.cosmology.Cosmo(flat=False, omega_m=0.3, omega_l=0.8,
+                                   omega_k=-0.1, **keys)]
+
+def _check_round_trip(name, c, z, dc, v, rtol):
+    """
+    Check that z_of_Dc(dc) and z_of_V(v) recover z to rtol*(1+z)
+    """
+    nbad=0
+
+    zdc = c.z_of_Dc(dc)
+    w, = where( ~(numpy.abs(zdc-z) <= rtol*(1+z)) )
+    if w.size != 0:
+        print '  %s: z_of_Dc wrong for %s of %s, e.g. z=%s gave %s' % \
+                (name, w.size, z.size, z[w[0]], zdc[w[0]])
+        nbad += 1
+
+    zv = c.z_of_V(v)
+    w, = where( ~(numpy.abs(zv-z) <= rtol*(1+z)) )
+    if w.size != 0:
+        print '  %s: z_of_V wrong for %s of %s, e.g. z=%s gave %s' % \
+                (name, w.size, z.size, z[w[0]], zv[w[0]])
+        nbad += 1
+
+    return nbad
+
+def test_inverse():
+    """
+    Round trips z_of_Dc(Dc(0,z)) and z_of_V(V(0,z)) for flat, open and closed
+    cosmologies, in each mode: the default fixed integrations, adaptive
+    integration with a tolerance, and a table.
+
+    The fixed integrations are only accurate at low redshift, but the
+    inverse functions invert the accurate distances over the full range
+    [0,COSMO_INV_ZMAX] in every mode, so also compare to distances calculated
+    with a tight tolerance
+    """
+    print 'Testing z_of_Dc and z_of_V'
+
+    nbad=0
+
+    zall = numpy.zeros(101)
+    zall[1:] = numpy.logspace(-3, numpy.log10(_INV_ZMAX), 100)
+    zlow = zall[where(zall <= 1.0)]
+
+    table_zmax=100.0
+    ztab = zall[where(zall <= table_zmax)]
+
+    refs = _cosmologies(tol=1.e-12)
+    defaults = _cosmologies()
+    tols = _cosmologies(tol=1.e-10)
+    tables = _cosmologies(table_zmax=table_zmax, table_tol=1.e-10)
+
+    for ref, cdef, ctol, ctab in zip(refs, defaults, tols, tables):
+        dc = ref.Dc(0.0, zall)
+        v = numpy.array([ref.V(0.0, zi) for zi in zall])
+        for name, c in [('default',cdef), ('tol',ctol), ('table',ctab)]:
+            name = '%s flat=%s omega_k=%s' % (name, c.flat(), c.omega_k())
+            nbad += _check_round_trip(name+' accurate', c, zall, dc, v, 1.e-8)
+
+        # with a tolerance the forward functions are accurate everywhere
+        dc = ctol.Dc(0.0, zall)
+        v = numpy.array([ctol.V(0.0, zi) for zi in zall])
+        nbad += _check_round_trip('tol', ctol, zall, dc, v, 1.e-9)
+
+        # the fixed integrations are good to about 1.e-8 for z <= 1
+        dc = cdef.Dc(0.0, zlow)
+        v = numpy.array([cdef.V(0.0, zi) for zi in zlow])
+        nbad += _check_round_trip('default', cdef, zlow, dc, v, 1.e-7)
+
+        # the table gives distances, but the volume integral is still fixed
+        dc = ctab.Dc(0.0, ztab)
+        zdc = ctab.z_of_Dc(dc)
+        w, = where( ~(numpy.abs(zdc-ztab) <= 1.e-10*(1+ztab)) )
+        if w.size != 0:
+            print '  table: z_of_Dc wrong for %s of %s' % (w.size,ztab.size)
+            nbad += 1
+        v = numpy.array([ctab.V(0.0, zi) for zi in zlow])
+        nbad += _check_round_trip('table', ctab, zlow, ctab.Dc(0.0, zlow), v,
+                                  1.e-7)
+
+    # beyond the horizon, and the volume from a nan seed
+    for c in defaults + tables:
+        for val in [c.z_of_Dc(1.e30), c.z_of_V(1.e80)]:
+            if not numpy.isnan(val):
+                print '  expected nan beyond the horizon, got %s' % val
+                nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+if __name__=='__main__':
+    test_inverse()
@@ -69,6 +69,9 @@ Methods:
         If you need to match the same set multiple times, use a Matcher
         object
     
+    random_footprint(nrand, htmid=None, ranges=None, ...)
+        Generate random points within a footprint made of htm triangles,
+        in threaded C++.
     read(filename)
         Read the pairs from a file written by the match() code.
         
@@ -215,6 +215,90 @@ class HTM(htmc.HTMC):
 
 
 
+    def random_footprint(self, nrand,
+                         htmid=None,
+                         ranges=None,
+                         ra_range=None,
+                         dec_range=None,
+                         system='eq',
+                         seed=None,
+                         stream=0,
+                         nthreads=1):
+        """
+        Generate random points uniformly within a footprint made of htm
+        triangles at the depth of this HTM object.
+
+        Points are generated uniformly in the ra,dec box and those whose
+        htm id is in the footprint are kept, all in C++.  The first nrand
+        points kept are returned, so the result does not depend on the
+        number of threads.
+
+        parameters
+        ----------
+        nrand: integer
+            The number of randoms to generate
+        htmid: array, optional
+            The htm ids of the triangles in the footprint, for example from
+            lookup_id() of a catalog or from intersect()
+        ranges: array, optional
+            Instead of htmid, inclusive ranges of ids [[min1,max1],
+            [min2,max2],...]
+        ra_range, dec_range: optional
+            A box in degrees that contains the footprint.  The default is
+            the whole sphere; a box close to the footprint wastes fewer
+            points.
+        system: string
+            Default is 'eq' for ra,dec.  Can also be 'xyz'.
+        seed: int, optional
+            Seed for the random number generator.  If None, a seed is drawn
+            from numpy.random
+        stream: int, optional
+            Stream of the generator.  Different streams with the same seed
+            give independent points.  Default 0
+        nthreads: int, optional
+            Number of threads to use, default 1
+
+        output
+        ------
+            ra,dec or x,y,z for system='xyz'
+
+        examples
+        --------
+            h=esutil.htm.HTM(10)
+            ids = h.intersect(200.0, 15.0, 2.0, inclusive=False)
+            ra,dec = h.random_footprint(100000, htmid=ids,
+                                        ra_range=[197,203],
+                                        dec_range=[12,18])
+        """
+        from esutil import coords
+
+        if ranges is None:
+            if htmid is None:
+                raise ValueError("send htmid= or ranges=")
+            ranges = ids2ranges(htmid)
+
+        ranges = numpy.array(ranges, dtype='i8', ndmin=2, copy=False)
+        if ranges.shape[1] != 2:
+            raise ValueError("ranges must have shape (n,2)")
+        ranges = numpy.ascontiguousarray(ranges).ravel()
+
+        ra_range = coords._check_range(ra_range, [0.0,360.0])
+        dec_range = coords._check_range(dec_range, [-90.0,90.0])
+
+        if system == 'xyz':
+            xyz=1
+        else:
+            xyz=0
+
+        return super(HTM,self).crandfootprint(ranges, int(nrand),
+                                              float(ra_range[0]),
+                                              float(ra_range[1]),
+                                              float(dec_range[0]),
+                                              float(dec_range[1]),
+                                              coords._get_rand_seed(seed),
+                                              int(stream), int(nthreads),
+                                              xyz)
+
     def match_prepare(self, ra, dec, verbose=False):
         """
         deprecated.  Use an htm.Matcher instead
@@ -723,6 +807,24 @@ class Matcher(htmc.Matcher):
         file=check_filename(file)
         return super(Matcher, self).match(ra, dec, radius, maxmatch, file)
 
+def ids2ranges(htmid):
+    """
+    Convert a set of htm ids to the inclusive ranges of consecutive ids,
+    returned as an array with shape (n,2)
+    """
+    ids = numpy.unique(numpy.array(htmid, dtype='i8', ndmin=1, copy=False))
+    if ids.size == 0:
+        raise ValueError("no htm ids sent")
+
+    # starts of runs of consecutive ids
+    w, = numpy.where(ids[1:] != ids[0:-1]+1)
+    ranges = numpy.zeros( (w.size+1, 2), dtype='i8')
+    ranges[0,0] = ids[0]
+    ranges[1:,0] = ids[w+1]
+    ranges[0:-1,1] = ids[w]
+    ranges[-1,1] = ids[-1]
+    return ranges
+
 def read_pairs(filename, verbose=False):
     """
     Read the pair info written by the match code
@@ -5,7 +5,9 @@
 #include <math.h>
 #include "htmc.h"
 #include "NumpyVector.h"
+#include "ParallelJobs.h"
 #include <algorithm> // for transform
+#include <pthread.h>
 
 
 // A couple of utility functions
@@ -796,3 +798,417 @@ PyObject* Matcher::match(
 
 } // Matcher::match
 
+
+
+
+/*
+   Random points on the sphere
+
+   The uniform randoms come from the counter based generator in
+   ParallelJobs.h, also used in esutil.stat._stat_util.  Point i always
+   uses numbers 2*i and 2*i+1, so the output is the same however the points
+   are split over threads.
+*/
+
+static const double RAND_D2R=0.0174532925199433;
+static const double RAND_R2D=57.29577951308232;
+
+struct RandPoint {
+    double ra, dec; // degrees
+    double x, y, z;
+    double r; // distance from the cap center, radians, only set for caps
+
+    RandPoint() : ra(0), dec(0), x(0), y(0), z(0), r(0) {}
+};
+
+/*
+   Uniform in the box ra in [ramin,ramax], dec in [decmin,decmax], with dec
+   uniform in sin(dec)
+*/
+struct SphereGen {
+    double ramin, rawidth;
+    double zmin, zwidth;
+
+    SphereGen(double ramin_in, double ramax, double decmin, double decmax) {
+        ramin = ramin_in;
+        rawidth = ramax - ramin_in;
+        zmin = sin(decmin*RAND_D2R);
+        zwidth = sin(decmax*RAND_D2R) - zmin;
+    }
+
+    void make(const esutil_rng& rng, uint64_t i, RandPoint& p, bool getxyz) const {
+        p.ra = ramin + esutil_rng_uniform_at(&rng, 2*i)*rawidth;
+
+        double z = zmin + esutil_rng_uniform_at(&rng, 2*i+1)*zwidth;
+        if (z > 1.0) z=1.0;
+        if (z < -1.0) z=-1.0;
+        p.dec = asin(z)*RAND_R2D;
+
+        if (getxyz) {
+            double cosdec = sqrt(1.0 - z*z);
+            double ra = p.ra*RAND_D2R;
+            p.x = cosdec*cos(ra);
+            p.y = cosdec*sin(ra);
+            p.z = z;
+        }
+    }
+};
+
+/*
+   Uniform in area within the cap of radius rad around ra,dec.  The point is
+   placed at distance r and position angle pa in the frame of the center,
+   which also works at the poles.  1-cos(r) is uniform, and
+   1-cos(r) = 2 sin^2(r/2) keeps the precision for small caps.
+*/
+struct CapGen {
+    double cx, cy, cz; // center
+    double nx, ny, nz; // north
+    double ex, ey;     // east, ez=0
+    double sinhalf;
+
+    CapGen(double ra, double dec, double rad) {
+        double a=ra*RAND_D2R, d=dec*RAND_D2R;
+        double sina=sin(a), cosa=cos(a), sind=sin(d), cosd=cos(d);
+
+        cx = cosd*cosa; cy = cosd*sina; cz = sind;
+        nx = -sind*cosa; ny = -sind*sina; nz = cosd;
+        ex = -sina; ey = cosa;
+        sinhalf = sin(0.5*rad*RAND_D2R);
+    }
+
+    // ra,dec are found from x,y,z, so these are always set and the getxyz
+    // argument of the generator interface is not needed
+    void make(const esutil_rng& rng, uint64_t i, RandPoint& p, bool) const {
+        double s = sqrt(esutil_rng_uniform_at(&rng, 2*i))*sinhalf;
+        double pa = 2*M_PI*esutil_rng_uniform_at(&rng, 2*i+1);
+
+        p.r = 2*asin(s);
+        double cosr = 1.0 - 2*s*s;
+        double sinr = sin(p.r);
+        double north = sinr*cos(pa), east = sinr*sin(pa);
+
+        p.x = cosr*cx + north*nx + east*ex;
+        p.y = cosr*cy + north*ny + east*ey;
+        p.z = cosr*cz + north*nz;
+        if (p.z > 1.0) p.z=1.0;
+        if (p.z < -1.0) p.z=-1.0;
+
+        p.ra = atan2(p.y, p.x)*RAND_R2D;
+        if (p.ra < 0) {
+            p.ra += 360.0;
+        }
+        p.dec = asin(p.z)*RAND_R2D;
+    }
+};
+
+static long limit_threads(long nthreads, npy_intp n) {
+    if (nthreads > n) nthreads = n;
+    if (nthreads < 1) nthreads = 1;
+    return nthreads;
+}
+
+// Points [start,end) written directly into the outputs
+template <class Gen>
+struct RandJob {
+    const Gen* gen;
+    const esutil_rng* rng;
+    npy_intp start;
+    npy_intp end;
+
+    bool xyz;
+    double* out1; // ra or x
+    double* out2; // dec or y
+    double* out3; // z or cap radius, can be NULL
+
+    static void* run(void* arg) {
+        RandJob* job = (RandJob*) arg;
+        RandPoint p;
+
+        for (npy_intp i=job->start; i<job->end; i++) {
+            job->gen->make(*job->rng, (uint64_t) i, p, job->xyz);
+            if (job->xyz) {
+                job->out1[i] = p.x;
+                job->out2[i] = p.y;
+                job->out3[i] = p.z;
+            } else {
+                job->out1[i] = p.ra;
+                job->out2[i] = p.dec;
+                if (job->out3) {
+                    job->out3[i] = p.r;
+                }
+            }
+        }
+        return NULL;
+    }
+};
+
+template <class Gen>
+static PyObject* run_rand(const Gen& gen, npy_intp nrand,
+                          long seed, long stream, long nthreads,
+                          bool xyz, bool get3) throw (const char*) {
+
+    if (nrand < 0) {
+        throw "nrand must be >= 0";
+    }
+    esutil_rng rng;
+    esutil_rng_init(&rng, (npy_uint64) seed, (npy_uint64) stream);
+
+    NumpyVector<double> out1(nrand);
+    NumpyVector<double> out2(nrand);
+    NumpyVector<double> out3;
+    if (get3) {
+        out3.init(nrand);
+    }
+
+    nthreads = limit_threads(nthreads, nrand);
+    std::vector< RandJob<Gen> > jobs(nthreads);
+    npy_intp chunksize = nrand/nthreads;
+    for (long t=0; t<nthreads; t++) {
+        RandJob<Gen>& job = jobs[t];
+        job.gen = &gen;
+        job.rng = &rng;
+        job.start = t*chunksize;
+        job.end = (t == nthreads-1) ? nrand : (t+1)*chunksize;
+        job.xyz = xyz;
+        job.out1 = nrand > 0 ? out1.ptr() : NULL;
+        job.out2 = nrand > 0 ? out2.ptr() : NULL;
+        job.out3 = (get3 && nrand > 0) ? out3.ptr() : NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    PyObject* output_tuple = PyTuple_New(get3 ? 3 : 2);
+    PyTuple_SetItem(output_tuple, 0, out1.getref());
+    PyTuple_SetItem(output_tuple, 1, out2.getref());
+    if (get3) {
+        PyTuple_SetItem(output_tuple, 2, out3.getref());
+    }
+    return output_tuple;
+}
+
+static void check_box(double ramin, double ramax, 
+                      double decmin, double decmax) throw (const char*) {
+    if (!(ramin >= 0 && ramax <= 360 && ramin <= ramax)) {
+        throw "ra range must be within [0,360]";
+    }
+    if (!(decmin >= -90 && decmax <= 90 && decmin <= decmax)) {
+        throw "dec range must be within [-90,90]";
+    }
+}
+
+PyObject* crandsphere(long nrand,
+                      double ramin, double ramax,
+                      double decmin, double decmax,
+                      long seed, long stream, long nthreads,
+                      int xyz) throw (const char *) {
+
+    check_box(ramin, ramax, decmin, decmax);
+    SphereGen gen(ramin, ramax, decmin, decmax);
+    return run_rand(gen, nrand, seed, stream, nthreads, xyz != 0, xyz != 0);
+}
+
+PyObject* crandcap(long nrand,
+                   double ra, double dec, double rad,
+                   long seed, long stream, long nthreads,
+                   int get_radius) throw (const char *) {
+
+    if (!(dec >= -90 && dec <= 90)) {
+        throw "dec must be within [-90,90]";
+    }
+    if (!(rad >= 0 && rad <= 180)) {
+        throw "rad must be within [0,180]";
+    }
+    CapGen gen(ra, dec, rad);
+    return run_rand(gen, nrand, seed, stream, nthreads, false, get_radius != 0);
+}
+
+
+/*
+   Random points in a footprint given as ranges of htm ids at the depth of
+   the index.  Candidates are made in the ra,dec box and kept if they lie in
+   the footprint.  Candidate i is always made from the same randoms, and
+   the first nrand kept candidates are returned, in order, so the result
+   does not depend on the number of threads.
+
+   The candidates are processed in blocks.  Each round the threads share a
+   set of blocks, and the kept points are then copied out in block order.
+*/
+
+static const npy_intp FOOT_BLOCKSIZE=16384;
+static const npy_intp FOOT_BLOCKS_PER_THREAD=4;
+
+// give up if nothing is kept from this many candidates
+static const npy_int64 FOOT_MAX_EMPTY=((npy_int64) 1) << 32;
+
+class HtmRanges {
+    public:
+        HtmRanges(NumpyVector<npy_int64>& ranges, int depth) throw (const char*) {
+            npy_intp n = ranges.size()/2;
+            if (ranges.size() != 2*n || n == 0) {
+                throw "ranges must be non-empty pairs [min,max]";
+            }
+
+            // valid ids at this depth are [8*4^depth, 16*4^depth)
+            npy_int64 idmin = ((npy_int64) 8) << (2*depth);
+            npy_int64 idmax = (((npy_int64) 16) << (2*depth)) - 1;
+
+            std::vector< std::pair<npy_int64,npy_int64> > pairs(n);
+            for (npy_intp i=0; i<n; i++) {
+                pairs[i].first = ranges[2*i];
+                pairs[i].second = ranges[2*i+1];
+                if (pairs[i].first > pairs[i].second
+                        || pairs[i].first < idmin || pairs[i].second > idmax) {
+                    throw "ranges must be [min,max] with valid htm ids for the depth";
+                }
+            }
+
+            // sort and merge overlapping or adjacent ranges
+            std::sort(pairs.begin(), pairs.end());
+            for (npy_intp i=0; i<n; i++) {
+                if (!lo.empty() && pairs[i].first <= hi.back()+1) {
+                    if (pairs[i].second > hi.back()) {
+                        hi.back() = pairs[i].second;
+                    }
+                } else {
+                    lo.push_back(pairs[i].first);
+                    hi.push_back(pairs[i].second);
+                }
+            }
+        }
+
+        bool contains(npy_int64 id) const {
+            std::vector<npy_int64>::const_iterator it =
+                std::upper_bound(lo.begin(), lo.end(), id);
+            if (it == lo.begin()) {
+                return false;
+            }
+            size_t k = (it - lo.begin()) - 1;
+            return id <= hi[k];
+        }
+
+    private:
+        std::vector<npy_int64> lo;
+        std::vector<npy_int64> hi;
+};
+
+struct FootprintJob {
+    const SphereGen* gen;
+    const esutil_rng* rng;
+    const htmInterface* htm;
+    const HtmRanges* ranges;
+
+    // candidates in block b are [b*FOOT_BLOCKSIZE,(b+1)*FOOT_BLOCKSIZE)
+    npy_int64 first_block;
+    long nblock;
+    long step;
+    long offset;
+    std::vector< std::vector<RandPoint> >* kept;
+
+    static void* run(void* arg) {
+        FootprintJob* job = (FootprintJob*) arg;
+        RandPoint p;
+
+        for (long b=job->offset; b<job->nblock; b+=job->step) {
+            std::vector<RandPoint>& kept = (*job->kept)[b];
+            kept.clear();
+
+            uint64_t start = (uint64_t) (job->first_block + b)*FOOT_BLOCKSIZE;
+            for (uint64_t i=start; i<start+FOOT_BLOCKSIZE; i++) {
+                job->gen->make(*job->rng, i, p, true);
+                npy_int64 id = (npy_int64) job->htm->lookupID(p.x, p.y, p.z);
+                if (job->ranges->contains(id)) {
+                    kept.push_back(p);
+                }
+            }
+        }
+        return NULL;
+    }
+};
+
+PyObject* HTMC::crandfootprint(PyObject* ranges_obj,
+                               long nrand,
+                               double ramin, double ramax,
+                               double decmin, double decmax,
+                               long seed, long stream, long nthreads,
+                               int xyz) throw (const char *) {
+
+    if (nrand < 0) {
+        throw "nrand must be >= 0";
+    }
+    check_box(ramin, ramax, decmin, decmax);
+
+    NumpyVector<npy_int64> ranges_vec(ranges_obj);
+    HtmRanges ranges(ranges_vec, mDepth);
+
+    SphereGen gen(ramin, ramax, decmin, decmax);
+    esutil_rng rng;
+    esutil_rng_init(&rng, (npy_uint64) seed, (npy_uint64) stream);
+
+    NumpyVector<double> out1(nrand);
+    NumpyVector<double> out2(nrand);
+    NumpyVector<double> out3;
+    if (xyz) {
+        out3.init(nrand);
+    }
+
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    long nblock = nthreads*FOOT_BLOCKS_PER_THREAD;
+    std::vector< std::vector<RandPoint> > kept(nblock);
+    std::vector<FootprintJob> jobs(nthreads);
+    for (long t=0; t<nthreads; t++) {
+        FootprintJob& job = jobs[t];
+        job.gen = &gen;
+        job.rng = &rng;
+        job.htm = &mHtmInterface;
+        job.ranges = &ranges;
+        job.nblock = nblock;
+        job.step = nthreads;
+        job.offset = t;
+        job.kept = &kept;
+    }
+
+    npy_intp nfound=0;
+    npy_int64 first_block=0;
+    while (nfound < nrand) {
+        if (nfound == 0 && first_block*FOOT_BLOCKSIZE >= FOOT_MAX_EMPTY) {
+            throw "no random points found in the footprint; check the "
+                  "ranges and the ra,dec box";
+        }
+
+        for (long t=0; t<nthreads; t++) {
+            jobs[t].first_block = first_block;
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        run_jobs(jobs);
+        Py_END_ALLOW_THREADS
+
+        for (long b=0; b<nblock && nfound < nrand; b++) {
+            for (size_t j=0; j<kept[b].size() && nfound < nrand; j++) {
+                const RandPoint& p = kept[b][j];
+                if (xyz) {
+                    out1[nfound] = p.x;
+                    out2[nfound] = p.y;
+                    out3[nfound] = p.z;
+                } else {
+                    out1[nfound] = p.ra;
+                    out2[nfound] = p.dec;
+                }
+                nfound++;
+            }
+        }
+        first_block += nblock;
+    }
+
+    PyObject* output_tuple = PyTuple_New(xyz ? 3 : 2);
+    PyTuple_SetItem(output_tuple, 0, out1.getref());
+    PyTuple_SetItem(output_tuple, 1, out2.getref());
+    if (xyz) {
+        PyTuple_SetItem(output_tuple, 2, out3.getref());
+    }
+    return output_tuple;
+}
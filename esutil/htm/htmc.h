@@ -76,7 +76,15 @@ class HTMC {
                                             // Same length as ra1.
                               throw (const char *);
 
-
+        // random points in the footprint given by ranges of htm ids
+        // at this depth, returns (ra,dec) or (x,y,z)
+        PyObject* crandfootprint(
+                PyObject* ranges_obj, // int64 pairs [min,max]
+                long nrand,
+                double ramin, double ramax, // box holding the footprint
+                double decmin, double decmax,
+                long seed, long stream, long nthreads,
+                int xyz) throw (const char *);
 
 
         int depth() {
@@ -124,5 +132,20 @@ class Matcher {
 
 };
 
+// Random points uniform on the sphere within the ra,dec box, returns
+// (ra,dec) or (x,y,z).  Output is the same for any number of threads.
+PyObject* crandsphere(long nrand,
+                      double ramin, double ramax,
+                      double decmin, double decmax,
+                      long seed, long stream, long nthreads,
+                      int xyz) throw (const char *);
+
+// Random points uniform in a cap, returns (ra,dec) or (ra,dec,r), with r
+// the distance from the center in radians.
+PyObject* crandcap(long nrand,
+                   double ra, double dec, double rad,
+                   long seed, long stream, long nthreads,
+                   int get_radius) throw (const char *);
+
 
 #endif
@@ -101,6 +101,13 @@ Revision History:
                                             // Same length as ra1.
                               throw (const char *);
 
+        PyObject* crandfootprint(
+                PyObject* ranges_obj,
+                long nrand,
+                double ramin, double ramax,
+                double decmin, double decmax,
+                long seed, long stream, long nthreads,
+                int xyz) throw (const char *);
 
 
         int depth() {
@@ -135,4 +142,13 @@ class Matcher {
 
 };
 
+PyObject* crandsphere(long nrand,
+                      double ramin, double ramax,
+                      double decmin, double decmax,
+                      long seed, long stream, long nthreads,
+                      int xyz) throw (const char *);
 
+PyObject* crandcap(long nrand,
+                   double ra, double dec, double rad,
+                   long seed, long stream, long nthreads,
+                   int get_radius) throw (const char *);
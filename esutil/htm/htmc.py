@@ -230,6 +230,7 @@ class HTMC(_object):
         """
         return _htmc.HTMC_cbincount(self, *args)
 
+    def crandfootprint(self, *args): return _htmc.HTMC_crandfootprint(self, *args)
     def depth(self):
         """
         Class:
@@ -287,6 +288,15 @@ class Matcher(_object):
 Matcher_swigregister = _htmc.Matcher_swigregister
 Matcher_swigregister(Matcher)
 
+
+def crandsphere(*args):
+  return _htmc.crandsphere(*args)
+crandsphere = _htmc.crandsphere
+
+def crandcap(*args):
+  return _htmc.crandcap(*args)
+crandcap = _htmc.crandcap
+
 # This file is compatible with both classic and new-style classes.
 
 
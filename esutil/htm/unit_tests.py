@@ -169,6 +169,103 @@ def test():
     tests += 1
 
 
+    # random points in a footprint of triangles around a point
+    stdout.write("\nTesting random_footprint....")
+    ids = h.intersect(200.0, 15.0, 1.0, inclusive=False)
+    ra,dec = h.random_footprint(10000, htmid=ids,
+                                ra_range=[198,202], dec_range=[13,17],
+                                seed=35)
+    ra4,dec4 = h.random_footprint(10000, htmid=ids,
+                                  ra_range=[198,202], dec_range=[13,17],
+                                  seed=35, nthreads=4)
+    rid = h.lookup_id(ra, dec)
+    nbad = (numpy.in1d(rid, ids) == False).sum()
+    if nbad > 0 or (ra != ra4).any() or (dec != dec4).any():
+        stdout.write('Error\n')
+        errors += 1
+    else:
+        stdout.write('OK\n')
+    tests += 1
+
+
+    # caps are uniform in area for scalar and array centers
+    stdout.write("\nTesting randcap....")
+    import esutil
+    n=100000
+    expected = (1-numpy.cos(numpy.deg2rad(30.)))/(1-numpy.cos(numpy.deg2rad(60.)))
+    ra,dec,r = esutil.coords.randcap(n, 200.0, 15.0, 60.0, get_radius=True,
+                                     seed=35)
+    raa,deca,ra_r = esutil.coords.randcap(n, numpy.zeros(n)+200.0,
+                                          numpy.zeros(n)+15.0, 60.0,
+                                          get_radius=True, seed=35)
+    frac = (r < numpy.deg2rad(30.)).mean()
+    fraca = (ra_r < numpy.deg2rad(30.)).mean()
+    if (abs(frac-expected) > 0.005 or abs(fraca-expected) > 0.005
+            or (ra < 0).any() or (ra >= 360).any()
+            or (raa < 0).any() or (raa >= 360).any()):
+        stdout.write('Error\n')
+        errors += 1
+    else:
+        stdout.write('OK\n')
+    tests += 1
+
+
+    # points in a box are uniform in ra and sin(dec), within the box
+    stdout.write("\nTesting randsphere....")
+    n=100000
+    ra,dec = esutil.coords.randsphere(n, ra_range=[10.,50.],
+                                      dec_range=[-20.,30.], seed=35)
+    x,y,z = esutil.coords.randsphere(n, ra_range=[10.,50.],
+                                     dec_range=[-20.,30.], seed=35,
+                                     system='xyz')
+    ra4,dec4 = esutil.coords.randsphere(n, ra_range=[10.,50.],
+                                        dec_range=[-20.,30.], seed=35,
+                                        nthreads=4)
+    ra_s1,dec_s1 = esutil.coords.randsphere(n, seed=35, stream=1)
+    xx,yy,zz = esutil.coords.eq2xyz(ra, dec)
+
+    # fraction in each of 4 bins in ra and in sin(dec), expect 0.25
+    sdec = numpy.sin(numpy.deg2rad(dec))
+    smin = numpy.sin(numpy.deg2rad(-20.))
+    smax = numpy.sin(numpy.deg2rad(30.))
+    rafrac = numpy.histogram(ra, bins=4, range=[10.,50.])[0]/float(n)
+    sfrac = numpy.histogram(sdec, bins=4, range=[smin,smax])[0]/float(n)
+
+    # the full sphere
+    raf,decf = esutil.coords.randsphere(n, seed=36)
+    north = (decf > 0).mean()
+    if ((ra < 10.).any() or (ra > 50.).any()
+            or (dec < -20.).any() or (dec > 30.).any()
+            or (raf < 0).any() or (raf > 360).any()
+            or (decf < -90).any() or (decf > 90).any()
+            or numpy.abs(rafrac-0.25).max() > 0.01
+            or numpy.abs(sfrac-0.25).max() > 0.01
+            or abs(north-0.5) > 0.01
+            or (ra != ra4).any() or (dec != dec4).any()
+            or numpy.abs(x-xx).max() > 1.e-12
+            or numpy.abs(y-yy).max() > 1.e-12
+            or numpy.abs(z-zz).max() > 1.e-12
+            or (ra == ra_s1).all()):
+        stdout.write('Error\n')
+        errors += 1
+    else:
+        stdout.write('OK\n')
+    tests += 1
+
+    # a fixed seed reproduces the points
+    stdout.write("\nTesting randsphere seed....")
+    ra2,dec2 = esutil.coords.randsphere(n, ra_range=[10.,50.],
+                                        dec_range=[-20.,30.], seed=35)
+    rac,decc = esutil.coords.randcap(n, 200.0, 15.0, 60.0, seed=35)
+    rac2,decc2 = esutil.coords.randcap(n, 200.0, 15.0, 60.0, seed=35)
+    if ((ra2 != ra).any() or (dec2 != dec).any()
+            or (rac2 != rac).any() or (decc2 != decc).any()):
+        stdout.write('Error\n')
+        errors += 1
+    else:
+        stdout.write('OK\n')
+    tests += 1
+
 
     stdout.write('\n' + '-'*50 + '\n')
     stdout.write('Founds %s errors in %s tests\n' % (errors,tests))
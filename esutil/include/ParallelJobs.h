@@ -0,0 +1,122 @@
+/*
+   ParallelJobs.h
+
+   Threading and random numbers shared by the C and C++ extensions.  This
+   is header-only and can be included from C or C++.
+
+   Jobs
+
+      Each job is run in its own thread, with the first run in the calling
+      thread.  The jobs are independent, so if a thread cannot be created
+      the job is simply run in the calling thread.  Call without the GIL.
+
+      // C: jobs is an array of njob structs of size jobsize
+      esutil_run_jobs(jobs, sizeof(struct my_job), njob, my_worker);
+
+      // C++: Job has a static member void* run(void*)
+      std::vector<MyJob> jobs(nthreads);
+      run_jobs(jobs);
+
+   Counter based random numbers
+
+      Number n of a stream is the splitmix64 hash of a key and n, so any
+      point in the stream can be reached directly.  The key is made from the
+      seed and the stream number, which gives independent and reproducible
+      substreams, for example one per thread, each with 2^64 numbers.
+
+      struct esutil_rng rng;
+      esutil_rng_init(&rng, seed, stream);
+
+      // the next number, uniform in the open interval (0,1)
+      double u = esutil_rng_uniform(&rng);
+
+      // number n, without changing the state; this is the value the
+      // (n+1)th call to esutil_rng_uniform gives
+      double un = esutil_rng_uniform_at(&rng, n);
+*/
+#ifndef _parallel_jobs_h
+#define _parallel_jobs_h
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "numpy/npy_common.h"
+
+#ifdef __cplusplus
+#include <vector>
+#endif
+
+static NPY_INLINE void
+esutil_run_jobs(void* jobs, size_t jobsize, long njob, void* (*worker)(void*))
+{
+    char* jobptr = (char*) jobs;
+    pthread_t* threads=NULL;
+    int* started=NULL;
+    long t=0;
+
+    if (njob < 1) {
+        return;
+    }
+
+    threads = (pthread_t*) calloc(njob, sizeof(pthread_t));
+    started = (int*) calloc(njob, sizeof(int));
+    if (threads != NULL && started != NULL) {
+        for (t=1; t<njob; t++) {
+            started[t] = (pthread_create(&threads[t], NULL, worker,
+                                         jobptr + t*jobsize) == 0);
+        }
+    }
+    worker(jobptr);
+    for (t=1; t<njob; t++) {
+        if (started != NULL && started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            worker(jobptr + t*jobsize);
+        }
+    }
+    free(threads);
+    free(started);
+}
+
+#ifdef __cplusplus
+template <class Job>
+static void run_jobs(std::vector<Job>& jobs) {
+    if (!jobs.empty()) {
+        esutil_run_jobs(&jobs[0], sizeof(Job), (long) jobs.size(), Job::run);
+    }
+}
+#endif
+
+struct esutil_rng {
+    npy_uint64 key;
+    npy_uint64 counter;
+};
+
+static NPY_INLINE npy_uint64 esutil_mix64(npy_uint64 z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static NPY_INLINE void
+esutil_rng_init(struct esutil_rng* rng, npy_uint64 seed, npy_uint64 stream)
+{
+    rng->key = esutil_mix64(esutil_mix64(seed + 0x9E3779B97F4A7C15ULL)
+                            + esutil_mix64(stream + 1));
+    rng->counter = 0;
+}
+
+static NPY_INLINE double esutil_rng_uniform_at(const struct esutil_rng* rng,
+                                               npy_uint64 n)
+{
+    npy_uint64 r = esutil_mix64(rng->key + (n+1)*0x9E3779B97F4A7C15ULL);
+    return ((double) (r >> 11) + 0.5)*(1.0/9007199254740992.0);
+}
+
+static NPY_INLINE double esutil_rng_uniform(struct esutil_rng* rng)
+{
+    rng->counter += 1;
+    return esutil_rng_uniform_at(rng, rng->counter-1);
+}
+
+#endif
@@ -1,45 +1,54 @@
 #include <iostream>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <pthread.h>
 #include "cgauleg.h"
 #include "numpy/arrayobject.h"
 #include "NumpyVector.h"
+#include "ParallelJobs.h"
 
-PyObject* cgauleg(
-		PyObject* x1var,
-		PyObject* x2var,
-		PyObject* nptsvar) throw (const char *) {
+/*
+   Nodes and weights on [-1,1].  Only the non-negative roots z are stored,
+   in decreasing order, the others following by symmetry
+*/
+struct GaulegNodes {
+    std::vector<double> z;
+    std::vector<double> w;
+};
 
-	// Numpy array converters are the best
-	NumpyVector<double> x1arr(x1var);
-	NumpyVector<double> x2arr(x2var);
-	NumpyVector<npy_intp> nptsarr(nptsvar);
+// above this the nodes are found in O(npts) by following the Legendre ODE
+#define GAULEG_NEWTON_MAXPTS 100
 
-	double x1 = x1arr[0];
-	double x2 = x2arr[0];
-	npy_intp npts = nptsarr[0];
+// the cache is emptied when it would hold more nodes than this
+#define GAULEG_CACHE_MAXPTS 4194304
 
-	NumpyVector<double> x(npts);
-	NumpyVector<double> w(npts);
+/*
+   Newton iteration on the Legendre recurrence for each root, O(npts^2)
+*/
+static void gauleg_newton(npy_intp npts, GaulegNodes& nodes) {
 
-	int i, j, m;
-	double xm, xl, z1, z, p1, p2, p3, pp=0, pi, EPS, abszdiff;
+	npy_intp i, j, m;
+	double z1, z, p1, p2, p3, pp=0, pi, EPS, abszdiff;
 
 	EPS = 4.e-11;
 	pi = 3.141592653589793;
 
 	m = (npts + 1)/2;
+	nodes.z.resize(m);
+	nodes.w.resize(m);
 
-	xm = (x1 + x2)/2.0;
-	xl = (x2 - x1)/2.0;
 	z1 = 0.0;
 
-	for (i=1; i<= m; ++i) 
+	for (i=1; i<= m; ++i)
 	{
 
 		z=cos( pi*(i-0.25)/(npts+.5) );
 
 		abszdiff = fabs(z-z1);
 
-		while (abszdiff > EPS) 
+		while (abszdiff > EPS)
 		{
 			p1 = 1.0;
 			p2 = 0.0;
@@ -57,14 +66,198 @@ PyObject* cgauleg(
 
 		}
 
-		x[i-1] = xm - xl*z;
-		x[npts+1-i-1] = xm + xl*z;
-		w[i-1] = 2.0*xl/( (1.-z*z)*pp*pp );
-		w[npts+1-i-1] = w[i-1];
+		nodes.z[i-1] = z;
+		nodes.w[i-1] = 2.0/( (1.-z*z)*pp*pp );
+	}
+}
+
+/*
+   Step along the solution of the Legendre equation
+
+       (1-x^2) y'' - 2 x y' + n(n+1) y = 0
+
+   from x, where the value and derivative are y and dy, to the root nearest
+   x+h.  The derivatives at x follow from a recurrence, and the Taylor
+   series, in units of h, is solved by Newton's method.  On return x is the
+   root and dy the derivative there.  This is the method of Glaser, Liu and
+   Rokhlin (2007), using asymptotic starting guesses.
+*/
+static void gauleg_ode_step(double nn1,
+                            double& x,
+                            double y,
+                            double& dy,
+                            double h,
+                            std::vector<double>& b) {
+
+    const double tiny = 1.e-18;
+    const double tmax = 1.25;
+    const size_t maxterms = 2000;
+
+    // b[k] = h^k y^(k)(x)/k!
+    double omx2 = 1.0 - x*x;
+    b.resize(2);
+    b[0] = y;
+    b[1] = h*dy;
+    double bmax = std::max(std::fabs(b[0]), std::fabs(b[1]));
+    double tk = tmax;
+    for (size_t k=0; k+2 < maxterms; k++) {
+        double kk = (double) k;
+        double next = ( 2.0*x*(kk+1)*(kk+1)*h*b[k+1]
+                        - (nn1 - kk*(kk+1))*h*h*b[k] )/( omx2*(kk+2)*(kk+1) );
+        b.push_back(next);
+
+        bmax = std::max(bmax, std::fabs(next));
+        tk *= tmax;
+        if ( (std::fabs(b[k+1]) + std::fabs(next))*tk*tmax < tiny*bmax ) {
+            break;
+        }
+    }
+
+    // Newton's method in t = step/h
+    double t = 1.0, dp = 0.0;
+    for (int iter=0; iter<20; iter++) {
+        double p = 0.0;
+        dp = 0.0;
+        for (size_t k=b.size()-1; k>0; k--) {
+            p = p*t + b[k];
+            dp = dp*t + k*b[k];
+        }
+        p = p*t + b[0];
+
+        double dt = p/dp;
+        t -= dt;
+        if (std::fabs(dt) < 1.e-16*std::fabs(t)) {
+            break;
+        }
+    }
+
+    dp = 0.0;
+    for (size_t k=b.size()-1; k>0; k--) {
+        dp = dp*t + k*b[k];
+    }
+    x += t*h;
+    dy = dp/h;
+}
+
+/*
+   O(npts) nodes and weights, following the Legendre equation from x=0 out
+   to the largest root.  The scale of the solution is arbitrary, so the
+   weights are normalized to sum to 2
+*/
+static void gauleg_ode(npy_intp npts, GaulegNodes& nodes) {
+
+    const double pi = 3.141592653589793;
+
+    npy_intp m = (npts + 1)/2;
+    nodes.z.resize(m);
+    nodes.w.resize(m);
+
+    double n = (double) npts;
+    double nn1 = n*(n+1);
+
+    std::vector<double> b;
+
+    double x = 0.0, y, dy;
+    npy_intp i = m;
+    if (npts % 2 == 1) {
+        // zero is a root
+        y = 0.0;
+        dy = 1.0;
+        nodes.z[m-1] = 0.0;
+        nodes.w[m-1] = 1.0;
+        i = m-1;
+    } else {
+        y = 1.0;
+        dy = 0.0;
+    }
+
+    for (; i >= 1; i--) {
+        // Tricomi's asymptotic approximation for root i
+        double theta = pi*(4.0*i - 1.0)/(4.0*n + 2.0);
+        double s = sin(theta);
+        double guess = ( 1.0 - (n - 1.0)/(8.0*n*n*n)
+                         - (39.0 - 28.0/(s*s))/(384.0*n*n*n*n) )*cos(theta);
 
+        gauleg_ode_step(nn1, x, y, dy, guess - x, b);
+        y = 0.0;
 
+        nodes.z[i-1] = x;
+        nodes.w[i-1] = 1.0/( (1.0 - x*x)*dy*dy );
+    }
+
+    double wsum = 0.0;
+    for (i=0; i<m; i++) {
+        wsum += (nodes.z[i] == 0.0) ? nodes.w[i] : 2.0*nodes.w[i];
+    }
+    for (i=0; i<m; i++) {
+        nodes.w[i] *= 2.0/wsum;
+    }
+}
+
+/*
+   The nodes are kept for each npts, since the same npts are typically
+   requested many times.  The nodes for any interval follow from a linear
+   transformation.  The GIL is held while the cache is used
+*/
+static const GaulegNodes& get_gauleg_nodes(npy_intp npts) {
+    static std::map<npy_intp, GaulegNodes> cache;
+    static npy_intp ncached = 0;
+
+    std::map<npy_intp, GaulegNodes>::iterator it = cache.find(npts);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    if (ncached + npts > GAULEG_CACHE_MAXPTS) {
+        cache.clear();
+        ncached = 0;
+    }
+
+    GaulegNodes& nodes = cache[npts];
+    if (npts <= GAULEG_NEWTON_MAXPTS) {
+        gauleg_newton(npts, nodes);
+    } else {
+        gauleg_ode(npts, nodes);
+    }
+    ncached += npts;
+
+    return nodes;
+}
+
+PyObject* cgauleg(
+		PyObject* x1var,
+		PyObject* x2var,
+		PyObject* nptsvar) throw (const char *) {
+
+	// Numpy array converters are the best
+	NumpyVector<double> x1arr(x1var);
+	NumpyVector<double> x2arr(x2var);
+	NumpyVector<npy_intp> nptsarr(nptsvar);
+
+	double x1 = x1arr[0];
+	double x2 = x2arr[0];
+	npy_intp npts = nptsarr[0];
+
+	if (npts < 1) {
+		throw "npts must be > 0";
 	}
 
+	const GaulegNodes& nodes = get_gauleg_nodes(npts);
+
+	NumpyVector<double> x(npts);
+	NumpyVector<double> w(npts);
+
+	double xm = (x1 + x2)/2.0;
+	double xl = (x2 - x1)/2.0;
+
+	npy_intp m = (npts + 1)/2;
+	for (npy_intp i=1; i<= m; ++i) {
+		double z = nodes.z[i-1];
+		x[i-1] = xm - xl*z;
+		x[npts+1-i-1] = xm + xl*z;
+		w[i-1] = xl*nodes.w[i-1];
+		w[npts+1-i-1] = w[i-1];
+	}
 
 	PyObject* output_tuple = PyTuple_New(2);
 	PyTuple_SetItem(output_tuple, 0, x.getref());
@@ -72,3 +265,548 @@ PyObject* cgauleg(
 	return output_tuple;
 }
 
+
+/*
+   Tables of y(x) for each row of a batch.  Row i has the table
+   x[xoff[i]:xoff[i]+nx[i]] and the same for y, which is linearly
+   interpolated as in esutil.stat.interplin, extrapolating beyond the ends
+   of the table.
+*/
+struct Tables {
+    const double* x;
+    const double* y;
+    std::vector<npy_int64> xoff;
+    std::vector<npy_int64> yoff;
+    std::vector<npy_int64> nx;
+
+    // interpolate the table for row to u, using a binary search
+    inline double interp(npy_intp row, double u) const {
+        const double* xr = x + xoff[row];
+        const double* yr = y + yoff[row];
+        npy_intp n = nx[row];
+
+        npy_intp i = (std::lower_bound(xr, xr+n, u) - xr) - 1;
+        if (i < 0) {
+            i = 0;
+        } else if (i > n-2) {
+            i = n-2;
+        }
+        return (u - xr[i])*(yr[i+1] - yr[i])/(xr[i+1] - xr[i]) + yr[i];
+    }
+};
+
+static bool is_contiguous(NumpyVector<double>& vec) {
+    return vec.size() <= 1 || vec.stride() == sizeof(double);
+}
+
+/*
+   Get the layout of the tables.  If offsets is None, the tables share the
+   grid xvals and yvals holds either one table or one for each row.
+   Otherwise row i is xvals[offsets[i]:offsets[i+1]] and the same for yvals.
+*/
+static void get_tables(npy_intp nrow,
+                       NumpyVector<double>& xvals,
+                       NumpyVector<double>& yvals,
+                       PyObject* offsets_pyobj,
+                       Tables& tables) throw (const char *) {
+
+    if (!is_contiguous(xvals) || !is_contiguous(yvals)) {
+        throw "arrays must be contiguous";
+    }
+
+    tables.xoff.resize(nrow);
+    tables.yoff.resize(nrow);
+    tables.nx.resize(nrow);
+
+    if (offsets_pyobj != NULL && offsets_pyobj != Py_None) {
+        // CSR layout, a table for each row
+        NumpyVector<npy_int64> offsets(offsets_pyobj);
+        if (offsets.size() != nrow+1) {
+            throw "offsets must have one more element than x1";
+        }
+        if (yvals.size() != xvals.size()) {
+            throw "xvals and yvals must be the same size";
+        }
+        for (npy_intp row=0; row<nrow; row++) {
+            npy_int64 o1 = offsets[row], o2 = offsets[row+1];
+            if (o1 < 0 || o2 > xvals.size() || o2 < o1) {
+                throw "offsets out of range";
+            }
+            tables.xoff[row] = tables.yoff[row] = o1;
+            tables.nx[row] = o2-o1;
+        }
+    } else {
+        // a shared grid, with either one table or a table for each row
+        npy_intp n = xvals.size();
+        bool shared = (yvals.size() == n);
+        if (!shared && yvals.size() != nrow*n) {
+            throw "yvals must be the size of xvals, or nrow times that";
+        }
+        for (npy_intp row=0; row<nrow; row++) {
+            tables.xoff[row] = 0;
+            tables.yoff[row] = shared ? 0 : row*n;
+            tables.nx[row] = n;
+        }
+    }
+
+    tables.x = xvals.ptr();
+    tables.y = yvals.ptr();
+    for (npy_intp row=0; row<nrow; row++) {
+        if (tables.nx[row] < 2) {
+            throw "tables must have at least two points";
+        }
+        const double* xr = tables.x + tables.xoff[row];
+        for (npy_intp i=1; i<tables.nx[row]; i++) {
+            if (!(xr[i] >= xr[i-1])) {
+                throw "xvals must be non-decreasing";
+            }
+        }
+    }
+}
+
+static long limit_threads(long nthreads, npy_intp nrow) {
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > nrow) {
+        nthreads = nrow > 0 ? nrow : 1;
+    }
+    return nthreads;
+}
+
+/*
+   Gauss-legendre integration of the tables over many intervals.
+*/
+struct GLBatchJob {
+    // nodes and weights on [-1,1], in increasing order
+    const double* t;
+    const double* tw;
+    npy_intp npts;
+
+    const double* x1;
+    const double* x2;
+    const Tables* tables;
+
+    npy_intp start;
+    npy_intp end;
+    double* result;
+
+    static void* run(void* arg) {
+        GLBatchJob* job = (GLBatchJob*) arg;
+        job->integrate();
+        return NULL;
+    }
+
+    void integrate() {
+        for (npy_intp row=start; row<end; row++) {
+            const double* xr = tables->x + tables->xoff[row];
+            const double* yr = tables->y + tables->yoff[row];
+            npy_intp n = tables->nx[row];
+
+            double xm = (x1[row] + x2[row])/2.0;
+            double xl = (x2[row] - x1[row])/2.0;
+
+            // the nodes are visited in increasing x, so the interval in the
+            // table is found by a sweep
+            double isum = 0.0;
+            npy_intp i = 0;
+            for (npy_intp jj=0; jj<npts; jj++) {
+                npy_intp j = (xl >= 0) ? jj : npts-1-jj;
+                double u = xm + xl*t[j];
+
+                while (i < n-2 && xr[i+1] < u) {
+                    i++;
+                }
+                double yi = (u - xr[i])*(yr[i+1] - yr[i])/(xr[i+1] - xr[i]) + yr[i];
+                isum += yi*tw[j];
+            }
+            result[row] = xl*isum;
+        }
+    }
+};
+
+PyObject* cgauleg_integrate_data(
+        PyObject* x1_pyobj,
+        PyObject* x2_pyobj,
+        PyObject* xvals_pyobj,
+        PyObject* yvals_pyobj,
+        PyObject* offsets_pyobj,
+        long npts,
+        long nthreads) throw (const char *) {
+
+    if (npts < 1) {
+        throw "npts must be > 0";
+    }
+
+    NumpyVector<double> x1(x1_pyobj);
+    NumpyVector<double> x2(x2_pyobj);
+    NumpyVector<double> xvals(xvals_pyobj);
+    NumpyVector<double> yvals(yvals_pyobj);
+
+    npy_intp nrow = x1.size();
+    if (x2.size() != nrow) {
+        throw "x1 and x2 must be the same size";
+    }
+    if (!is_contiguous(x1) || !is_contiguous(x2)) {
+        throw "arrays must be contiguous";
+    }
+
+    Tables tables;
+    get_tables(nrow, xvals, yvals, offsets_pyobj, tables);
+
+    const GaulegNodes& nodes = get_gauleg_nodes(npts);
+    std::vector<double> t(npts), tw(npts);
+    npy_intp m = (npts + 1)/2;
+    for (npy_intp i=1; i<= m; ++i) {
+        t[i-1] = -nodes.z[i-1];
+        t[npts-i] = nodes.z[i-1];
+        tw[i-1] = nodes.w[i-1];
+        tw[npts-i] = nodes.w[i-1];
+    }
+
+    NumpyVector<double> result(nrow);
+
+    nthreads = limit_threads(nthreads, nrow);
+    std::vector<GLBatchJob> jobs(nthreads);
+    npy_intp chunksize = nrow/nthreads;
+    for (long th=0; th<nthreads; th++) {
+        GLBatchJob& job = jobs[th];
+        job.t = &t[0];
+        job.tw = &tw[0];
+        job.npts = npts;
+        job.x1 = x1.ptr();
+        job.x2 = x2.ptr();
+        job.tables = &tables;
+        job.start = th*chunksize;
+        job.end = (th == nthreads-1) ? nrow : (th+1)*chunksize;
+        job.result = result.ptr();
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    return result.getref();
+}
+
+/*
+   Adaptive gauss-kronrod integration.
+
+   Each interval is integrated with the kronrod rule, and the difference
+   from the embedded gauss rule is used as the error estimate, as in
+   cosmolib.  For each task the subinterval with the largest error is
+   bisected until the total error is below the tolerance, or the maximum
+   number of subintervals is reached.  The tasks are taken from a shared
+   queue, so threads that get easy tasks move on to others while the hard
+   ones are refined.
+
+   The nodes and weights are from QUADPACK qk15 and qk21.  The last node is
+   the center, and the gauss nodes are the odd numbered kronrod nodes plus,
+   for the 7 point rule, the center.
+*/
+
+static const double gk15_x[8] = {
+    0.991455371120812639206854697526329,
+    0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926,
+    0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013,
+    0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245,
+    0.000000000000000000000000000000000
+};
+static const double gk15_wk[8] = {
+    0.022935322010529224963732008058970,
+    0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518,
+    0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550,
+    0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649,
+    0.209482141084727828012999174891714
+};
+static const double gk15_wg[4] = {
+    0.129484966168869693270611432679082,
+    0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975,
+    0.417959183673469387755102040816327
+};
+
+static const double gk21_x[11] = {
+    0.995657163025808080735527280689003,
+    0.973906528517171720077964012084452,
+    0.930157491355708226001207180059508,
+    0.865063366688984510732096688423493,
+    0.780817726586416897063717578345042,
+    0.679409568299024406234327365114874,
+    0.562757134668604683339000099272694,
+    0.433395394129247190799265943165784,
+    0.294392862701460198131126603103866,
+    0.148874338981631210884826001129720,
+    0.000000000000000000000000000000000
+};
+static const double gk21_wk[11] = {
+    0.011694638867371874278064396062192,
+    0.032558162307964727478818972459390,
+    0.054755896574351996031381300244580,
+    0.075039674810919952767043140916190,
+    0.093125454583697605535065465083366,
+    0.109387158802297641899210590325805,
+    0.123491976262065851077208768244386,
+    0.134709217311473325928054001771707,
+    0.142775938577060080797094273138717,
+    0.147739104901338491374841515972068,
+    0.149445554002916905664936468389821
+};
+static const double gk21_wg[5] = {
+    0.066671344308688137593568809893332,
+    0.149451349150580593145776339657697,
+    0.219086362515982043995534934228163,
+    0.269266719309996355091226921569469,
+    0.295524224714752870173892994651338
+};
+
+struct GKRule {
+    int nx;            // number of kronrod nodes including the center
+    const double* x;
+    const double* wk;
+    const double* wg;
+    bool gauss_center; // the center is also a gauss node
+};
+
+struct GKInterval {
+    double a;
+    double b;
+    double result;
+    double err;
+
+    bool operator<(const GKInterval& other) const {
+        return err < other.err;
+    }
+};
+
+/*
+   The shared queue of tasks.  Tasks are handed out a few at a time
+*/
+struct GKQueue {
+    pthread_mutex_t lock;
+    npy_intp next;
+    npy_intp ntask;
+    npy_intp chunk;
+
+    bool get(npy_intp* start, npy_intp* end) {
+        bool ok;
+        pthread_mutex_lock(&lock);
+        *start = next;
+        *end = std::min(next+chunk, ntask);
+        next = *end;
+        ok = (*start < *end);
+        pthread_mutex_unlock(&lock);
+        return ok;
+    }
+};
+
+struct GKAdaptJob {
+    const GKRule* rule;
+    const Tables* tables;
+    const double* x1;
+    const double* x2;
+    double epsabs;
+    double epsrel;
+    long maxsub;
+
+    GKQueue* queue;
+
+    double* result;
+    double* err;
+    npy_int64* neval;
+
+    static void* run(void* arg) {
+        GKAdaptJob* job = (GKAdaptJob*) arg;
+        job->integrate();
+        return NULL;
+    }
+
+    void rule_eval(npy_intp row, GKInterval& iv) const {
+        double center = 0.5*(iv.a + iv.b);
+        double hlength = 0.5*(iv.b - iv.a);
+        int nc = rule->nx-1;
+
+        double fc = tables->interp(row, center);
+        double resk = fc*rule->wk[nc];
+        double resg = rule->gauss_center ? fc*rule->wg[nc/2] : 0.0;
+        for (int i=0; i<nc; i++) {
+            double f1 = tables->interp(row, center - hlength*rule->x[i]);
+            double f2 = tables->interp(row, center + hlength*rule->x[i]);
+            double fsum = f1+f2;
+            resk += rule->wk[i]*fsum;
+            if (i % 2 == 1) {
+                resg += rule->wg[i/2]*fsum;
+            }
+        }
+
+        iv.result = resk*hlength;
+        iv.err = std::fabs((resk-resg)*hlength);
+    }
+
+    void integrate_row(npy_intp row, std::vector<GKInterval>& heap) {
+        int nperrule = 2*rule->nx-1;
+
+        GKInterval iv;
+        iv.a = x1[row];
+        iv.b = x2[row];
+        rule_eval(row, iv);
+
+        heap.clear();
+        heap.push_back(iv);
+
+        double total = iv.result, toterr = iv.err;
+        npy_int64 nev = nperrule;
+        while (toterr > std::max(epsabs, epsrel*std::fabs(total))
+                && (long) heap.size() < maxsub) {
+
+            // bisect the interval with the largest error
+            std::pop_heap(heap.begin(), heap.end());
+            GKInterval worst = heap.back();
+            heap.pop_back();
+
+            double m = 0.5*(worst.a + worst.b);
+            if (m == worst.a || m == worst.b) {
+                // cannot be divided further
+                heap.push_back(worst);
+                std::push_heap(heap.begin(), heap.end());
+                break;
+            }
+
+            GKInterval left, right;
+            left.a = worst.a;
+            left.b = m;
+            right.a = m;
+            right.b = worst.b;
+            rule_eval(row, left);
+            rule_eval(row, right);
+            nev += 2*nperrule;
+
+            total += left.result + right.result - worst.result;
+            toterr += left.err + right.err - worst.err;
+
+            heap.push_back(left);
+            std::push_heap(heap.begin(), heap.end());
+            heap.push_back(right);
+            std::push_heap(heap.begin(), heap.end());
+        }
+
+        // sum again to avoid roundoff from the updates
+        total = 0.0;
+        toterr = 0.0;
+        for (size_t i=0; i<heap.size(); i++) {
+            total += heap[i].result;
+            toterr += heap[i].err;
+        }
+        result[row] = total;
+        err[row] = toterr;
+        neval[row] = nev;
+    }
+
+    void integrate() {
+        std::vector<GKInterval> heap;
+        npy_intp start, end;
+        while (queue->get(&start, &end)) {
+            for (npy_intp row=start; row<end; row++) {
+                integrate_row(row, heap);
+            }
+        }
+    }
+};
+
+PyObject* cgauleg_integrate_adaptive(
+        PyObject* x1_pyobj,
+        PyObject* x2_pyobj,
+        PyObject* xvals_pyobj,
+        PyObject* yvals_pyobj,
+        PyObject* offsets_pyobj,
+        double epsabs,
+        double epsrel,
+        long maxsub,
+        long rule_npts,
+        long nthreads) throw (const char *) {
+
+    GKRule rule;
+    if (rule_npts == 15) {
+        rule.nx = 8;
+        rule.x = gk15_x;
+        rule.wk = gk15_wk;
+        rule.wg = gk15_wg;
+        rule.gauss_center = true;
+    } else if (rule_npts == 21) {
+        rule.nx = 11;
+        rule.x = gk21_x;
+        rule.wk = gk21_wk;
+        rule.wg = gk21_wg;
+        rule.gauss_center = false;
+    } else {
+        throw "rule must be 15 or 21";
+    }
+    if (maxsub < 1) {
+        throw "maxsub must be > 0";
+    }
+    if (epsabs <= 0 && epsrel <= 0) {
+        throw "one of epsabs or epsrel must be > 0";
+    }
+
+    NumpyVector<double> x1(x1_pyobj);
+    NumpyVector<double> x2(x2_pyobj);
+    NumpyVector<double> xvals(xvals_pyobj);
+    NumpyVector<double> yvals(yvals_pyobj);
+
+    npy_intp nrow = x1.size();
+    if (x2.size() != nrow) {
+        throw "x1 and x2 must be the same size";
+    }
+    if (!is_contiguous(x1) || !is_contiguous(x2)) {
+        throw "arrays must be contiguous";
+    }
+
+    Tables tables;
+    get_tables(nrow, xvals, yvals, offsets_pyobj, tables);
+
+    NumpyVector<double> result(nrow);
+    NumpyVector<double> err(nrow);
+    NumpyVector<npy_int64> neval(nrow);
+
+    nthreads = limit_threads(nthreads, nrow);
+
+    GKQueue queue;
+    pthread_mutex_init(&queue.lock, NULL);
+    queue.next = 0;
+    queue.ntask = nrow;
+    queue.chunk = std::max((npy_intp) 1, std::min((npy_intp) 64, nrow/(8*nthreads)));
+
+    std::vector<GKAdaptJob> jobs(nthreads);
+    for (long th=0; th<nthreads; th++) {
+        GKAdaptJob& job = jobs[th];
+        job.rule = &rule;
+        job.tables = &tables;
+        job.x1 = x1.ptr();
+        job.x2 = x2.ptr();
+        job.epsabs = epsabs;
+        job.epsrel = epsrel;
+        job.maxsub = maxsub;
+        job.queue = &queue;
+        job.result = result.ptr();
+        job.err = err.ptr();
+        job.neval = neval.ptr();
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    pthread_mutex_destroy(&queue.lock);
+
+    PyObject* output_tuple = PyTuple_New(3);
+    PyTuple_SetItem(output_tuple, 0, result.getref());
+    PyTuple_SetItem(output_tuple, 1, err.getref());
+    PyTuple_SetItem(output_tuple, 2, neval.getref());
+    return output_tuple;
+}
@@ -15,5 +15,40 @@ PyObject* cgauleg(
         PyObject* x2var,
         PyObject* nptsvar) throw (const char *);
 
+// Gauss-legendre integrals of tabulated functions over many intervals
+// [x1[i],x2[i]], in one call.  The tables are linearly interpolated to the
+// nodes, extrapolating beyond the ends as in esutil.stat.interplin.  If
+// offsets is None, the tables share the grid xvals and yvals holds either
+// one table or one for each interval, concatenated.  Otherwise row i is
+// xvals[offsets[i]:offsets[i+1]] and the same for yvals.  The nodes come
+// from the cache used by cgauleg.  The intervals are split over nthreads
+// threads.
+PyObject* cgauleg_integrate_data(
+        PyObject* x1_pyobj,
+        PyObject* x2_pyobj,
+        PyObject* xvals_pyobj,
+        PyObject* yvals_pyobj,
+        PyObject* offsets_pyobj,
+        long npts,
+        long nthreads) throw (const char *);
+// Adaptive gauss-kronrod integrals of tabulated functions over many
+// intervals, with the tables laid out as for cgauleg_integrate_data.  rule
+// is 15 or 21 for the G7K15 or G10K21 rule.  For each interval the
+// subinterval with the largest error is bisected until the error estimate
+// is below max(epsabs, epsrel*|result|) or there are maxsub subintervals.
+// The intervals are taken from a queue shared by nthreads threads.  Returns
+// a tuple (result, err, neval) with the number of function evaluations for
+// each interval.
+PyObject* cgauleg_integrate_adaptive(
+        PyObject* x1_pyobj,
+        PyObject* x2_pyobj,
+        PyObject* xvals_pyobj,
+        PyObject* yvals_pyobj,
+        PyObject* offsets_pyobj,
+        double epsabs,
+        double epsrel,
+        long maxsub,
+        long rule,
+        long nthreads) throw (const char *);
 
 #endif
@@ -51,3 +51,9 @@ del types
 cgauleg = _cgauleg.cgauleg
 
 
+cgauleg_integrate_data = _cgauleg.cgauleg_integrate_data
+
+
+cgauleg_integrate_adaptive = _cgauleg.cgauleg_integrate_adaptive
+
+
@@ -0,0 +1,218 @@
+import esutil
+import numpy
+from numpy import where
+
+def gauleg_newton(npts):
+    """
+    Nodes and weights on [-1,1] by newton iteration on the legendre
+    recurrence for all roots at once.  This is the method used by the C++
+    code for npts <= 100
+    """
+    m = (npts + 1)/2
+    i = numpy.arange(1, m+1, dtype='f8')
+    z = numpy.cos( numpy.pi*(i-0.25)/(npts+.5) )
+
+    for it in xrange(100):
+        p1 = numpy.ones(m)
+        p2 = numpy.zeros(m)
+        for j in xrange(1, npts+1):
+            p3 = p2
+            p2 = p1
+            p1 = ( (2.0*j - 1.0)*z*p2 - (j-1.0)*p3 )/j
+        pp = npts*(z*p1 - p2)/(z*z - 1.)
+        dz = p1/pp
+        z = z - dz
+        if numpy.abs(dz).max() < 1.e-15:
+            break
+
+    w = 2.0/( (1.-z*z)*pp*pp )
+
+    x = numpy.zeros(npts)
+    wall = numpy.zeros(npts)
+    x[0:m] = -z
+    x[npts-m:] = z[::-1]
+    wall[0:m] = w
+    wall[npts-m:] = w[::-1]
+    return x, wall
+
+def test_gauleg():
+    """
+    The nodes above 100 points are found by following the legendre ODE.
+    Compare to newton iteration, and check that polynomials are integrated
+    exactly
+    """
+    print 'Testing gauleg'
+
+    nbad=0
+    for npts in [10, 100, 101, 1000]:
+        x,w = esutil.integrate.gauleg(-1.0, 1.0, npts)
+        xn,wn = gauleg_newton(npts)
+
+        if numpy.abs(x-xn).max() > 1.e-13:
+            print '  npts=%s nodes differ from newton' % npts
+            nbad += 1
+        if (numpy.abs(w-wn)/wn).max() > 1.e-11:
+            print '  npts=%s weights differ from newton' % npts
+            nbad += 1
+
+        # exact for polynomials up to degree 2*npts-1
+        for k in xrange(0, npts):
+            isum = (w*x**(2*k)).sum()
+            expected = 2.0/(2*k+1)
+            if abs(isum-expected) > 1.e-11*expected:
+                print '  npts=%s x^%s integral %s expected %s' % \
+                        (npts,2*k,isum,expected)
+                nbad += 1
+                break
+
+        # the nodes scale to any interval
+        xs,ws = esutil.integrate.gauleg(2.0, 5.0, npts)
+        if (numpy.abs(xs - (3.5 + 1.5*x)).max() > 1.e-12
+                or numpy.abs(ws - 1.5*w).max() > 1.e-12):
+            print '  npts=%s nodes not scaled' % npts
+            nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_integrate_data_batch():
+    """
+    Compare the batch integration to QGauss.integrate_data for each row,
+    with a shared grid and table, a shared grid with a table for each row,
+    and tables given by offsets
+    """
+    print 'Testing integrate_data_batch'
+
+    npts=30
+    qg = esutil.integrate.QGauss(npts)
+
+    nrow=50
+    x = numpy.linspace(0.0, 2.0, 40)
+    y2d = numpy.random.random( (nrow, x.size) )
+
+    # tables of different sizes and ranges
+    sizes = numpy.random.randint(2, 60, nrow)
+    offsets = numpy.zeros(nrow+1, dtype='i8')
+    offsets[1:] = sizes.cumsum()
+    xcsr = numpy.zeros(offsets[-1])
+    ycsr = numpy.random.random(offsets[-1])
+    for i in xrange(nrow):
+        x1 = numpy.random.random()
+        xcsr[offsets[i]:offsets[i+1]] = \
+                x1 + numpy.sort(numpy.random.random(sizes[i]))
+    x1csr = xcsr[offsets[0:nrow]]
+    x2csr = xcsr[offsets[1:]-1]
+
+    nbad=0
+    for nthreads in [1,3]:
+        # shared grid and table
+        res = qg.integrate_data_batch(x[0], x[-1], x, y2d[0],
+                                      nthreads=nthreads)
+        expected = qg.integrate_data(x, y2d[0])
+        if res.size != 1 or abs(res[0]-expected) > 1.e-12:
+            print '  shared table differs'
+            nbad += 1
+
+        # shared grid with a table for each row
+        res = qg.integrate_data_batch(x[0], x[-1], x, y2d,
+                                      nthreads=nthreads)
+        for i in xrange(nrow):
+            expected = qg.integrate_data(x, y2d[i])
+            if abs(res[i]-expected) > 1.e-12:
+                print '  row %s of 2-d table differs' % i
+                nbad += 1
+
+        # tables from offsets
+        res = qg.integrate_data_batch(x1csr, x2csr, xcsr, ycsr,
+                                      offsets=offsets, nthreads=nthreads)
+        for i in xrange(nrow):
+            xi = xcsr[offsets[i]:offsets[i+1]]
+            yi = ycsr[offsets[i]:offsets[i+1]]
+            expected = qg.integrate_data(xi, yi)
+            if abs(res[i]-expected) > 1.e-12:
+                print '  row %s of offset tables differs' % i
+                nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_integrate_adaptive():
+    """
+    Check integrate_adaptive against the exact integral of the linearly
+    interpolated tables, and that the results do not depend on the number
+    of threads
+    """
+    print 'Testing integrate_adaptive'
+
+    nbad=0
+
+    # a linear table is integrated exactly by the first rule evaluation
+    x = numpy.array([-1.0, 3.0])
+    y = 2.0 + 0.5*x
+    x1 = -1.0 + 2.0*numpy.random.random(100)
+    x2 = x1 + 2.0*numpy.random.random(100)
+    expected = 2.0*(x2-x1) + 0.25*(x2**2 - x1**2)
+    for rule in [15,21]:
+        res,err,neval = esutil.integrate.integrate_adaptive(x1, x2, x, y,
+                                                            rule=rule)
+        if (numpy.abs(res-expected).max() > 1.e-13
+                or err.max() > 1.e-13 or (neval != rule).any()):
+            print '  linear table wrong for rule %s' % rule
+            nbad += 1
+
+    # the kinks of tables on a grid of k/16 are reached by bisecting
+    # [0,1], after which each subinterval is integrated exactly
+    nrow=100
+    x = numpy.arange(17)/16.
+    y = numpy.random.random( (nrow, x.size) )
+    expected = numpy.zeros(nrow)
+    for i in xrange(nrow):
+        expected[i] = numpy.trapz(y[i], x)
+    for rule in [15,21]:
+        res,err,neval = esutil.integrate.integrate_adaptive(0.0, 1.0, x, y,
+                                                            epsrel=1.e-10,
+                                                            rule=rule)
+        w, = where( (numpy.abs(res-expected) > err + 1.e-13)
+                   | (err > 1.e-10*numpy.abs(expected)) )
+        if w.size != 0:
+            print '  %s kinked tables wrong for rule %s' % (w.size,rule)
+            nbad += 1
+
+    # many intervals that stop at maxsub, with tables from offsets
+    sizes = numpy.random.randint(2, 30, nrow)
+    offsets = numpy.zeros(nrow+1, dtype='i8')
+    offsets[1:] = sizes.cumsum()
+    x = numpy.zeros(offsets[-1])
+    y = numpy.random.random(offsets[-1])
+    for i in xrange(nrow):
+        x[offsets[i]:offsets[i+1]] = numpy.sort(numpy.random.random(sizes[i]))
+    x1 = x[offsets[0:nrow]]
+    x2 = x[offsets[1:]-1]
+
+    res1,err1,neval1 = esutil.integrate.integrate_adaptive(
+            x1, x2, x, y, offsets=offsets, epsrel=1.e-12, maxsub=20)
+    for nthreads in [2,3,8]:
+        res,err,neval = esutil.integrate.integrate_adaptive(
+                x1, x2, x, y, offsets=offsets, epsrel=1.e-12, maxsub=20,
+                nthreads=nthreads)
+        if ((res != res1).any() or (err != err1).any()
+                or (neval != neval1).any()):
+            print '  results differ for nthreads=%s' % nthreads
+            nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+if __name__=='__main__':
+    test_gauleg()
+    test_integrate_data_batch()
+    test_integrate_adaptive()
@@ -12,6 +12,9 @@ Classes:
 Functions:
     gauleg:
         Calculate the weights and abscissa for Gauss-Legendre integration.
+    integrate_adaptive:
+        Adaptive Gauss-Kronrod integration of tabulated data over many
+        intervals.
 """
 license="""
   Copyright (C) 2010  Erin Sheldon
@@ -65,6 +68,8 @@ class QGauss:
 
     Methods:
         integrate: Perform the integration.
+        integrate_data_batch: Integrate tabulated data over many intervals
+            in a single call.
     Examples:
         from esutil.integrate import QGauss
         npoints = 30
@@ -153,6 +158,47 @@ class QGauss:
         isum = integrand.sum()
         return f1*isum
 
+    def integrate_data_batch(self, x1, x2, xvals, yvals, offsets=None,
+                             npts=None, nthreads=1):
+        """
+        Integrate tabulated data over many intervals in one call
+
+        The integral of row i is over [x1[i],x2[i]], with the table linearly
+        interpolated to the gauss-legendre points as in integrate_data.
+        The work is done in C++, and the rows are split over threads.
+
+        parameters
+        ----------
+        x1,x2: arrays or scalars
+            The limits of the intervals.  Scalars are used for all rows.
+        xvals,yvals: arrays
+            The tables.  If offsets is not sent, xvals is a grid shared by
+            all rows, and yvals is either a single table on that grid or a
+            2-d array with a table for each row.  If offsets are sent row i
+            is xvals[offsets[i]:offsets[i+1]] and the same for yvals.  The
+            xvals must be increasing within each table.
+        offsets: array, optional
+            The offsets of the tables for each row, with nrow+1 elements.
+        npts: int, optional
+            The number of points, if not set on construction.
+        nthreads: int, optional
+            The number of threads to use, default 1.
+
+        returns
+        -------
+        An array with the integral for each row.
+        """
+        self.setup(npts=npts)
+        if self.npts is None:
+            raise ValueError("Set npts on construction or in this call")
+        if not have_cgauleg:
+            raise ValueError("gauleg C++ extension not found")
+
+        x1,x2,xvals,yvals,offsets = \
+                _get_batch_args(x1, x2, xvals, yvals, offsets)
+        return cgauleg.cgauleg_integrate_data(x1, x2, xvals, yvals, offsets,
+                                              int(self.npts), int(nthreads))
+
     def test_gauss_data(self, npts=None):
         mean = 0.0
         sigma = 1.0
@@ -199,6 +245,84 @@ class QGauss:
         return gauss
 
 
+def integrate_adaptive(x1, x2, xvals, yvals, offsets=None,
+                       epsabs=0.0, epsrel=1.e-8, maxsub=100, rule=21,
+                       nthreads=1):
+    """
+    Adaptive gauss-kronrod integration of tabulated data over many intervals
+
+    For each interval the integral is estimated with the kronrod rule, and
+    the error from the difference with the embedded gauss rule.  The
+    subinterval with the largest error is bisected until the error is below
+    max(epsabs, epsrel*|result|), so only the hard integrals get extra
+    evaluations.  The tables are linearly interpolated, as for
+    QGauss.integrate_data_batch.  The intervals are taken from a queue
+    shared by the threads.
+
+    Note the error estimate can be optimistic near the kinks of a coarsely
+    tabulated function.
+
+    parameters
+    ----------
+    x1,x2: arrays or scalars
+        The limits of the intervals.  Scalars are used for all rows.
+    xvals,yvals: arrays
+        The tables, see QGauss.integrate_data_batch
+    offsets: array, optional
+        The offsets of the tables for each row, with nrow+1 elements.
+    epsabs,epsrel: float, optional
+        The absolute and relative tolerance.  Defaults 0 and 1.e-8
+    maxsub: int, optional
+        The maximum number of subintervals for each integral, default 100
+    rule: int, optional
+        15 or 21 for the G7K15 or G10K21 rule, default 21
+    nthreads: int, optional
+        The number of threads to use, default 1.
+
+    returns
+    -------
+    result,err,neval: arrays with the integral, error estimate and number
+    of function evaluations for each interval.
+    """
+    if not have_cgauleg:
+        raise ValueError("gauleg C++ extension not found")
+
+    x1,x2,xvals,yvals,offsets = \
+            _get_batch_args(x1, x2, xvals, yvals, offsets)
+    return cgauleg.cgauleg_integrate_adaptive(x1, x2, xvals, yvals, offsets,
+                                              float(epsabs), float(epsrel),
+                                              int(maxsub), int(rule),
+                                              int(nthreads))
+
+def _get_batch_args(x1, x2, xvals, yvals, offsets):
+    x1 = numpy.array(x1, ndmin=1, dtype='f8', copy=False)
+    x2 = numpy.array(x2, ndmin=1, dtype='f8', copy=False)
+    yvals = numpy.array(yvals, ndmin=1, dtype='f8', copy=False)
+
+    if offsets is None and yvals.ndim == 2:
+        nrow = yvals.shape[0]
+    elif offsets is not None:
+        nrow = len(offsets)-1
+    else:
+        nrow = max(x1.size, x2.size)
+
+    if x1.size == 1:
+        x1 = x1.repeat(nrow)
+    if x2.size == 1:
+        x2 = x2.repeat(nrow)
+    if x1.size != nrow or x2.size != nrow:
+        raise ValueError("expected %d intervals, got x1,x2 sizes "
+                         "%d,%d" % (nrow, x1.size, x2.size))
+
+    if offsets is not None:
+        offsets = numpy.ascontiguousarray(offsets, dtype='i8')
+
+    return (numpy.ascontiguousarray(x1),
+            numpy.ascontiguousarray(x2),
+            numpy.ascontiguousarray(xvals, dtype='f8').ravel(),
+            numpy.ascontiguousarray(yvals).ravel(),
+            offsets)
+
 def gauleg(x1, x2, npts):
     """
     NAME:
@@ -214,6 +338,9 @@ def gauleg(x1, x2, npts):
       x1,x2: The range for the integration.
       npts: Number of points to use in the integration.
 
+    The nodes and weights are cached for each npts.  For npts > 100 they
+    are calculated in O(npts) time, so large npts are practical.
+
     REVISION HISTORY:
       Created: 2010-04-18. Use the new C++ extension and only 
       drop back to python only version if necessary.
@@ -7,7 +7,8 @@ functions:
         Generate random numbers in the symmetric distribution [-1,1]
     cholesky_sample
         sample a multivariate covariant distribution using cholesky
-        decomposition.  Uses the CholeskySampler
+        decomposition.  Uses the CholeskySampler, and also takes a stack
+        of covariance matrices
     random_indices:
         Get a unique random selection of indices in [0,imax)
 
@@ -64,7 +65,7 @@ class Generator(object):
                                           method='accum', cumulative=False, seed=None)
 
         r = gen.genrand(num)
-        r = gen.genrand(num, seed=None)
+        r = gen.genrand(num, seed=None, nthreads=1)
 
     Inputs:
         pofx: Either an array of points or a function.  If p(x) is an array sample
@@ -97,6 +98,20 @@ class Generator(object):
             Note for method='cut' this is ignored: you must enter the differential 
             distribution.
 
+    Notes:
+        The randoms are drawn in C, from tables made once at construction.
+        For method='accum' this is the inverse of the cumulative distribution
+        with a guide table for the lookup.  For method='cut' with an array
+        p(x) and increasing x, the cut is not needed: the linear
+        interpolation of p(x) is sampled directly, choosing the segment from
+        a Walker alias table.  Only a function p(x) with method='cut' uses
+        the rejection loop.
+
+        The native sampler uses a counter based generator, so the result for
+        a given seed does not depend on the number of threads.  When no seed
+        is given, one is drawn from numpy.random, so numpy.random.seed still
+        makes the output reproducible.
+
 
     Examples:
 
@@ -192,6 +207,8 @@ class Generator(object):
 
 
 
+        self.initialize_tables()
+
         if seed is not None:
             numpy.random.seed(seed=seed)
 
@@ -202,7 +219,7 @@ class Generator(object):
 
 
 
-    def genrand(self, numrand, seed=None):
+    def genrand(self, numrand, seed=None, nthreads=1, stream=0):
         """
         Class:
             random.Genrand
@@ -216,29 +233,50 @@ class Generator(object):
             # see docs on Genrand for info about constructor.
             generator = esutil.random.Generator(pofx, ...)
 
-            rand = generator.genrand(numrand)
+            rand = generator.genrand(numrand, seed=None, nthreads=1, stream=0)
+
+        Optional Inputs:
+            seed: Seed for the random number generator.  If None, a seed is
+                drawn from numpy.random.
+            nthreads: Number of threads used by the native sampler.  The
+                result does not depend on nthreads.
+            stream: Stream of the native generator.  Different streams with
+                the same seed give independent randoms, for example for
+                different processes.  Default 0.
 
         """
         if self.method == 'accum':
-            return self.genrand_accum(numrand, seed=None)
+            return self.genrand_accum(numrand, seed=seed,
+                                      nthreads=nthreads, stream=stream)
         elif self.method == 'cut':
-            return self.genrand_cut(numrand, seed=None)
-
-    def genrand_accum(self, numrand, seed=None):
-        if seed is not None:
-            numpy.random.seed(seed=seed)
+            return self.genrand_cut(numrand, seed=seed,
+                                    nthreads=nthreads, stream=stream)
 
-        # this returns f8
-        urand = numpy.random.random(numrand)
+    def genrand_accum(self, numrand, seed=None, nthreads=1, stream=0):
 
         # to get randoms from the distribution, we interpolate the x(pcum) at
-        # the test rand values.  Clever!
-        rand = stat.interplin(self.xvals, self.pcum, urand)
-
-        return rand
-
-
-    def genrand_cut(self, numrand, seed=None):
+        # uniform random values.  This is the same as
+        #   interplin(xvals, pcum, numpy.random.random(numrand))
+        # but the interval is found from the guide table
+        seed = self._get_native_seed(seed)
+        return stat._stat_util.sample_invcdf(self.xvals_native,
+                                             self.pcum_native,
+                                             self.guide,
+                                             int(numrand), seed, int(stream),
+                                             int(nthreads))
+
+
+    def genrand_cut(self, numrand, seed=None, nthreads=1, stream=0):
+
+        if self.alias_prob is not None:
+            # sample the interpolated p(x) directly, no cut needed
+            seed = self._get_native_seed(seed)
+            return stat._stat_util.sample_pwlinear(self.xinput_native,
+                                                   self.pofx_native,
+                                                   self.alias_prob,
+                                                   self.alias,
+                                                   int(numrand), seed,
+                                                   int(stream), int(nthreads))
 
         if seed is not None:
             numpy.random.seed(seed=seed)
@@ -284,9 +322,42 @@ class Generator(object):
             # for the point distribution, we have scaled versions of the
             # input x and y.  This will save some computation, but we have
             # to interpolate
-            pinterp = interplin(self.pofx_scale, self.xinput_scale, randx)
+            pinterp = stat.interplin(self.pofx_scale, self.xinput_scale, randx)
         return randx, randy, pinterp
 
+    def _get_native_seed(self, seed):
+        if seed is None:
+            seed = numpy.random.randint(0, 2**31-1)
+        return int(seed)
+
+    def initialize_tables(self):
+        """
+        Make the tables for the native sampler.  For 'accum' this is a guide
+        table into the cumulative distribution, for 'cut' with an array p(x)
+        and increasing x it is the alias table for the segments of the
+        linearly interpolated p(x).
+        """
+        self.guide = None
+        self.alias_prob = None
+        self.alias = None
+
+        if self.method == 'accum':
+            self.xvals_native = numpy.array(self.xvals, dtype='f8', ndmin=1)
+            self.pcum_native = numpy.array(self.pcum, dtype='f8', ndmin=1)
+            # one guide entry per interval keeps the walk to about one step
+            self.guide = stat._stat_util.guide_table(self.pcum_native,
+                                                     self.pcum_native.size)
+        elif not self.isfunc and self.xinput.size > 1:
+            x = numpy.array(self.xinput, dtype='f8', ndmin=1)
+            p = numpy.array(self.pofx, dtype='f8', ndmin=1)
+            dx = x[1:] - x[0:-1]
+            if (dx > 0).all() and (p >= 0).all():
+                self.xinput_native = x
+                self.pofx_native = p
+                areas = 0.5*(p[1:] + p[0:-1])*dx
+                self.alias_prob, self.alias = \
+                        stat._stat_util.alias_table(areas)
+
 
 
     def initialize_points(self):
@@ -907,25 +978,51 @@ class CholeskySampler(object):
     mm=s.mean(axis=0)
     ( (s[:,0]-mm[0])*(s[:,1]-mm[1]) ).sum()/(n-1)
     0.50052647916418957
+
+    The covariance can also be a stack of matrices with shape
+    (nmat,npar,npar), and the means then have shape (nmat,npar) or are
+    None.  The matrices are factored once at construction, and sample(n)
+    gives n points from each, with shape (nmat,n,npar).
+
+        cs=CholeskySampler(means, covs)
+        rand=cs.sample(100000, nthreads=4)
+
+    The samples are made in C and written directly into the output, which
+    can be sent with out=.  The normal deviates come from a counter based
+    generator, so the samples for a given seed do not depend on nthreads.
+    If dist= is sent, a single matrix is sampled in numpy using that
+    distribution instead.
     """
     def __init__(self, mean, cov, dist=None):
-        self.mean=numpy.array(mean, ndmin=1)
-        self.cov=numpy.array(cov, ndmin=2)
+        self.cov=numpy.array(cov, dtype='f8', ndmin=2)
 
-        if dist is None:
-            dist=numpy.random.randn
-        self.dist=dist
+        ndim=self.cov.ndim
+        if ndim not in (2,3) or self.cov.shape[-1] != self.cov.shape[-2]:
+            raise ValueError("cov must have shape [npar,npar] or "
+                             "[nmat,npar,npar], got %s" % (self.cov.shape,))
+
+        self.npar=self.cov.shape[-1]
+        self.batch = (ndim == 3)
 
-        npar = mean.size
-        n1,n2=cov.shape[0:0+2]
-        if npar != cov.shape[0] or npar != cov.shape[1]:
-            raise ValueError("mean shape [%d] inconsistent "
-                             "with cov shape [%d,%d]" % (npar,n1,n2))
+        if mean is None:
+            self.mean=None
+        else:
+            self.mean=numpy.array(mean, dtype='f8', ndmin=1)
+            if self.mean.shape != self.cov.shape[0:-1]:
+                raise ValueError("mean shape %s inconsistent "
+                                 "with cov shape %s" % (self.mean.shape,
+                                                        self.cov.shape))
+            self.mean=numpy.ascontiguousarray(self.mean)
+
+        if dist is not None and self.batch:
+            raise ValueError("dist= can only be used with a single "
+                             "covariance matrix")
+        self.dist=dist
 
-        self.M = numpy.linalg.cholesky(self.cov)
-        self.npar=npar
+        self.M = stat._stat_util.cholesky_batch(
+                    numpy.ascontiguousarray(self.cov))
 
-    def sample(self, n=None):
+    def sample(self, n=None, seed=None, stream=0, nthreads=1, out=None):
         """
         sample the distribution
 
@@ -934,7 +1031,18 @@ class CholeskySampler(object):
         n: integer, optional
             the number of samples.  If not sent, a single
             sample is returned, otherwise an array [n,npars]
-            is returned.
+            is returned, or [nmat,n,npars] for a stack of
+            covariance matrices.
+        seed: integer, optional
+            Seed for the random number generator.  If None, a seed is drawn
+            from numpy.random
+        stream: integer, optional
+            Stream of the generator.  Different streams with the same seed
+            give independent samples.  Default 0.
+        nthreads: integer, optional
+            Number of threads to use, default 1.
+        out: array, optional
+            A float64 array of the output shape to fill in place.
         """
 
         if n is None:
@@ -943,22 +1051,48 @@ class CholeskySampler(object):
         else:
             is_scalar=False
 
-        npar=self.npar
-        r=self.dist(npar*n).reshape(npar,n)
+        if self.dist is not None:
+            samples=self._sample_dist(n)
+        else:
+            if self.batch:
+                shape=(self.cov.shape[0], n, self.npar)
+            else:
+                shape=(n, self.npar)
 
-        V = numpy.dot(self.M,r)
+            if out is None:
+                out=numpy.zeros(shape, dtype='f8')
+            elif (out.shape != shape or out.dtype != numpy.dtype('f8')
+                    or not out.flags['C_CONTIGUOUS']):
+                raise ValueError("out must be a contiguous float64 array "
+                                 "with shape %s" % (shape,))
 
-        mean=self.mean
-        for i in xrange(npar):
-            V[i,:] += mean[i]
+            if seed is None:
+                seed=numpy.random.randint(0, 2**31-1)
+
+            stat._stat_util.mvn_sample(self.M, self.mean, out, int(seed),
+                                       int(stream), int(nthreads))
+            samples=out
 
-        samples=V.T
         if is_scalar:
-            return samples[0,:]
+            return samples[...,0,:]
         else:
             return samples
 
-def cholesky_sample(cov, n, means=None, dist=None):
+    def _sample_dist(self, n):
+        npar=self.npar
+        r=self.dist(npar*n).reshape(npar,n)
+
+        V = numpy.dot(self.M,r)
+
+        if self.mean is not None:
+            mean=self.mean
+            for i in xrange(npar):
+                V[i,:] += mean[i]
+
+        return V.T
+
+def cholesky_sample(cov, n, means=None, dist=None,
+                    seed=None, stream=0, nthreads=1, out=None):
     """
     Sample the input covariance using a cholesky decomposition.  The idea is
     that in each dimension we draw from the standard distribution, and then
@@ -970,14 +1104,18 @@ def cholesky_sample(cov, n, means=None, dist=None):
     parameters
     ----------
     cov: array
-        A 2-d array representing the covariance of the parameters
+        A 2-d array representing the covariance of the parameters, or a
+        stack of them with shape (nmat,npar,npar)
     n: integer
         The number of random points to generate
     means: array, optional
         The mean values to add to the random points; by default
         the randoms are centered on 0
     dist: function, optional
-        The distribution function.  Default is numpy.random.randn.
+        The distribution function.  Default is a standard normal
+        generated in C; see CholeskySampler.
+    seed, stream, nthreads, out: optional
+        See CholeskySampler.sample
     
     example:
         cov = array([[1.5,0.3],
@@ -994,26 +1132,8 @@ def cholesky_sample(cov, n, means=None, dist=None):
         - output is now (npoints,npar) instead of (npar,npoints) to match
         expectation from rec arrays
     """
-    if dist is None:
-        dist=numpy.random.randn
-
-    npar = cov.shape[0]
-    if means is not None:
-        nm=len(means)
-        if nm != cov.shape[0]:
-            raise ValueError("expected %d mean values, got %d" % (npar,nm))
-
-    M = numpy.linalg.cholesky(cov)
-
-    r=dist(npar*n).reshape(npar,n)
-
-    V = numpy.dot(M,r)
-
-    if means is not None:
-        for i in xrange(npar):
-            V[i,:] += means[i]
-
-    return V.T
+    cs=CholeskySampler(means, cov, dist=dist)
+    return cs.sample(n, seed=seed, stream=stream, nthreads=nthreads, out=out)
 
 def test_cholesky():
     import esutil as eu
@@ -1117,9 +1237,18 @@ def random_indices(imax, nrand, **keys):
         can be greater than imax
     seed: int
         A seed for the random number generator
+    stream: int
+        For unique samples, the stream of the random number generator.
+        Different streams with the same seed give independent samples, for
+        example for different threads or processes.  Default 0.
+
+    The unique indices are sorted.  They are drawn in O(nrand) time with
+    Vitter's algorithm D, and a counter based generator that does not touch
+    the global random state.
     """
     unique = keys.get('unique',True)
     seed=keys.get('seed',None)
+    stream=keys.get('stream',0)
     if seed is None:
         import time
         seed=int( time.time() )
@@ -1127,7 +1256,7 @@ def random_indices(imax, nrand, **keys):
     if not unique:
         return numpy.random.randint(0, imax, nrand)
     else:
-        return stat._stat_util.random_sample(imax, nrand, seed)
+        return stat._stat_util.random_sample(imax, nrand, seed, stream)
 
 def randind(nmax, nrand, dtype=None):
     """
@@ -28,6 +28,8 @@ Instantiate a new Recfile class
                          nrows=-9999, 
                          offset=0, 
                          skiplines=0,
+                         use_mmap=False,
+                         nthreads=1,
                          verbose=False)
 """
 # docs for inputs to the varius "open" functions and methods.
@@ -60,6 +62,19 @@ Keywords:
         Skip the specified number of lines (rows).  Only works for
         ascii where rows are separated by '\\n'
 
+    use_mmap:
+        If True, binary files are read through a memory map rather than
+        copied through stdio.  Reading all rows and fields, or a slice,
+        returns a read-only view of the mapping which stays valid after
+        the file is closed; subsets of rows or fields are gathered from
+        the mapping into a new array.  Ignored for ascii.  Default False.
+
+    nthreads:
+        The number of threads used to parse ascii files.  The file is
+        mapped into memory and split at line boundaries, so it must be a
+        regular file with each row on its own line.  Rows read through
+        Read() and slices are parsed in parallel.  Default 1.
+
     padnull: When writing ascii, replace nulls in strings with spaces.
         Useful for programs that don't understand nulls like sqlite
         databases.
@@ -272,6 +287,8 @@ class Recfile(object):
         self.close()
         self.padnull=keys.get('padnull',False)
         self.ignorenull=keys.get('ignorenull',False)
+        self.use_mmap=keys.get('use_mmap',False)
+        self.nthreads=keys.get('nthreads',1)
         self.delim = keys.get('delim',None)
         self.skiplines=keys.get('skiplines',None)
         self.offset=keys.get('offset',None)
@@ -388,6 +405,8 @@ class Recfile(object):
 
         self.padnull=False
         self.ignorenull=False
+        self.use_mmap=False
+        self.nthreads=1
 
 
     def flush(self):
@@ -435,7 +454,8 @@ class Recfile(object):
 
         Inputs:
             rows: A scalar, sequence or array indicating a subset
-                of rows to read.
+                of rows to read.  The rows are read in sorted order and
+                must be unique, as for records.Records.Read
             fields or columns: A scalar, sequence, or array indicating
                 a subset of field to read. fields and columns mean the
                 same thing.
@@ -460,14 +480,12 @@ class Recfile(object):
         rows2read = self._get_rows2read(rows)
         fields2read = self._get_fields2read(fields, columns=columns)
 
-        if fields2read is None and rows2read is None and self.delim is None:
+        if (fields2read is None and rows2read is None and self.delim is None
+                and not self.use_mmap):
             # Its binary and we are reading everything.  Use fromfile.
             result = numpy.fromfile(self.fobj,dtype=self.dtype,count=self.nrows)
         else:
-            robj = records.Records(
-                self.fobj, mode='r', 
-                nrows=self.nrows, dtype=self.dtype, 
-                delim=self.delim)
+            robj = self._get_records_reader()
             result = robj.Read(rows=rows2read, fields=fields2read)
 
         if view is not None:
@@ -571,10 +589,7 @@ class Recfile(object):
         if self.fobj.tell() != self.offset:
             self.fobj.seek(self.offset)
 
-        robj = records.Records(
-                self.fobj, mode='r', 
-                nrows=self.nrows, dtype=self.dtype, 
-                delim=self.delim)
+        robj = self._get_records_reader()
         result = robj.ReadSlice(long(arg.start), long(arg.stop), long(arg.step))
 
 
@@ -585,6 +600,18 @@ class Recfile(object):
 
         return result
 
+    def _get_records_reader(self):
+        use_mmap = self.use_mmap and self.delim is None
+        if use_mmap and (self.fobj.mode[0] != 'r' or '+' in self.fobj.mode):
+            # the map only sees what has reached the file
+            self.fobj.flush()
+
+        return records.Records(
+                self.fobj, mode='r', 
+                nrows=self.nrows, dtype=self.dtype, 
+                delim=self.delim, use_mmap=int(use_mmap),
+                nthreads=int(self.nthreads))
+
     def get_memmap(self, view=None, header=False):
 
         if self.delim is not None:
@@ -831,13 +858,16 @@ class Recfile(object):
             rows2read = numpy.array([rows2read], dtype='intp')
 
 
-        # should we do this sort, or assume sorted?
-        rows2read.sort()
+        # the reader requires sorted, unique rows.  Sort a copy so the
+        # caller's array is not changed, but don't drop duplicates silently
+        rows2read = numpy.sort(rows2read)
         rmin = rows2read[0]
         rmax = rows2read[-1]
         if rmin < 0 or rmax >= self.nrows:
             raise ValueError("Requested rows range from %s->%s: out of "
                              "range %s->%s" % (rmin,rmax,0,self.nrows-1))
+        if (rows2read[1:] == rows2read[:-1]).any():
+            raise ValueError("Requested rows must be unique")
         if self.verbose:
             stdout.write("\t\tReading %s rows\n" % len(rows2read))
 
@@ -1524,6 +1554,388 @@ def test():
     sys.stdout.write('Total number of write failures: %s\n' % nbad_write)
     sys.stdout.write('Total number of read failures: %s\n' % nbad_read)
 
+    nbad_parse = test_ascii_parse()
+    sys.stdout.write('Total number of ascii parse failures: %s\n' % nbad_parse)
+
+    nbad_threads = test_ascii_threads()
+    sys.stdout.write('Total number of ascii thread failures: %s\n' % nbad_threads)
+
+    nbad_mmap = test_mmap()
+    sys.stdout.write('Total number of mmap failures: %s\n' % nbad_mmap)
+
+    nbad_rows = test_read_rows()
+    sys.stdout.write('Total number of read rows failures: %s\n' % nbad_rows)
+
+
+_parse_dtype=[('f8','f8'),('f4','f4'),('i8','i8'),('u8','u8'),('i4','i4')]
+
+# numbers that are hard to convert: halfway cases, subnormals, overflow
+# and underflow, and more digits than fit in 64 bits
+_parse_f8 = ['9007199254740993', '9007199254740995',
+             '1.00000000000000011102230246251565404236316680908203125',
+             '1.00000000000000011102230246251565404236316680908203126',
+             '2.4703282292062327208828439643411068618252990130716238221279284125033775364e-324',
+             '2.4703282292062328e-324', '4.9406564584124654e-324',
+             '2.2250738585072011e-308', '2.2250738585072014e-308',
+             '1.7976931348623157e308', '1.7976931348623159e308', '2e308',
+             '1e-400', '1e23', '8.589973e9', '7.038531e-26', '-0.0', '0e10',
+             '+.5', '5.', '-inf', 'inf', '123456789012345678901234567890',
+             '0.000000000000000000000000000000000000001', '1e22', '1e-22',
+             '12345678901234567890e-300', '98765432109876543210e280']
+_parse_f4 = ['1e-45', '7e-46', '3.4028235e38', '1.17549435e-38',
+             '16777217', '16777219', '0.1', '-0.0', '3.4028236e38']
+_parse_i8 = ['9223372036854775807', '-9223372036854775808',
+             '1234567890123456789', '-1234567890123456789',
+             '999999999999999999', '-999999999999999999',
+             '000000000000000000000123', '+42', '-0']
+_parse_u8 = ['18446744073709551615', '10000000000000000000',
+             '9223372036854775808', '12345678901234567890']
+_parse_i4 = ['2147483647', '-2147483648', '+7', '-0', '007']
+
+def _random_bits(n, dtype):
+    # random bit patterns of 8 byte types
+    bits = numpy.random.randint(0, 2**16, 4*n).astype('u2')
+    return bits.view(dtype)
+
+def ParseTestData(nrows):
+    """
+    Tokens for each column of the ascii parse test, with the special cases
+    at the start and random values after
+    """
+    toks = {}
+
+    x = _random_bits(nrows, 'f8')
+    x = x[numpy.isfinite(x)]
+    fmts = ['%.17g', '%.15g', '%.6e', '%.3f', '%.25e']
+    rand_f8 = [fmts[i % len(fmts)] % x[i] for i in xrange(x.size)]
+    for i in xrange(0, len(rand_f8), 7):
+        # mantissas with 19 or 20 digits
+        mant = ''.join(['%d' % d for d in numpy.random.randint(0, 10, 20)])
+        rand_f8[i] = '%s.%se%d' % (mant[0:1+i%2], mant[1+i%2:],
+                                   numpy.random.randint(-320,300))
+    toks['f8'] = (_parse_f8 + rand_f8)[0:nrows]
+
+    x = _random_bits(nrows, 'f4')
+    x = x[numpy.isfinite(x)]
+    toks['f4'] = (_parse_f4 + ['%.9g' % v for v in x])[0:nrows]
+
+    x = _random_bits(nrows, 'i8')
+    toks['i8'] = (_parse_i8 + ['%d' % v for v in x])[0:nrows]
+
+    x = _random_bits(nrows, 'u8')
+    toks['u8'] = (_parse_u8 + ['%d' % long(v) for v in x])[0:nrows]
+
+    x = _random_bits(nrows, 'i4')
+    toks['i4'] = (_parse_i4 + ['%d' % v for v in x])[0:nrows]
+
+    return toks
+
+def test_ascii_parse(nrows=20000):
+    """
+    Read comma, tab and space delimited files of numbers that are hard to
+    convert, comparing with the python conversions of the same text.  All
+    bits of the floats must agree.
+    """
+
+    sys.stdout.write('\nTesting ascii parsing\n')
+    sys.stdout.write('-'*79 +'\n')
+
+    toks = ParseTestData(nrows)
+
+    expected = numpy.zeros(nrows, dtype=_parse_dtype)
+    expected['f8'] = [float(t) for t in toks['f8']]
+    expected['f4'] = numpy.array([float(t) for t in toks['f4']], dtype='f4')
+    expected['i8'] = numpy.array([int(t) for t in toks['i8']], dtype='i8')
+    expected['u8'] = numpy.array([long(t) for t in toks['u8']], dtype='u8')
+    expected['i4'] = numpy.array([int(t) for t in toks['i4']], dtype='i4')
+
+    names = [n for n,t in _parse_dtype]
+    nbad=0
+    for delim in [",", "\t", " "]:
+        fname=TestFile(delim)
+        f = open(fname, 'w')
+        for i in xrange(nrows):
+            f.write(delim.join([toks[n][i] for n in names]))
+            f.write('\n')
+        f.close()
+
+        r = records.Records(fname, "r", delim, expected.dtype, nrows)
+        res = r.Read()
+        r.Close()
+
+        for n in names:
+            if n[0] == 'f':
+                w, = numpy.where(res[n].view('u%s' % n[1])
+                                 != expected[n].view('u%s' % n[1]))
+            else:
+                w, = numpy.where(res[n] != expected[n])
+            for i in w[0:10]:
+                sys.stdout.write("delim '%s' field %s: '%s' read as %r "
+                                 "expected %r\n" % \
+                                 (delim,n,toks[n][i],res[n][i],expected[n][i]))
+            nbad += w.size
+
+    sys.stdout.write('Number of failures: %s\n' % nbad)
+    return nbad
+
+def _read_ascii(fname, offset, delim, nrows, nthreads, how):
+    """
+    Read with rows=how[1] or, if how[0] is 'slice', the slice how[1:4].
+    Returns the data, or None if an error was raised, and the file
+    position after the read
+    """
+    f = open(fname, 'r')
+    f.seek(offset)
+    r = records.Records(f, mode='r', delim=delim, 
+                        dtype=numpy.dtype(_parse_dtype), nrows=nrows,
+                        nthreads=nthreads)
+    try:
+        if how[0] == 'slice':
+            res = r.ReadSlice(long(how[1]), long(how[2]), long(how[3]))
+        else:
+            res = r.Read(rows=how[1])
+    except RuntimeError:
+        res = None
+    pos = f.tell()
+    r.Close()
+    f.close()
+    return res, pos
+
+def test_ascii_threads():
+    """
+    Read ascii files with several threads and check the data and the final
+    file position are the same as for a single thread.  The files have a
+    header, and some have fewer lines than threads or no final newline.
+    """
+
+    sys.stdout.write('\nTesting ascii reading with threads\n')
+    sys.stdout.write('-'*79 +'\n')
+
+    names = [n for n,t in _parse_dtype]
+    nbad=0
+    for nrows in [1000, 3]:
+        toks = ParseTestData(nrows)
+        lines = [' '.join([toks[n][i] for n in names]) for i in xrange(nrows)]
+        some = numpy.unique(numpy.random.randint(0, nrows, 1+nrows/10))
+
+        reads = [('rows',None), ('rows',[0]), ('rows',[nrows-1]),
+                 ('rows',some), ('rows',range(nrows)),
+                 ('rows',[nrows-1,0]), ('rows',[0,0]), ('rows',[nrows]),
+                 ('slice',0,nrows,1), ('slice',1,nrows,3),
+                 ('slice',nrows-1,nrows,1), ('slice',0,nrows,nrows+5)]
+
+        for delim in [",", " "]:
+            for header in ['', 'a header line\n# and another\n']:
+                for newline in [True, False]:
+                    fname=TestFile(delim)
+                    f = open(fname, 'w')
+                    f.write(header)
+                    f.write('\n'.join([l.replace(' ',delim) for l in lines]))
+                    if newline:
+                        f.write('\n')
+                    f.close()
+
+                    for how in reads:
+                        res1,pos1 = _read_ascii(fname, len(header), delim,
+                                                nrows, 1, how)
+                        for nthreads in [2, 4, 16]:
+                            res,pos = _read_ascii(fname, len(header), delim,
+                                                  nrows, nthreads, how)
+                            if ((res is None) != (res1 is None) or pos != pos1
+                                    or (res is not None
+                                        and res.tostring() != res1.tostring())):
+                                sys.stdout.write("delim '%s' nrows %s header "
+                                                 "%s newline %s read %s "
+                                                 "nthreads %s differs\n" % \
+                                                 (delim,nrows,len(header),
+                                                  newline,how[0:4],nthreads))
+                                nbad += 1
+
+    sys.stdout.write('Number of failures: %s\n' % nbad)
+    return nbad
+
+def _read_mapped(fname, offset, nrows, use_mmap, how, fields=None):
+    """
+    Read a binary file of _parse_dtype rows starting at offset, with
+    rows=how[1] or, if how[0] is 'slice', the slice how[1:4].  Returns the
+    data, or None if an error was raised.  The Records object is closed and
+    deleted before returning, so any view of the mapping must outlive it.
+    """
+    f = open(fname, 'r')
+    f.seek(offset)
+    r = records.Records(f, mode='r', delim='',
+                        dtype=numpy.dtype(_parse_dtype), nrows=nrows,
+                        use_mmap=use_mmap)
+    try:
+        if how[0] == 'slice':
+            res = r.ReadSlice(long(how[1]), long(how[2]), long(how[3]))
+        else:
+            res = r.Read(rows=how[1], fields=fields)
+    except RuntimeError:
+        res = None
+    r.Close()
+    del r
+    f.close()
+    return res
+
+def test_mmap():
+    """
+    Read binary files through a mapping and compare with the usual reads:
+    the full file and slices, which are views of the mapping, and subsets
+    of rows and fields, which are copied out.  The views are used after
+    the Records object and the file are closed.  The data start after a
+    header that is not page aligned, and an empty file gives an empty
+    array.
+    """
+
+    sys.stdout.write('\nTesting mapped binary reading\n')
+    sys.stdout.write('-'*79 +'\n')
+
+    nbad=0
+    for nrows in [1000, 3]:
+        data = numpy.zeros(nrows, dtype=_parse_dtype)
+        for n,t in _parse_dtype:
+            data[n] = _random_bits(nrows, t)[0:nrows]
+        some = numpy.unique(numpy.random.randint(0, nrows, 1+nrows/10))
+
+        reads = [('rows',None), ('rows',[0]), ('rows',[nrows-1]),
+                 ('rows',some), ('rows',range(nrows)),
+                 ('rows',[nrows-1,0]), ('rows',[nrows]),
+                 ('slice',0,nrows,1), ('slice',1,nrows,3),
+                 ('slice',nrows-1,nrows,1), ('slice',0,nrows,nrows+5),
+                 ('slice',2,2,1)]
+
+        for header in ['', 'a header of 17 b\n']:
+            fname=TestFile('')
+            f = open(fname, 'w')
+            f.write(header)
+            data.tofile(f)
+            f.close()
+
+            for how in reads:
+                for fields in [None, ['i8'], ['f4','u8']]:
+                    if how[0] == 'slice' and fields is not None:
+                        continue
+                    res1 = _read_mapped(fname, len(header), nrows, 0, how,
+                                        fields=fields)
+                    res = _read_mapped(fname, len(header), nrows, 1, how,
+                                       fields=fields)
+                    if ((res is None) != (res1 is None)
+                            or (res is not None
+                                and (res.dtype != res1.dtype
+                                     or res.tostring() != res1.tostring()))):
+                        sys.stdout.write("nrows %s header %s read %s fields "
+                                         "%s differs\n" % \
+                                         (nrows,len(header),how[0:4],fields))
+                        nbad += 1
+                    elif (res is not None and fields is None
+                            and (how[0] == 'slice' or how[1] is None)
+                            and res.flags.writeable):
+                        sys.stdout.write("nrows %s read %s view is "
+                                         "writeable\n" % (nrows,how[0:4]))
+                        nbad += 1
+
+    # an empty file, directly and through Recfile
+    fname=TestFile('')
+    open(fname, 'w').close()
+    for use_mmap in [0, 1]:
+        res = _read_mapped(fname, 0, 0, use_mmap, ('rows',None))
+        rf = Open(fname, dtype=_parse_dtype, use_mmap=bool(use_mmap))
+        res2 = rf.read()
+        rf.close()
+        if res is None or res.size != 0 or res2.size != 0:
+            sys.stdout.write("empty file use_mmap %s not empty\n" % use_mmap)
+            nbad += 1
+
+    sys.stdout.write('Number of failures: %s\n' % nbad)
+    return nbad
+
+_rows_dtype=[('f8','f8'),('i8','i8'),('i4','i4')]
+
+def _read_rows(fname, delim, nrows, rows, fields, **keys):
+    """
+    Read with records.Records, returning None if an error was raised
+    """
+    r = records.Records(fname, 'r', delim, numpy.dtype(_rows_dtype), nrows,
+                        **keys)
+    try:
+        res = r.Read(rows=rows, fields=fields)
+    except RuntimeError:
+        res = None
+    r.Close()
+    return res
+
+def test_read_rows(nrows=1000):
+    """
+    Send the same rows to each read path: binary through stdio and through
+    a mapping, and ascii with one and several threads.  Sorted unique rows
+    must give the same data from every path, and unsorted, repeated or out
+    of range rows must be an error from every path.
+    """
+
+    sys.stdout.write('\nTesting rows for each read path\n')
+    sys.stdout.write('-'*79 +'\n')
+
+    data = numpy.zeros(nrows, dtype=_rows_dtype)
+    data['f8'] = numpy.random.random(nrows)
+    data['i8'] = numpy.random.randint(-2**40, 2**40, nrows)
+    data['i4'] = numpy.arange(nrows)
+
+    bname=TestFile('')
+    data.tofile(bname)
+    aname=TestFile(',')
+    f = open(aname, 'w')
+    for row in data:
+        f.write('%.17g,%d,%d\n' % (row['f8'],row['i8'],row['i4']))
+    f.close()
+
+    paths = [('binary', bname, '', {}),
+             ('mmap', bname, '', {'use_mmap':1}),
+             ('ascii', aname, ',', {}),
+             ('ascii threads', aname, ',', {'nthreads':4})]
+
+    some = numpy.unique(numpy.random.randint(0, nrows, nrows/10))
+    good = [[0], [nrows-1], [3,4,5,900], some, range(nrows)]
+    bad = [[5,2], [2,2], [0,3,3,7], some[::-1], [nrows], [-1], [3,nrows+10]]
+
+    nbad=0
+    for name, fname, delim, keys in paths:
+        for fields in [None, ['i4','f8']]:
+            for rows in good:
+                res = _read_rows(fname, delim, nrows, rows, fields, **keys)
+                expected = data[numpy.array(rows, dtype='intp')]
+                ok = res is not None and res.size == expected.size
+                for n in (fields or [n for n,t in _rows_dtype]):
+                    ok = ok and (res[n] == expected[n]).all()
+                if not ok:
+                    sys.stdout.write("%s: rows %s fields %s wrong\n" % \
+                                     (name,rows[0:5],fields))
+                    nbad += 1
+
+            for rows in bad:
+                res = _read_rows(fname, delim, nrows, rows, fields, **keys)
+                if res is not None:
+                    sys.stdout.write("%s: rows %s fields %s did not raise "
+                                     "an error\n" % (name,rows[0:5],fields))
+                    nbad += 1
+
+    # Recfile sorts the rows but does not drop repeats
+    rf = Open(bname, dtype=_rows_dtype, nrows=nrows)
+    res = rf.read(rows=[900,3,5])
+    if res.tostring() != data[[3,5,900]].tostring():
+        sys.stdout.write("Recfile: unsorted rows not sorted\n")
+        nbad += 1
+    try:
+        res = rf.read(rows=[2,2])
+        sys.stdout.write("Recfile: repeated rows did not raise an error\n")
+        nbad += 1
+    except ValueError:
+        pass
+    rf.close()
+
+    sys.stdout.write('Number of failures: %s\n' % nbad)
+    return nbad
+
 
 
 
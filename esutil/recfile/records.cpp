@@ -1,16 +1,48 @@
 #include "records.hpp"
+#include "pow5_128.h"
+#include "ParallelJobs.h"
+#include <cstring>
+#include <cstdlib>
+#include <cfloat>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The mapping is handed to numpy wrapped in a capsule, which unmaps it when
+// the last view goes away
+struct RecordsMap {
+	void* addr;
+	size_t len;
+};
+
+static const char* RECORDS_MAP_NAME = "esutil.recfile.RecordsMap";
+
+static void RecordsMapFree(PyObject* capsule)
+{
+	RecordsMap* map = (RecordsMap*) PyCapsule_GetPointer(capsule, RECORDS_MAP_NAME);
+	if (map != NULL) {
+		munmap(map->addr, map->len);
+		delete map;
+	}
+}
 
 Records::Records(PyObject* fileobj, 
 		const char* mode,
 		PyObject* delimobj, 
 		PyObject* dtype,
 		long long nrows,
-        int bracket_arrays) throw (const char *)
+        int bracket_arrays,
+        int use_mmap,
+        int nthreads) throw (const char *)
 {
 	import_array();
 	InitializeVariables();
 
     mBracketArrays = bracket_arrays;
+	mUseMmap = use_mmap;
+	mNthreads = nthreads;
 
 	mMode=mode;
 	GetFptr(fileobj, mMode.c_str());
@@ -46,6 +78,9 @@ Records::~Records()
 	// This may or may not be a copy, but we must decref 
 	Py_XDECREF(mRowsToRead);
 
+	// Views of the mapping hold their own references
+	Py_XDECREF(mMapOwner);
+
 	Close();
 
 }
@@ -81,6 +116,19 @@ void Records::InitializeVariables()
 	mFptr=NULL;
 	mFptrIsLocal=false;
 
+	mUseMmap=0;
+	mMapOwner=NULL;
+	mMapData=NULL;
+	mCopyRowsize=0;
+
+	mNthreads=1;
+
+	mAscii.buf=NULL;
+	mAscii.pos=0;
+	mAscii.end=0;
+	mAscii.eof=false;
+	mAscii.data=NULL;
+
 	mDelim="";
     mArrayDelim="";
 
@@ -120,6 +168,11 @@ PyObject* Records::ReadSlice(long long row1, long long row2, long long step)  th
 
 	// slice we read all fields, so send Py_None
 	ProcessFieldsToRead(Py_None);
+
+	if (UseMap()) {
+		return MapView(row1, step);
+	}
+
 	CreateOutputArray();
 
 	ReadPrepare();
@@ -147,6 +200,16 @@ PyObject* Records::Read(
 
 	ProcessRowsToRead(rows);
 	ProcessFieldsToRead(fields);
+
+	if (UseMap()) {
+		if (mRowsToRead == NULL && mKeepNfields == mNfields) {
+			return MapView(0, 1);
+		}
+		CreateOutputArray();
+		ReadRowsMapped();
+		return (PyObject* ) mReturnObject;
+	}
+
 	CreateOutputArray();
 	ReadPrepare();
 
@@ -169,7 +232,7 @@ void Records::ReadPrepare()
 
 		mReadWholeRowBinary = true;
 	} else if (mFileType == ASCII_FILE) {
-		MakeScanFormats(true);
+		AsciiBegin();
 	}
 }
 
@@ -177,8 +240,21 @@ void Records::ReadFromFile()
 {
 	if (mReadWholeFileBinary) {
 		ReadAllAsBinary();
+	} else if (mFileType == BINARY_FILE) {
+		npy_intp* rows=NULL;
+		if (mRowsToRead != NULL) {
+			rows = (npy_intp*) PyArray_DATA(mRowsToRead);
+		}
+		ReadBinaryBlocks(rows, 0, 1);
 	} else {
-		ReadRows();
+		npy_intp* rows=NULL;
+		if (mRowsToRead != NULL) {
+			rows = (npy_intp*) PyArray_DATA(mRowsToRead);
+		}
+		if (!ReadAsciiThreaded(rows, 0, 1)) {
+			ReadRows();
+			AsciiEnd();
+		}
 	}
 }
 
@@ -201,7 +277,7 @@ void Records::ReadRows()
 	npy_intp current_row=0;
 	npy_intp row2read=0;
 
-	if (mNrowsToRead != mNrows) {
+	if (mRowsToRead != NULL) {
 		// No data created or copied here
 		rows = (npy_intp*) PyArray_DATA(mRowsToRead);
 	}
@@ -210,7 +286,7 @@ void Records::ReadRows()
 	// Loop over the rows to read, which could be a subset of the 
 	// total number of rows in the file.
 	for (npy_intp irow=0;  irow<mNrowsToRead; irow++) {
-		if (mNrowsToRead != mNrows) {
+		if (rows != NULL) {
 			row2read=rows[irow];
 		} else {
 			row2read=irow;
@@ -229,6 +305,23 @@ void Records::ReadRows()
 
 }
 
+// All read paths rely on the rows being sorted and unique: the stdio and
+// ascii reads only move forward in the file, and the block and mapped reads
+// check the range once from the ends
+void Records::CheckRows(const npy_intp* rows)
+{
+	for (npy_intp irow=0; irow<mNrowsToRead; irow++) {
+		if (rows[irow] < 0 || rows[irow] >= mNrows
+				|| (irow > 0 && rows[irow] <= rows[irow-1])) {
+			stringstream serr;
+			serr<<"Requested rows must be sorted, unique and within [0,"
+				<<mNrows<<"), got "<<rows[irow]<<" at position "<<irow;
+			mErr = serr.str();
+			throw mErr.c_str();
+		}
+	}
+}
+
 void Records::ReadRowsSlice(npy_intp row1, npy_intp step) throw (const char* )
 {
 
@@ -246,7 +339,11 @@ void Records::ReadRowsSlice(npy_intp row1, npy_intp step) throw (const char* )
 			throw "Error reading slice";
 		} 
 
-	} else {
+	} else if (mFileType == BINARY_FILE) {
+
+		ReadBinaryBlocks(NULL, row1, step);
+
+	} else if (!ReadAsciiThreaded(NULL, row1, step)) {
 
 		npy_intp row2read = row1;
 		npy_intp current_row = 0;
@@ -264,10 +361,507 @@ void Records::ReadRowsSlice(npy_intp row1, npy_intp step) throw (const char* )
 			current_row++;
 			row2read += step;
 		}
+		AsciiEnd();
 	}
 
 }
 
+static long RecordsPageSize()
+{
+	static long pagesize = sysconf(_SC_PAGESIZE);
+	return pagesize;
+}
+
+bool Records::UseMap()
+{
+	// An empty mapping is not allowed, and there is nothing to map for
+	// zero rows, so those are read as usual into an empty array
+	if (!mUseMmap || mFileType != BINARY_FILE || mNrows == 0) {
+		return false;
+	}
+	MapFile();
+	return true;
+}
+
+void Records::MapFile()
+{
+	if (mMapOwner != NULL) {
+		return;
+	}
+	if (mDebug) DebugOut("Mapping file");
+
+	// The rows start at the current file position, just as for fread
+	int fd = fileno(mFptr);
+	off_t start = ftello(mFptr);
+	if (start < 0) {
+		throw "Could not get file position for mmap";
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		throw "use_mmap requires a regular file";
+	}
+
+	off_t nbytes = (off_t) mRowSize*mNrows;
+	if (start + nbytes > st.st_size) {
+		stringstream serr;
+		serr<<"File is too small to hold "<<mNrows<<" rows of "
+			<<mRowSize<<" bytes";
+		mErr = serr.str();
+		throw mErr.c_str();
+	}
+
+	// mmap offsets must be page aligned
+	off_t pagestart = start - start % RecordsPageSize();
+	size_t len = (size_t) (start - pagestart + nbytes);
+
+	void* addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, pagestart);
+	if (addr == MAP_FAILED) {
+		throw "Could not mmap file";
+	}
+
+	RecordsMap* map = new RecordsMap;
+	map->addr = addr;
+	map->len = len;
+	mMapOwner = PyCapsule_New(map, RECORDS_MAP_NAME, RecordsMapFree);
+	if (mMapOwner == NULL) {
+		munmap(addr, len);
+		delete map;
+		throw "Could not create owner for mmap";
+	}
+	mMapData = (char*) addr + (start - pagestart);
+}
+
+void Records::MapAdvise(const char* begin, const char* end, int advice)
+{
+	// Only a hint, so failures are ignored.  madvise wants a page
+	// aligned start, which is still inside the mapping
+	uintptr_t b = (uintptr_t) begin;
+	b -= b % RecordsPageSize();
+	if ((uintptr_t) end > b) {
+		madvise((void*) b, (uintptr_t) end - b, advice);
+	}
+}
+
+PyObject* Records::MapView(npy_intp row1, npy_intp step)
+{
+	if (mDebug) DebugOut("Returning view of mapped file");
+
+	npy_intp dims[1], strides[1];
+	dims[0] = mNrowsToRead;
+	strides[0] = step*mRowSize;
+	char* data = mMapData + row1*mRowSize;
+
+	if (mNrowsToRead > 0) {
+		int advice = 
+			(strides[0] > RecordsPageSize()) ? MADV_RANDOM : MADV_SEQUENTIAL;
+		MapAdvise(data, data + (mNrowsToRead-1)*strides[0] + mRowSize, advice);
+	}
+
+	// NewFromDescr steals a reference to the descr.  No flags means the
+	// view is read only
+	Py_INCREF(mTypeDescr);
+	PyObject* view = PyArray_NewFromDescr(
+			&PyArray_Type, 
+			(PyArray_Descr*) mTypeDescr,
+			1, dims, strides, data, 0, NULL);
+	if (view == NULL) {
+		throw "Could not create view of mapped file";
+	}
+
+	// The view keeps the mapping alive after we are gone
+	Py_INCREF(mMapOwner);
+#if NPY_API_VERSION >= 0x00000007
+	if (PyArray_SetBaseObject((PyArrayObject*) view, mMapOwner) != 0) {
+		Py_DECREF(view);
+		throw "Could not set base of mapped view";
+	}
+#else
+	PyArray_BASE(view) = mMapOwner;
+#endif
+	return view;
+}
+
+void Records::ReadRowsMapped()
+{
+	if (mDebug) DebugOut("Gathering rows from mapped file");
+
+	if (mNrowsToRead == 0) {
+		return;
+	}
+
+	// the rows were checked by CheckRows, so the ends give the range
+	npy_intp* rows=NULL;
+	npy_intp rowmin=0, rowmax=mNrowsToRead-1;
+	if (mRowsToRead != NULL) {
+		rows = (npy_intp*) PyArray_DATA(mRowsToRead);
+		rowmin = rows[0];
+		rowmax = rows[mNrowsToRead-1];
+	}
+
+	MakeCopyPlan();
+
+	// Rows more than a page apart on average will not benefit from
+	// readahead; instead ask for each row a little before we copy it
+	npy_intp span = (rowmax-rowmin+1)*mRowSize;
+	bool sparse = (rows != NULL && span/mNrowsToRead > RecordsPageSize());
+	MapAdvise(mMapData + rowmin*mRowSize, mMapData + rowmin*mRowSize + span,
+			sparse ? MADV_RANDOM : MADV_SEQUENTIAL);
+
+	const npy_intp lookahead=1024;
+	npy_intp ahead=0;
+
+	char* out = mData;
+	Py_BEGIN_ALLOW_THREADS
+	for (npy_intp irow=0; irow<mNrowsToRead; irow++) {
+		if (sparse) {
+			for (; ahead < mNrowsToRead && ahead < irow+lookahead; ahead++) {
+				const char* p = mMapData + rows[ahead]*mRowSize;
+				MapAdvise(p, p+mRowSize, MADV_WILLNEED);
+			}
+		}
+
+		npy_intp row = (rows != NULL) ? rows[irow] : irow;
+		CopyRow(out, mMapData + row*mRowSize);
+		out += mCopyRowsize;
+	}
+	Py_END_ALLOW_THREADS
+}
+
+void Records::MakeCopyPlan()
+{
+	// Kept fields that are adjacent in the file are adjacent in the
+	// output too, so copy them together
+	mCopySrc.clear();
+	mCopyDst.clear();
+	mCopyLen.clear();
+	mCopyRowsize=0;
+	for (npy_intp fnum=0; fnum<mNfields; fnum++) {
+		if (!mKeep[fnum]) {
+			continue;
+		}
+		size_t n = mCopyLen.size();
+		if (n > 0 && mCopySrc[n-1]+mCopyLen[n-1] == mOffsets[fnum]) {
+			mCopyLen[n-1] += mSizes[fnum];
+		} else {
+			mCopySrc.push_back(mOffsets[fnum]);
+			mCopyDst.push_back(mCopyRowsize);
+			mCopyLen.push_back(mSizes[fnum]);
+		}
+		mCopyRowsize += mSizes[fnum];
+	}
+}
+
+inline void Records::CopyRow(char* out, const char* row)
+{
+	size_t nrun = mCopyLen.size();
+	for (size_t irun=0; irun<nrun; irun++) {
+		memcpy(out + mCopyDst[irun], row + mCopySrc[irun], mCopyLen[irun]);
+	}
+}
+
+static bool PreadAll(int fd, char* buf, size_t nbytes, off_t pos)
+{
+	while (nbytes > 0) {
+		ssize_t nread = pread(fd, buf, nbytes, pos);
+		if (nread < 0 && errno == EINTR) {
+			continue;
+		}
+		if (nread <= 0) {
+			return false;
+		}
+		buf += nread;
+		nbytes -= nread;
+		pos += nread;
+	}
+	return true;
+}
+
+// Read binary rows in large blocks with pread and scatter the kept fields
+// into the output.  The rows are the list checked by CheckRows if sent,
+// otherwise row1, row1+step, ...  Rows closer together than BLOCK_MAXGAP are
+// read in the same block, so a sparse list costs one read per run of nearby
+// rows.
+void Records::ReadBinaryBlocks(const npy_intp* rows, npy_intp row1, npy_intp step)
+{
+	if (mDebug) DebugOut("Reading binary rows in blocks");
+	if (mNrowsToRead == 0) {
+		return;
+	}
+
+	MakeCopyPlan();
+
+	// pread does not see what is buffered in the stream
+	fflush(mFptr);
+	int fd = fileno(mFptr);
+	off_t start = ftello(mFptr);
+	if (start < 0) {
+		throw "Could not get file position";
+	}
+
+	npy_intp bufsize = BLOCK_BUFSIZE;
+	if (bufsize < mRowSize) {
+		bufsize = mRowSize;
+	}
+	void* buf=NULL;
+	if (posix_memalign(&buf, BLOCK_ALIGN, bufsize) != 0) {
+		throw "Could not allocate read buffer";
+	}
+
+	const char* err=NULL;
+	char* out = mData;
+	npy_intp lastrow=-1;
+	npy_intp irow=0;
+	while (irow < mNrowsToRead) {
+		npy_intp first = rows ? rows[irow] : row1 + irow*step;
+
+		// grow the block while the gaps are small and it fits the buffer
+		npy_intp last=first;
+		npy_intp iend=irow+1;
+		for (; iend<mNrowsToRead; iend++) {
+			npy_intp next = rows ? rows[iend] : row1 + iend*step;
+			if ((next-last-1)*mRowSize > BLOCK_MAXGAP
+					|| (next-first+1)*mRowSize > bufsize) {
+				break;
+			}
+			last=next;
+		}
+
+		bool ok;
+		char* block = (char*) buf;
+		Py_BEGIN_ALLOW_THREADS
+		ok = PreadAll(fd, block, (last-first+1)*mRowSize, 
+				start + (off_t) first*mRowSize);
+		if (ok) {
+			for (npy_intp i=irow; i<iend; i++) {
+				npy_intp row = rows ? rows[i] : row1 + i*step;
+				CopyRow(out, block + (row-first)*mRowSize);
+				out += mCopyRowsize;
+			}
+		}
+		Py_END_ALLOW_THREADS
+
+		if (!ok) {
+			err = "Error reading rows";
+			break;
+		}
+		lastrow=last;
+		irow=iend;
+	}
+	free(buf);
+
+	if (err != NULL) {
+		throw err;
+	}
+
+	// leave the file after the last row, as the freads did
+	if (fseeko(mFptr, start + (off_t) (lastrow+1)*mRowSize, SEEK_SET) != 0) {
+		throw "Failed to fseek";
+	}
+}
+
+// Count the newlines in part of a mapped ascii file
+struct AsciiCountJob {
+	const char* begin;
+	const char* end;
+	npy_intp nlines;
+
+	static void* run(void* arg) {
+		AsciiCountJob* job = (AsciiCountJob*) arg;
+		const char* p = job->begin;
+		npy_intp n=0;
+		while (p < job->end) {
+			p = (const char*) memchr(p, '\n', job->end-p);
+			if (p == NULL) {
+				break;
+			}
+			p++;
+			n++;
+		}
+		job->nlines = n;
+		return NULL;
+	}
+};
+
+// Parse the output rows [irow1,irow2), which start in the part of a mapped
+// ascii file beginning at the cursor position
+struct AsciiParseJob {
+	Records* records;
+	AsciiCursor cur;
+	npy_intp line; // line at the cursor
+	const npy_intp* rows;
+	npy_intp row1;
+	npy_intp step;
+	npy_intp irow1;
+	npy_intp irow2;
+	bool failed;
+	string err;
+
+	static void* run(void* arg) {
+		AsciiParseJob* job = (AsciiParseJob*) arg;
+		job->failed = false;
+		try {
+			job->records->ReadAsciiRange(job->cur, job->line, 
+					job->rows, job->row1, job->step, job->irow1, job->irow2);
+		} catch (const char* err) {
+			job->failed = true;
+			job->err = err;
+		}
+		return NULL;
+	}
+};
+
+// The first of the nrows requested rows that is at or after line
+static npy_intp AsciiFirstRow(const npy_intp* rows, npy_intp row1, 
+		npy_intp step, npy_intp nrows, npy_intp line)
+{
+	if (rows != NULL) {
+		return lower_bound(rows, rows+nrows, line) - rows;
+	}
+	if (line <= row1) {
+		return 0;
+	}
+	npy_intp irow = (line - row1 + step - 1)/step;
+	return (irow < nrows) ? irow : nrows;
+}
+
+// Read ascii rows in parallel from a mapping of the file.  The rows are the
+// list checked by CheckRows if sent, otherwise row1, row1+step, ...  The file is split at
+// line boundaries into a chunk per thread, and the lines in each are counted
+// with memchr.  Then each thread parses the requested rows that start in
+// its chunk straight into the output.  Returns false, having done nothing,
+// if we are not threading or the file cannot be mapped.
+bool Records::ReadAsciiThreaded(const npy_intp* rows, npy_intp row1, npy_intp step)
+{
+	if (mNthreads <= 1 || mNrowsToRead == 0) {
+		return false;
+	}
+
+	// The rows start at the current file position, as for the stream
+	fflush(mFptr);
+	int fd = fileno(mFptr);
+	off_t start = ftello(mFptr);
+	struct stat st;
+	if (start < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) 
+			|| st.st_size <= start) {
+		return false;
+	}
+
+	off_t pagestart = start - start % RecordsPageSize();
+	size_t maplen = (size_t) (st.st_size - pagestart);
+	void* addr = mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, fd, pagestart);
+	if (addr == MAP_FAILED) {
+		return false;
+	}
+	if (mDebug) DebugOut("Reading ascii rows with threads");
+
+	const char* data = (const char*) addr + (start - pagestart);
+	size_t nbytes = (size_t) (st.st_size - start);
+	MapAdvise(data, data+nbytes, MADV_SEQUENTIAL);
+
+	npy_intp nthreads = mNthreads;
+	if (nthreads > mNrowsToRead) {
+		nthreads = mNrowsToRead;
+	}
+
+	npy_intp rowsize=0;
+	for (npy_intp fnum=0; fnum<mNfields; fnum++) {
+		if (mKeep[fnum]) {
+			rowsize += mSizes[fnum];
+		}
+	}
+
+	vector<AsciiCountJob> counts(nthreads);
+	vector<AsciiParseJob> jobs(nthreads);
+
+	Py_BEGIN_ALLOW_THREADS
+
+	// Each chunk starts at the beginning of a line
+	size_t begin=0;
+	for (npy_intp t=0; t<nthreads; t++) {
+		size_t end = nbytes;
+		if (t < nthreads-1) {
+			end = nbytes/nthreads*(t+1);
+			if (end <= begin) {
+				end = begin;
+			} else {
+				const char* nl = (const char*) 
+					memchr(data+end-1, '\n', nbytes-end+1);
+				end = (nl != NULL) ? (size_t) (nl-data+1) : nbytes;
+			}
+		}
+		counts[t].begin = data + begin;
+		counts[t].end = data + end;
+		begin = end;
+	}
+	run_jobs(counts);
+
+	npy_intp line=0;
+	for (npy_intp t=0; t<nthreads; t++) {
+		AsciiParseJob& job = jobs[t];
+		job.records = this;
+		job.line = line;
+		job.rows = rows;
+		job.row1 = row1;
+		job.step = step;
+
+		// the last chunk also gets any rows past the end of the file, and
+		// reports the error
+		line += counts[t].nlines;
+		job.irow1 = AsciiFirstRow(rows, row1, step, mNrowsToRead, job.line);
+		if (t < nthreads-1) {
+			job.irow2 = AsciiFirstRow(rows, row1, step, mNrowsToRead, line);
+		} else {
+			job.irow2 = mNrowsToRead;
+		}
+
+		job.cur.buf = data;
+		job.cur.pos = counts[t].begin - data;
+		job.cur.end = nbytes;
+		job.cur.eof = true;
+		job.cur.data = mData + job.irow1*rowsize;
+	}
+	run_jobs(jobs);
+
+	Py_END_ALLOW_THREADS
+
+	munmap(addr, maplen);
+
+	// leave the file after the last row, as the sequential reader does
+	size_t last=0;
+	for (npy_intp t=0; t<nthreads; t++) {
+		if (jobs[t].failed) {
+			mAscii.err = jobs[t].err;
+			throw mAscii.err.c_str();
+		}
+		if (jobs[t].irow2 > jobs[t].irow1) {
+			last = jobs[t].cur.pos;
+		}
+	}
+	if (fseeko(mFptr, start + (off_t) last, SEEK_SET) != 0) {
+		throw "Failed to fseek";
+	}
+	return true;
+}
+
+// Read the output rows [irow1,irow2) as ReadRows does, starting at the
+// beginning of the given line
+void Records::ReadAsciiRange(AsciiCursor& c, npy_intp line,
+		const npy_intp* rows, npy_intp row1, npy_intp step, 
+		npy_intp irow1, npy_intp irow2)
+{
+	for (npy_intp irow=irow1; irow<irow2; irow++) {
+		npy_intp row = rows ? rows[irow] : row1 + irow*step;
+
+		if (row > line) {
+			SkipAsciiRows(c, row-line);
+			line=row;
+		}
+
+		ReadAsciiFields(c);
+		line++;
+	}
+}
 
 
 
@@ -283,7 +877,7 @@ void Records::ReadRow()
 	
 	} else {
 		// Reading particular fields
-		ReadAsciiFields();
+		ReadAsciiFields(mAscii);
 	}
 }
 
@@ -325,11 +919,11 @@ void Records::DoSeek(npy_intp seek_distance) {
 	}
 }
 
-void Records::ReadAsciiFields()
+void Records::ReadAsciiFields(AsciiCursor& c)
 {
 	for (npy_intp fnum=0; fnum<mNfields; fnum++) {
 		// This program understands when a field is skipped
-		ReadFieldAsAscii(fnum);
+		ReadFieldAsAscii(c, fnum);
 	}
 }
 
@@ -362,100 +956,573 @@ void Records::ReadFieldAsBinary(long long fnum)
 	mData = mData+mSizes[fnum];
 }
 
-void Records::ReadFieldAsAscii(long long fnum)
+void Records::ReadFieldAsAscii(AsciiCursor& c, long long fnum)
 {
 
 	if (mTypeNums[fnum] == NPY_STRING) {
-		ReadAsciiBytes(fnum);
+		ReadAsciiBytes(c, fnum);
 	} else {
-		ScanVal(fnum);
+		ScanVal(c, fnum);
 		// For whitespace we haven't read the delimiter yet
 		if (mReadAsWhitespace) {
-			//char c = fgetc(mFptr);
-			fgetc(mFptr);
+			AsciiGetc(c);
 		}
 	}
 
 	// Move the data pointer if we actually read this to the buffer
 	if (mKeep[fnum]) {
-		mData = mData+mSizes[fnum];
+		c.data = c.data+mSizes[fnum];
 	}
 }
 
-void Records::ReadAsciiBytes(long long fnum)
+void Records::ReadAsciiBytes(AsciiCursor& c, long long fnum)
 {
-	char c;
-	char* buff;
-	// If we are skipping this field just read into a different buffer
-	if (mKeep[fnum]) {
-		buff = mData;
-	} else {
-		//buff = &mBuffer[0];
-		buff = (char *) mBuffer.c_str();
-	}
-
 	// Read the expected number of bytes *per element* as opposed to binary
-	int size_per_el = mSizes[fnum]/mNel[fnum];
+	size_t size_per_el = mSizes[fnum]/mNel[fnum];
 
 	// Loop over each element for ascii. Must do this because
 	// of the delimters
 	for (long long el=0; el<mNel[fnum]; el++) {
 
-		for (long long i=0; i<size_per_el; i++) {
-			c=fgetc(mFptr);
-			if (c==EOF) {
-				string err=
-					"EOF reached unexpectedly reading field: "+
-					mNames[fnum];
-				throw err.c_str();
-			}
-			*buff = c;
-			buff++;
+		if (!AsciiFill(c, size_per_el)) {
+			c.err=
+				"EOF reached unexpectedly reading field: "+
+				mNames[fnum];
+			throw c.err.c_str();
 		}
+		// If we are skipping this field just move past it
+		if (mKeep[fnum]) {
+			memcpy(c.data + el*size_per_el, c.buf + c.pos, size_per_el);
+		}
+		c.pos += size_per_el;
 
 		// Read the delimiter or EOL
-		c=fgetc(mFptr);
+		AsciiGetc(c);
 
 	}
 }
 
-void Records::ScanVal(long long fnum)
+void Records::ScanVal(AsciiCursor& c, long long fnum)
 {
 
+	// If we are skipping this field just read into a scratch value
+	long double scratch[2];
 	char* buff;
-	// If we are skipping this field just read into a different buffer
 	if (mKeep[fnum]) {
-		buff = mData;
+		buff = c.data;
 	} else {
-		//buff = &mBuffer[0];
-		buff = (char *) mBuffer.c_str();
+		buff = (char *) scratch;
 	}
 
-
-	int type_num = mTypeNums[fnum];
-
-	//{cout<<"  ScanVal with format: "<<mScanFormats[type_num].c_str()<<endl;
-	//		fflush(stdout);}
+	size_t size_per_el = mSizes[fnum]/mNel[fnum];
 	for (long long el=0; el<mNel[fnum]; el++) {
-		int ret = fscanf(mFptr, mScanFormats[type_num].c_str(), buff);
-		if (ret != 1) {
-			string err="ScanVal: Error reading field: "+mNames[fnum];
-			if (feof(mFptr)) {
-				err += ": EOF reached unexpectedly";
+		size_t len = AsciiToken(c);
+		size_t nused = 0;
+		if (len > 0) {
+			nused = ParseAsciiValue(c, mTypeNums[fnum], size_per_el, 
+					c.buf + c.pos, len, buff);
+		}
+		if (nused == 0) {
+			c.err="ScanVal: Error reading field: "+mNames[fnum];
+			if (len == 0 && c.eof) {
+				c.err += ": EOF reached unexpectedly";
 			}
 			else {
-				err = + ": Read error";
+				c.err += ": Read error";
 			}
-			throw err.c_str();
+			throw c.err.c_str();
+		}
+		c.pos += nused;
+
+		// what the " "+delim at the end of the scan format did
+		if (!mReadAsWhitespace) {
+			AsciiSkipDelim(c);
+		}
+		buff += size_per_el;
+	}
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// Eight ascii digits loaded into a little endian word
+static inline bool IsEightDigits(uint64_t v)
+{
+	return ((v & 0xF0F0F0F0F0F0F0F0ULL) 
+			| (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+		== 0x3333333333333333ULL;
+}
+
+static inline uint64_t ParseEightDigits(uint64_t v)
+{
+	const uint64_t mask = 0x000000FF000000FFULL;
+	const uint64_t mul1 = 0x000F424000000064ULL; // 100 + (1000000 << 32)
+	const uint64_t mul2 = 0x0000271000000001ULL; // 1 + (10000 << 32)
+	v -= 0x3030303030303030ULL;
+	v = (v * 10) + (v >> 8);
+	v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+	return (uint32_t) v;
+}
+#endif
+
+// Accumulate the run of digits at p into mant, eight at a time where we
+// can.  ndig counts the significant digits, possibly too many after an
+// eight digit step; digits past 19 are not added, so callers must check
+// it.  Returns the length of the run
+static inline size_t ParseAsciiDigits(
+		const char* p, size_t len, uint64_t* mant, int* ndig)
+{
+	size_t i=0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	while (len-i >= 8 && *ndig <= 11) {
+		uint64_t v;
+		memcpy(&v, p+i, 8);
+		if (!IsEightDigits(v)) {
+			break;
+		}
+		*mant = *mant*100000000 + ParseEightDigits(v);
+		if (*mant != 0) {
+			*ndig += 8;
+		}
+		i += 8;
+	}
+#endif
+	for (; i<len; i++) {
+		unsigned d = (unsigned char) p[i] - '0';
+		if (d > 9) {
+			break;
+		}
+		if (*mant == 0 && d == 0) {
+			continue;
+		}
+		if (++*ndig <= 19) {
+			*mant = *mant*10 + d;
+		}
+	}
+	return i;
+}
+
+// Parse a decimal integer with at most 18 significant digits, so it cannot
+// overflow.  Returns the number of characters used, or 0 if the integer is
+// empty or too long for us
+static size_t ParseAsciiInt(const char* p, size_t len, int64_t* val)
+{
+	size_t i=0;
+	bool neg=false;
+	if (i < len && (p[i] == '-' || p[i] == '+')) {
+		neg = (p[i] == '-');
+		i++;
+	}
+	uint64_t v=0;
+	int ndig=0;
+	size_t n = ParseAsciiDigits(p+i, len-i, &v, &ndig);
+	if (n == 0 || ndig > 18) {
+		return 0;
+	}
+	*val = neg ? -(int64_t) v : (int64_t) v;
+	return i+n;
+}
+
+// Layout of the floating point types for EiselLemire
+template <typename T> struct AsciiFloatFormat;
+template <> struct AsciiFloatFormat<double> {
+	typedef uint64_t bits;
+	static const int mantissa_bits = 52;
+	static const int min_exponent = -1023;
+	static const int infinite_power = 0x7FF;
+	static const int min_round_even = -4;
+	static const int max_round_even = 23;
+	static const int smallest_pow10 = -342;
+	static const int largest_pow10 = 308;
+};
+template <> struct AsciiFloatFormat<float> {
+	typedef uint32_t bits;
+	static const int mantissa_bits = 23;
+	static const int min_exponent = -127;
+	static const int infinite_power = 0xFF;
+	static const int min_round_even = -17;
+	static const int max_round_even = 10;
+	static const int smallest_pow10 = -65;
+	static const int largest_pow10 = 38;
+};
+
+static inline void Mul128(uint64_t a, uint64_t b, uint64_t* hi, uint64_t* lo)
+{
+#ifdef __SIZEOF_INT128__
+	unsigned __int128 p = (unsigned __int128) a * b;
+	*hi = (uint64_t) (p >> 64);
+	*lo = (uint64_t) p;
+#else
+	uint64_t a0 = a & 0xFFFFFFFF, a1 = a >> 32;
+	uint64_t b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+	uint64_t p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+	uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+	*hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+	*lo = (mid << 32) | (p00 & 0xFFFFFFFF);
+#endif
+}
+
+// Correctly rounded w*10^q for a nonzero mantissa w, by the Eisel-Lemire
+// algorithm as in fast_float.  The rare cases it cannot settle cheaply
+// (subnormals, overflow, products too close to a rounding boundary)
+// return false, and the caller falls back to strtod
+template <typename T>
+static bool EiselLemire(uint64_t w, int64_t q, bool neg, T* val)
+{
+	typedef AsciiFloatFormat<T> F;
+	typedef typename F::bits bits;
+
+	uint64_t mant;
+	int64_t power2;
+	if (q < F::smallest_pow10) {
+		mant=0;
+		power2=0;
+	} else if (q > F::largest_pow10) {
+		mant=0;
+		power2=F::infinite_power;
+	} else {
+		int lz=0;
+		while (!(w & (1ULL<<63))) {
+			w <<= 1;
+			lz++;
+		}
+
+		const uint64_t* p5 = &RECORDS_POW5_128[2*(q - RECORDS_POW5_MINQ)];
+		uint64_t hi, lo;
+		Mul128(w, p5[0], &hi, &lo);
+		const uint64_t mask = 0xFFFFFFFFFFFFFFFFULL >> (F::mantissa_bits+3);
+		if ((hi & mask) == mask) {
+			uint64_t hi2, lo2;
+			Mul128(w, p5[1], &hi2, &lo2);
+			lo += hi2;
+			if (hi2 > lo) {
+				hi++;
+			}
+			if ((hi & mask) == mask && lo == 0xFFFFFFFFFFFFFFFFULL) {
+				return false;
+			}
+		}
+
+		int upperbit = (int) (hi >> 63);
+		int shift = upperbit + 64 - F::mantissa_bits - 3;
+		mant = hi >> shift;
+		power2 = (((152170 + 65536) * q) >> 16) + 63 
+			+ upperbit - lz - F::min_exponent;
+		if (power2 <= 0) {
+			return false;
+		}
+
+		// exact halfway between two floats: round to even
+		if (lo <= 1 && (mant & 3) == 1) {
+			if (q < F::min_round_even || q > F::max_round_even) {
+				return false;
+			}
+			if ((mant << shift) == hi) {
+				mant &= ~1ULL;
+			}
+		}
+
+		mant += (mant & 1);
+		mant >>= 1;
+		if (mant >= (2ULL << F::mantissa_bits)) {
+			mant = (1ULL << F::mantissa_bits);
+			power2++;
+		}
+		mant &= ~(1ULL << F::mantissa_bits);
+		if (power2 >= F::infinite_power) {
+			return false;
+		}
+	}
+
+	bits b = (bits) mant | ((bits) power2 << F::mantissa_bits);
+	if (neg) {
+		b |= (bits) 1 << (8*sizeof(T)-1);
+	}
+	memcpy(val, &b, sizeof(T));
+	return true;
+}
+
+// Parse a plain decimal float, correctly rounded as strtod/strtof would.
+// Clinger's fast path covers mantissas and powers of ten that are exact in
+// the type, where a single multiply or divide is correctly rounded, and
+// EiselLemire most of the rest.  Returns 0 for anything else.  In that
+// case simple is set if the token is still a plain decimal number, which
+// strtod will read exactly as scanf does; otherwise (inf, nan, hex...) the
+// caller must use scanf
+template <typename T>
+static size_t ParseAsciiFloat(const char* p, size_t len, T* val, bool* simple)
+{
+	static const T pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const int maxpow = (sizeof(T) == 4) ? 10 : 22;
+	const uint64_t maxmant = (sizeof(T) == 4) ? (1ULL<<24) : (1ULL<<53);
+
+	*simple=false;
+	size_t i=0;
+	bool neg=false;
+	if (i < len && (p[i] == '-' || p[i] == '+')) {
+		neg = (p[i] == '-');
+		i++;
+	}
+
+	uint64_t mant=0;
+	int ndig=0, exp10=0;
+	size_t n = ParseAsciiDigits(p+i, len-i, &mant, &ndig);
+	bool any = (n > 0);
+	i += n;
+	if (i < len && p[i] == '.') {
+		i++;
+		n = ParseAsciiDigits(p+i, len-i, &mant, &ndig);
+		any = any || (n > 0);
+		i += n;
+		exp10 -= (int) n;
+	}
+	if (!any) {
+		return 0;
+	}
+	if (i < len && (p[i] == 'x' || p[i] == 'X')) {
+		return 0;
+	}
+	if (i < len && (p[i] == 'e' || p[i] == 'E')) {
+		size_t j=i+1;
+		bool eneg=false;
+		if (j < len && (p[j] == '-' || p[j] == '+')) {
+			eneg = (p[j] == '-');
+			j++;
+		}
+		if (j >= len || (unsigned) ((unsigned char) p[j] - '0') > 9) {
+			return 0;
+		}
+		int e=0;
+		for (; j<len; j++) {
+			unsigned d = (unsigned char) p[j] - '0';
+			if (d > 9) {
+				break;
+			}
+			if (e < 100000) {
+				e = e*10 + d;
+			}
+		}
+		exp10 += eneg ? -e : e;
+		i=j;
+	}
+
+	*simple=true;
+
+	if (mant == 0) {
+		*val = neg ? -(T) 0 : (T) 0;
+		return i;
+	}
+	if (ndig > 19) {
+		return 0;
+	}
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	// with excess precision this would round twice
+	if (mant <= maxmant && exp10 >= -maxpow && exp10 <= maxpow) {
+		T v = (T) mant;
+		if (exp10 < 0) {
+			v /= pow10[-exp10];
+		} else {
+			v *= pow10[exp10];
+		}
+		*val = neg ? -v : v;
+		return i;
+	}
+#endif
+
+	if (EiselLemire(mant, exp10, neg, val)) {
+		return i;
+	}
+	return 0;
+}
+
+template <typename T>
+static inline void StoreAsciiInt(char* buff, int64_t v)
+{
+	// truncate to the output width as scanf does
+	T t = (T) (uint64_t) v;
+	memcpy(buff, &t, sizeof(T));
+}
+
+// Convert the token into the output, returning the number of characters
+// used or 0 on failure.  Common cases are parsed here, anything else
+// goes through sscanf with the same conversion fscanf used
+size_t Records::ParseAsciiValue(AsciiCursor& c,
+		int type_num, size_t size, const char* tok, size_t len, char* buff)
+{
+	size_t nused=0;
+	bool simple=false;
+	char* end;
+
+	switch (mAsciiKinds[type_num]) {
+		case ASCII_INT:
+			int64_t v;
+			nused = ParseAsciiInt(tok, len, &v);
+			if (nused > 0) {
+				switch (size) {
+					case 1: StoreAsciiInt<uint8_t>(buff, v); break;
+					case 2: StoreAsciiInt<uint16_t>(buff, v); break;
+					case 4: StoreAsciiInt<uint32_t>(buff, v); break;
+					case 8: StoreAsciiInt<uint64_t>(buff, v); break;
+					default: nused=0;
+				}
+			}
+			break;
+		case ASCII_FLOAT:
+			nused = ParseAsciiFloat(tok, len, (float*) buff, &simple);
+			if (nused == 0 && simple) {
+				// scanf hands plain decimals to strtof
+				c.token.assign(tok, len);
+				*(float*) buff = strtof(c.token.c_str(), &end);
+				nused = end - c.token.c_str();
+			}
+			break;
+		case ASCII_DOUBLE:
+			nused = ParseAsciiFloat(tok, len, (double*) buff, &simple);
+			if (nused == 0 && simple) {
+				c.token.assign(tok, len);
+				*(double*) buff = strtod(c.token.c_str(), &end);
+				nused = end - c.token.c_str();
+			}
+			break;
+	}
+
+	if (nused == 0) {
+		c.token.assign(tok, len);
+		string fmt = mScanFormats[type_num] + "%n";
+		int n=0;
+		if (sscanf(c.token.c_str(), fmt.c_str(), buff, &n) == 1) {
+			nused = n;
+		}
+	}
+	return nused;
+}
+
+
+void Records::AsciiBegin()
+{
+	// the plain conversions, used when our parsers decline
+	MakeScanFormats(false);
+
+	// which of our parsers matches each conversion
+	mAsciiKinds.assign(mScanFormats.size(), (int) ASCII_SCANF);
+	for (size_t i=0; i<mScanFormats.size(); i++) {
+		const string& fmt = mScanFormats[i];
+		char conv = fmt[fmt.size()-1];
+		if (conv == 'd' || conv == 'u') {
+			mAsciiKinds[i] = ASCII_INT;
+		} else if (fmt == "%f") {
+			mAsciiKinds[i] = ASCII_FLOAT;
+		} else if (fmt == "%lf") {
+			mAsciiKinds[i] = ASCII_DOUBLE;
+		}
+	}
+	mAsciiBuf.resize(ASCII_BUFSIZE);
+	mAscii.buf=&mAsciiBuf[0];
+	mAscii.pos=0;
+	mAscii.end=0;
+	mAscii.eof=false;
+	mAscii.data=mData;
+}
+
+void Records::AsciiEnd()
+{
+	// Give back what we read ahead, so the file is left after the last row
+	// as it was with stdio.  This fails harmlessly on pipes
+	size_t nahead = mAscii.end - mAscii.pos;
+	if (nahead > 0) {
+		fseeko(mFptr, -(off_t) nahead, SEEK_CUR);
+	}
+	mAscii.pos=0;
+	mAscii.end=0;
+}
+
+// Make sure at least need bytes are buffered, reading another chunk from
+// the file if not.  Returns false if EOF comes first.  Only the sequential
+// cursor is ever refilled; the others start at EOF
+bool Records::AsciiFill(AsciiCursor& c, size_t need)
+{
+	while (c.end - c.pos < need) {
+		if (c.eof) {
+			return false;
+		}
+
+		// keep the unread bytes, growing if a token is huge
+		size_t nkeep = c.end - c.pos;
+		if (c.pos > 0) {
+			memmove(&mAsciiBuf[0], &mAsciiBuf[c.pos], nkeep);
+			c.pos=0;
+			c.end=nkeep;
+		}
+		if (c.end == mAsciiBuf.size()) {
+			mAsciiBuf.resize(2*mAsciiBuf.size());
 		}
-		buff += mSizes[fnum]/mNel[fnum] ;
+		c.buf = &mAsciiBuf[0];
+
+		size_t nread = fread(&mAsciiBuf[c.end], 1, 
+				mAsciiBuf.size()-c.end, mFptr);
+		if (nread == 0) {
+			c.eof=true;
+		}
+		c.end += nread;
 	}
+	return true;
 }
 
+int Records::AsciiGetc(AsciiCursor& c)
+{
+	if (!AsciiFill(c, 1)) {
+		return EOF;
+	}
+	return (unsigned char) c.buf[c.pos++];
+}
 
+// isspace in the C locale, which is what scanf skips
+static inline bool AsciiIsSpace(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
 
+void Records::AsciiSkipSpace(AsciiCursor& c)
+{
+	do {
+		while (c.pos < c.end && AsciiIsSpace(c.buf[c.pos])) {
+			c.pos++;
+		}
+	} while (c.pos == c.end && AsciiFill(c, 1));
+}
 
+void Records::AsciiSkipDelim(AsciiCursor& c)
+{
+	AsciiSkipSpace(c);
+	for (size_t i=0; i<mDelim.size(); i++) {
+		if (!AsciiFill(c, 1) || c.buf[c.pos] != mDelim[i]) {
+			break;
+		}
+		c.pos++;
+	}
+}
 
+// Skip whitespace and make sure the following token, up to the next
+// whitespace or delimiter, is buffered.  Returns its length
+size_t Records::AsciiToken(AsciiCursor& c)
+{
+	AsciiSkipSpace(c);
+	char delim = mDelim[0];
+	size_t len=0;
+	for (;;) {
+		const char* p = c.buf + c.pos;
+		size_t avail = c.end - c.pos;
+		for (; len<avail; len++) {
+			if (AsciiIsSpace(p[len]) || p[len] == delim) {
+				return len;
+			}
+		}
+		if (!AsciiFill(c, avail+1)) {
+			return len;
+		}
+	}
+}
 
 
 
@@ -482,7 +1549,7 @@ void Records::SkipFieldAsBinary(long long fnum)
 // skipping
 void Records::SkipFieldAsAscii(long long fnum)
 {
-	ReadFieldAsAscii(fnum);
+	ReadFieldAsAscii(mAscii, fnum);
 }
 
 
@@ -510,26 +1577,32 @@ void Records::SkipRows(long long current_row, long long row2read)
 		} else {
 			rows2skip = row2read - current_row;
 		}
-		SkipAsciiRows(rows2skip);
+		SkipAsciiRows(mAscii, rows2skip);
 	}
 }
 
 
 
-void Records::SkipAsciiRows(long long nskip)
+void Records::SkipAsciiRows(AsciiCursor& c, long long nskip)
 {
-	if (nskip > 0) {
-		long long nlines = 0;
-		char c;
+	long long nlines = 0;
+	while (nlines < nskip) {
+		if (!AsciiFill(c, 1)) {
+			throw "Reached EOF prematurely";
+		}
+		const char* start = c.buf;
+		const char* p = start + c.pos;
+		const char* end = start + c.end;
 		while (nlines < nskip) {
-			c = fgetc(mFptr);
-			if (c == EOF) {
-				throw "Reached EOF prematurely";
-			}
-			if (c == '\n') {
-				nlines++;
+			const char* nl = (const char*) memchr(p, '\n', end-p);
+			if (nl == NULL) {
+				p = end;
+				break;
 			}
+			p = nl+1;
+			nlines++;
 		}
+		c.pos = p - start;
 	}
 }
 
@@ -955,6 +2028,7 @@ void Records::ProcessRowsToRead(PyObject* rows)
 	} else {
 		// How many to read
 		mNrowsToRead = PyArray_SIZE(mRowsToRead);
+		CheckRows((const npy_intp*) PyArray_DATA(mRowsToRead));
 	}
 
 	if (mNrowsToRead > mNrows) {
@@ -974,8 +2048,9 @@ void Records::ProcessRowsToRead(PyObject* rows)
 void Records::ProcessNrows(long long nrows) 
 {
 	if (mDebug) {cout<<"nrows = "<<nrows<<endl;fflush(stdout);}
-	if (nrows < 1) {
-		throw "Input nrows must be >= 1";
+	// zero rows is an empty file, which reads as an empty array
+	if (nrows < 0) {
+		throw "Input nrows must be >= 0";
 	}
 	mNrows = nrows;
 }
@@ -13,8 +13,29 @@
 
 using namespace std;
 
+#ifndef SWIG
+struct AsciiParseJob;
+
+// Position in ascii data being parsed, and where the next kept value is
+// stored.  The sequential reader refills buf from the file; a thread
+// reading a mapped file has all the data in [0,end) and eof set
+struct AsciiCursor {
+	const char* buf;
+	size_t pos;
+	size_t end;
+	bool eof;
+	char* data;
+	// NUL terminated copy of a token for sscanf
+	string token;
+	// message for the last error thrown
+	string err;
+};
+#endif
+
 
 class Records {
+	friend struct AsciiParseJob;
+
     public:
 	/*
 		Records() throw (const char*);
@@ -52,12 +73,22 @@ Class
                 numpy.dtype([('field1', 'i4'),('field2', 'f8')])
                 some_numpy_array.dtype
             nrows: The number of rows in the file.  REQUIRED FOR READING.
+            bracket_arrays: Write array fields in ascii files as {a,b,c}
+            use_mmap: For binary files, map the file into memory rather than
+                reading through stdio.  Full reads and slices with step
+                are returned as read-only views of the mapping, while
+                row and field subsets are gathered from the mapping into
+                a new array.  Default False.
+            nthreads: For ascii files, the number of threads used to parse
+                the rows.  The file must be a regular file, which is
+                mapped and split at line boundaries, so each row must be
+                on its own line.  Default 1.
 
     Class Methods:
         Read(rows=, fields=):
             Returns the data in a NumPy array.  Specific rows and fields 
             of the file can be specified with the keywords.  Rows must be
-            sorted and unique.  Can be in any order.
+            sorted and unique.  Fields can be in any order.
         Write(numpy_array):
             Write the input numpy array to the file.  The array must have
             field names defined.
@@ -94,7 +125,9 @@ Modification history:
 				PyObject* delim=NULL, 
 				PyObject* dtype=NULL,
 				long long nrows=-9999,
-                int bracket_arrays=0) throw (const char *);
+                int bracket_arrays=0,
+                int use_mmap=0,
+                int nthreads=1) throw (const char *);
 
         ~Records();
 
@@ -110,7 +143,8 @@ Modification history:
 
 		Inputs:
 		    rows:  A sorted unique set of rows.  May be a scala/rlist/array.
-		      Default is all rows.
+		      Default is all rows.  Unsorted or repeated rows
+		      are an error for every file type.
 		    fields: The fields to read.  May be a single string or a list
 		      of strings.  Can be in any order.  Default is all fields.
 		Examples:
@@ -200,24 +234,58 @@ Modification history:
 		void ReadAllAsBinary();
 
 		void ReadRows();
+		// Ascii rows are read in one pass, so they must be increasing
+		void CheckRows(const npy_intp* rows);
 
 		void ReadRowsSlice(npy_intp row1, npy_intp step) throw (const char* );
 
+		// Parallel reading of ascii rows from a mapped file.  Returns
+		// false if the file cannot be read this way
+		bool ReadAsciiThreaded(const npy_intp* rows, npy_intp row1, npy_intp step);
+		void ReadAsciiRange(AsciiCursor& c, npy_intp line, 
+				const npy_intp* rows, npy_intp row1, npy_intp step, 
+				npy_intp irow1, npy_intp irow2);
+
+		// Reading through a memory map of a binary file
+		bool UseMap();
+		void MapFile();
+		void MapAdvise(const char* begin, const char* end, int advice);
+		PyObject* MapView(npy_intp row1, npy_intp step);
+		void ReadRowsMapped();
+
+		// Block reads of binary rows, copying the kept fields as planned
+		// by MakeCopyPlan
+		void MakeCopyPlan();
+		void CopyRow(char* out, const char* row);
+		void ReadBinaryBlocks(const npy_intp* rows, npy_intp row1, npy_intp step);
+
 		void ReadRow();
-		void ReadAsciiFields();
+		void ReadAsciiFields(AsciiCursor& c);
 		void ReadBinaryFields();
 		void DoSeek(npy_intp seek_distance);
 		//void ReadField(long long fnum);
 		void ReadFieldAsBinary(long long fnum);
-		void ReadFieldAsAscii(long long fnum);
-		void ReadAsciiBytes(long long fnum);
-		void ScanVal(long long fnum);
+		void ReadFieldAsAscii(AsciiCursor& c, long long fnum);
+		void ReadAsciiBytes(AsciiCursor& c, long long fnum);
+		void ScanVal(AsciiCursor& c, long long fnum);
+		size_t ParseAsciiValue(AsciiCursor& c,
+				int type_num, size_t size, 
+				const char* tok, size_t len, char* buff);
+
+		// Buffered reading of ascii files in large chunks
+		void AsciiBegin();
+		void AsciiEnd();
+		bool AsciiFill(AsciiCursor& c, size_t need);
+		int AsciiGetc(AsciiCursor& c);
+		void AsciiSkipSpace(AsciiCursor& c);
+		void AsciiSkipDelim(AsciiCursor& c);
+		size_t AsciiToken(AsciiCursor& c);
 		void SkipField(long long fnum);
 		void SkipFieldAsBinary(long long fnum);
 		void SkipFieldAsAscii(long long fnum);
 		void ReadWholeRowBinary();
 		void SkipRows(long long current_row, long long row2read);
-		void SkipAsciiRows(long long nskip);
+		void SkipAsciiRows(AsciiCursor& c, long long nskip);
 		void SkipBinaryRows(long long nskip);
 
 		void MakeScanFormats(bool add_delim);
@@ -305,8 +373,12 @@ Modification history:
 		// points to data area
 		char* mData;                                           //---
 
-		// A buffer for when skipping ascii
-		string mBuffer;
+		// Buffer for reading ascii, and the sequential reader's position
+		// in it
+		vector<char> mAsciiBuf;
+		AsciiCursor mAscii;
+		// Parser to use for each type number
+		vector<int> mAsciiKinds;
 
 		// Will hold scan and print formats for each data type
 		vector<string> mScanFormats;
@@ -316,6 +388,24 @@ Modification history:
 		FILE* mFptr;                                           //---
 		bool mFptrIsLocal;                                     //---
 
+		// Threads for parsing ascii
+		int mNthreads;                                         //---
+
+		// Memory map of the binary data.  The mapping is owned by a
+		// capsule so that views returned to python can outlive us
+		int mUseMmap;                                          //---
+		PyObject* mMapOwner;                                   //--- +++
+		char* mMapData;    // first byte of row 0              //---
+		// message for the last error thrown from the mapped reads
+		string mErr;
+
+		// Runs of kept bytes to copy from each row: source offset, offset
+		// in the output row, and length
+		vector<npy_intp> mCopySrc;
+		vector<npy_intp> mCopyDst;
+		vector<npy_intp> mCopyLen;
+		npy_intp mCopyRowsize;
+
 		// Delimiter for ascii files
 		string mDelim;
         // this can be different when bracket_arrays is sent
@@ -373,6 +463,21 @@ Modification history:
 		static const int BINARY_FILE = 0;
 		static const int ASCII_FILE = 1;
 
+		// Buffer for block reads of binary rows, and the largest gap
+		// between requested rows that we read through rather than skip
+		static const npy_intp BLOCK_BUFSIZE = 4*1024*1024;
+		static const npy_intp BLOCK_MAXGAP = 64*1024;
+		static const size_t BLOCK_ALIGN = 4096;
+
+		// Chunk size for reading ascii
+		static const size_t ASCII_BUFSIZE = 1024*1024;
+
+		// Parsers for ascii numbers
+		static const int ASCII_SCANF = 0;
+		static const int ASCII_INT = 1;
+		static const int ASCII_FLOAT = 2;
+		static const int ASCII_DOUBLE = 3;
+
         int mBracketArrays;
 
 		static const bool mDebug=false;
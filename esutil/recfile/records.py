@@ -95,12 +95,22 @@ class Records(_object):
                         numpy.dtype([('field1', 'i4'),('field2', 'f8')])
                         some_numpy_array.dtype
                     nrows: The number of rows in the file.  REQUIRED FOR READING.
+                    bracket_arrays: Write array fields in ascii files as {a,b,c}
+                    use_mmap: For binary files, map the file into memory rather than
+                        reading through stdio.  Full reads and slices with step
+                        are returned as read-only views of the mapping, while
+                        row and field subsets are gathered from the mapping into
+                        a new array.  Default False.
+                    nthreads: For ascii files, the number of threads used to parse
+                        the rows.  The file must be a regular file, which is
+                        mapped and split at line boundaries, so each row must be
+                        on its own line.  Default 1.
 
             Class Methods:
                 Read(rows=, fields=):
                     Returns the data in a NumPy array.  Specific rows and fields 
                     of the file can be specified with the keywords.  Rows must be
-                    sorted and unique.  Can be in any order.
+                    sorted and unique.  Fields can be in any order.
                 Write(numpy_array):
                     Write the input numpy array to the file.  The array must have
                     field names defined.
@@ -146,7 +156,8 @@ class Records(_object):
 
         Inputs:
             rows:  A sorted unique set of rows.  May be a scala/rlist/array.
-              Default is all rows.
+              Default is all rows.  Unsorted or repeated rows
+              are an error for every file type.
             fields: The fields to read.  May be a single string or a list
               of strings.  Can be in any order.  Default is all fields.
         Examples:
@@ -178,7 +189,8 @@ class Records(_object):
 
         Inputs:
             rows:  A sorted unique set of rows.  May be a scala/rlist/array.
-              Default is all rows.
+              Default is all rows.  Unsorted or repeated rows
+              are an error for every file type.
             fields: The fields to read.  May be a single string or a list
               of strings.  Can be in any order.  Default is all fields.
         Examples:
@@ -3080,6 +3080,8 @@ SWIGINTERN PyObject *_wrap_new_Records(PyObject *SWIGUNUSEDPARM(self), PyObject
   PyObject *arg4 = (PyObject *) NULL ;
   long long arg5 = (long long) -9999 ;
   int arg6 = (int) 0 ;
+  int arg7 = (int) 0 ;
+  int arg8 = (int) 1 ;
   int res2 ;
   char *buf2 = 0 ;
   int alloc2 = 0 ;
@@ -3087,18 +3089,24 @@ SWIGINTERN PyObject *_wrap_new_Records(PyObject *SWIGUNUSEDPARM(self), PyObject
   int ecode5 = 0 ;
   int val6 ;
   int ecode6 = 0 ;
+  int val7 ;
+  int ecode7 = 0 ;
+  int val8 ;
+  int ecode8 = 0 ;
   PyObject * obj0 = 0 ;
   PyObject * obj1 = 0 ;
   PyObject * obj2 = 0 ;
   PyObject * obj3 = 0 ;
   PyObject * obj4 = 0 ;
   PyObject * obj5 = 0 ;
+  PyObject * obj6 = 0 ;
+  PyObject * obj7 = 0 ;
   char *  kwnames[] = {
-    (char *) "fileobj",(char *) "mode",(char *) "delim",(char *) "dtype",(char *) "nrows",(char *) "bracket_arrays", NULL 
+    (char *) "fileobj",(char *) "mode",(char *) "delim",(char *) "dtype",(char *) "nrows",(char *) "bracket_arrays",(char *) "use_mmap",(char *) "nthreads", NULL 
   };
   Records *result = 0 ;
   
-  if (!PyArg_ParseTupleAndKeywords(args,kwargs,(char *)"OO|OOOO:new_Records",kwnames,&obj0,&obj1,&obj2,&obj3,&obj4,&obj5)) SWIG_fail;
+  if (!PyArg_ParseTupleAndKeywords(args,kwargs,(char *)"OO|OOOOOO:new_Records",kwnames,&obj0,&obj1,&obj2,&obj3,&obj4,&obj5,&obj6,&obj7)) SWIG_fail;
   arg1 = obj0;
   res2 = SWIG_AsCharPtrAndSize(obj1, &buf2, NULL, &alloc2);
   if (!SWIG_IsOK(res2)) {
@@ -3125,8 +3133,22 @@ SWIGINTERN PyObject *_wrap_new_Records(PyObject *SWIGUNUSEDPARM(self), PyObject
     } 
     arg6 = static_cast< int >(val6);
   }
+  if (obj6) {
+    ecode7 = SWIG_AsVal_int(obj6, &val7);
+    if (!SWIG_IsOK(ecode7)) {
+      SWIG_exception_fail(SWIG_ArgError(ecode7), "in method '" "new_Records" "', argument " "7"" of type '" "int""'");
+    } 
+    arg7 = static_cast< int >(val7);
+  }
+  if (obj7) {
+    ecode8 = SWIG_AsVal_int(obj7, &val8);
+    if (!SWIG_IsOK(ecode8)) {
+      SWIG_exception_fail(SWIG_ArgError(ecode8), "in method '" "new_Records" "', argument " "8"" of type '" "int""'");
+    } 
+    arg8 = static_cast< int >(val8);
+  }
   try {
-    result = (Records *)new Records(arg1,(char const *)arg2,arg3,arg4,arg5,arg6);
+    result = (Records *)new Records(arg1,(char const *)arg2,arg3,arg4,arg5,arg6,arg7,arg8);
   }
   catch(char const *_e) {
     PyErr_SetString(PyExc_RuntimeError, _e);
@@ -3385,12 +3407,22 @@ static PyMethodDef SwigMethods[] = {
 		"                numpy.dtype([('field1', 'i4'),('field2', 'f8')])\n"
 		"                some_numpy_array.dtype\n"
 		"            nrows: The number of rows in the file.  REQUIRED FOR READING.\n"
+		"            bracket_arrays: Write array fields in ascii files as {a,b,c}\n"
+		"            use_mmap: For binary files, map the file into memory rather than\n"
+		"                reading through stdio.  Full reads and slices with step\n"
+		"                are returned as read-only views of the mapping, while\n"
+		"                row and field subsets are gathered from the mapping into\n"
+		"                a new array.  Default False.\n"
+		"            nthreads: For ascii files, the number of threads used to parse\n"
+		"                the rows.  The file must be a regular file, which is\n"
+		"                mapped and split at line boundaries, so each row must be\n"
+		"                on its own line.  Default 1.\n"
 		"\n"
 		"    Class Methods:\n"
 		"        Read(rows=, fields=):\n"
 		"            Returns the data in a NumPy array.  Specific rows and fields \n"
 		"            of the file can be specified with the keywords.  Rows must be\n"
-		"            sorted and unique.  Can be in any order.\n"
+		"            sorted and unique.  Fields can be in any order.\n"
 		"        Write(numpy_array):\n"
 		"            Write the input numpy array to the file.  The array must have\n"
 		"            field names defined.\n"
@@ -3444,12 +3476,22 @@ static PyMethodDef SwigMethods[] = {
 		"                numpy.dtype([('field1', 'i4'),('field2', 'f8')])\n"
 		"                some_numpy_array.dtype\n"
 		"            nrows: The number of rows in the file.  REQUIRED FOR READING.\n"
+		"            bracket_arrays: Write array fields in ascii files as {a,b,c}\n"
+		"            use_mmap: For binary files, map the file into memory rather than\n"
+		"                reading through stdio.  Full reads and slices with step\n"
+		"                are returned as read-only views of the mapping, while\n"
+		"                row and field subsets are gathered from the mapping into\n"
+		"                a new array.  Default False.\n"
+		"            nthreads: For ascii files, the number of threads used to parse\n"
+		"                the rows.  The file must be a regular file, which is\n"
+		"                mapped and split at line boundaries, so each row must be\n"
+		"                on its own line.  Default 1.\n"
 		"\n"
 		"    Class Methods:\n"
 		"        Read(rows=, fields=):\n"
 		"            Returns the data in a NumPy array.  Specific rows and fields \n"
 		"            of the file can be specified with the keywords.  Rows must be\n"
-		"            sorted and unique.  Can be in any order.\n"
+		"            sorted and unique.  Fields can be in any order.\n"
 		"        Write(numpy_array):\n"
 		"            Write the input numpy array to the file.  The array must have\n"
 		"            field names defined.\n"
@@ -3489,7 +3531,8 @@ static PyMethodDef SwigMethods[] = {
 		"\n"
 		"Inputs:\n"
 		"    rows:  A sorted unique set of rows.  May be a scala/rlist/array.\n"
-		"      Default is all rows.\n"
+		"      Default is all rows.  Unsorted or repeated rows\n"
+		"      are an error for every file type.\n"
 		"    fields: The fields to read.  May be a single string or a list\n"
 		"      of strings.  Can be in any order.  Default is all fields.\n"
 		"Examples:\n"
@@ -3518,7 +3561,8 @@ static PyMethodDef SwigMethods[] = {
 		"\n"
 		"Inputs:\n"
 		"    rows:  A sorted unique set of rows.  May be a scala/rlist/array.\n"
-		"      Default is all rows.\n"
+		"      Default is all rows.  Unsorted or repeated rows\n"
+		"      are an error for every file type.\n"
 		"    fields: The fields to read.  May be a single string or a list\n"
 		"      of strings.  Can be in any order.  Default is all fields.\n"
 		"Examples:\n"
@@ -89,7 +89,8 @@ Class SFile
         data = sf.read(columns=column_list)
 
         # read a subset of rows.  Can use slices, single numbers for rows,
-        # or list/array of row numbers.
+        # or list/array of row numbers.  Lists are read in sorted order and
+        # must not repeat rows.
 
         data = sf[35]
         data = sf[35:100]
@@ -248,7 +249,8 @@ class SFile:
         data = sf.read(columns=column_list)
 
         # read a subset of rows.  Can use slices, single numbers for rows,
-        # or list/array of row numbers.
+        # or list/array of row numbers.  Lists are read in sorted order and
+        # must not repeat rows.
 
         data = sf[35]
         data = sf[35:100]
@@ -302,9 +304,11 @@ class SFile:
         0.54422426143267832
     """
     def __init__(self, fobj=None, mode='r', delim=None, 
-                 padnull=False, ignorenull=False, verbose=False):
+                 padnull=False, ignorenull=False, verbose=False,
+                 use_mmap=False, nthreads=1):
 
-        self.open(fobj, mode=mode, delim=delim, verbose=verbose)
+        self.open(fobj, mode=mode, delim=delim, verbose=verbose,
+                  use_mmap=use_mmap, nthreads=nthreads)
 
     def __enter__(self):
         return self
@@ -313,11 +317,15 @@ class SFile:
 
 
     def open(self, fobj, mode='r', delim=None, verbose=False,
-             padnull=False, ignorenull=False):
+             padnull=False, ignorenull=False, use_mmap=False, nthreads=1):
         """
         Open the file.  If the file already exists and the mode is 'r*' then
         a read of the header is attempted.  If this succeeds, delim is gotten
         from the header and the delim= keyword is ignored.
+
+        With use_mmap=True, structured binary data are read through a memory
+        map; see recfile.Open for details.  Ascii data are parsed with
+        nthreads threads.
         """
 
         if not have_numpy:
@@ -328,6 +336,8 @@ class SFile:
         self.verbose=verbose
         self.padnull=padnull
         self.ignorenull=ignorenull
+        self.use_mmap=use_mmap
+        self.nthreads=nthreads
         self.mode = mode
 
         self.fobj_input = fobj
@@ -410,6 +420,8 @@ class SFile:
 
         self.padnull=False
         self.ignorenull=False
+        self.use_mmap=False
+        self.nthreads=1
 
     def __repr__(self):
         s = []
@@ -517,7 +529,9 @@ class SFile:
     def get_subset(self, rows=None, fields=None, columns=None):
         robj = recfile.Open(self.fobj, nrows=self.size, mode='r', 
                             offset=self.fobj.tell(),
-                            dtype=self.dtype, delim=self.delim)
+                            dtype=self.dtype, delim=self.delim,
+                            use_mmap=self.use_mmap,
+                            nthreads=self.nthreads)
         return robj.get_subset(rows=rows, fields=fields, columns=columns)
 
     def get_memmap(self, view=None, header=False):
@@ -549,6 +563,10 @@ class SFile:
              view=None, split=False, reduce=False):
         """
         Read the data into memory.
+
+        rows: A scalar, sequence or array of rows to read.  The rows are
+            read in sorted order and must be unique.  Default all rows.
+        fields or columns: A subset of the fields to read, in any order.
         """
         
         if self.fobj.tell() != self.data_start:
@@ -601,7 +619,9 @@ class SFile:
 
         robj = recfile.Open(self.fobj, nrows=self.size, mode='r', 
                             offset=self.fobj.tell(),
-                            dtype=self.dtype, delim=self.delim)
+                            dtype=self.dtype, delim=self.delim,
+                            use_mmap=self.use_mmap,
+                            nthreads=self.nthreads)
         return robj[arg]
 
 
@@ -625,7 +645,8 @@ class SFile:
         rows2read = self._get_rows2read(rows)
         fields2read = self._get_fields2read(fields, columns=columns)
 
-        if fields2read is None and rows2read is None and self.delim is None:
+        if (fields2read is None and rows2read is None and self.delim is None
+                and not (self.use_mmap and have_recfile)):
             # Its binary and all, just use fromfile
             result = numpy.fromfile(self.fobj,dtype=self.dtype)
         else:
@@ -639,7 +660,9 @@ class SFile:
     def _recfile_read(self, rows=None, fields=None):
         robj = recfile.Open(self.fobj, nrows=self.size, mode='r', 
                             offset=self.fobj.tell(),
-                            dtype=self.dtype, delim=self.delim)
+                            dtype=self.dtype, delim=self.delim,
+                            use_mmap=self.use_mmap,
+                            nthreads=self.nthreads)
         return robj.Read(rows=rows, fields=fields)
 
     def _memmap_read(self,rows=None, fields=None):
@@ -1156,6 +1179,9 @@ def read(infile, **keys):
         header=False:  If True, return both the array and the header dict in
             a tuple.
         view=:  How to view the array.  Default is numpy.ndarray.
+        use_mmap=False: Read structured binary data through a memory map.
+            Full reads and slices return read-only views of the file.
+        nthreads=1: Threads used to parse ascii data.
 
     Examples:
         import sfile
@@ -1185,9 +1211,11 @@ def read(infile, **keys):
     header = keys.get('header',False)
     view = keys.get('view',None)
     memmap = keys.get('memmap',False)
+    use_mmap = keys.get('use_mmap',False)
+    nthreads = keys.get('nthreads',1)
     verbose = keys.get('verbose',False)
 
-    sf = SFile(infile, verbose=verbose)
+    sf = SFile(infile, verbose=verbose, use_mmap=use_mmap, nthreads=nthreads)
     if memmap:
         data = sf.get_memmap(view=view, header=header)
     else:
@@ -1,16 +1,154 @@
 #include <Python.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <math.h>
 #include <numpy/arrayobject.h> 
+#include "ParallelJobs.h"
 
+/*
+   Sequential random sampling of n of the N indices [0,N), in increasing
+   order, using Vitter's Algorithm D (ACM TOMS 13, 58, 1987).  The number of
+   indices to skip before each selection is drawn directly, so the time is
+   O(n) rather than O(N).  When n is a large fraction of the remaining N,
+   Algorithm A is used, which is O(N) but faster in that regime.
+*/
+
+// use algorithm A when n/N is larger than 1/SU_ALPHAINV
+#define SU_ALPHAINV 13
+
+static void
+vitter_a(struct esutil_rng* rng, npy_int64 n, npy_int64 N, npy_int64 current, npy_intp* out)
+{
+    double top = (double) (N - n), Nreal = (double) N, quot=0, V=0;
+    npy_int64 S=0;
+
+    while (n >= 2) {
+        V = esutil_rng_uniform(rng);
+        S = 0;
+        quot = top/Nreal;
+        while (quot > V) {
+            S += 1;
+            top -= 1.0;
+            Nreal -= 1.0;
+            quot = (quot*top)/Nreal;
+        }
+        current += S+1;
+        *out++ = current;
+        Nreal -= 1.0;
+        n -= 1;
+    }
+
+    // the last one is uniform in what is left
+    S = (npy_int64) floor(Nreal*esutil_rng_uniform(rng));
+    current += S+1;
+    *out = current;
+}
+
+static void
+vitter_d(struct esutil_rng* rng, npy_int64 n, npy_int64 N, npy_intp* out)
+{
+    npy_int64 current=-1, S=0, qu1=0, threshold=0, limit=0, t=0;
+    double nreal, Nreal, ninv, nmin1inv, Vprime, qu1real;
+    double X, U, negSreal, y1, y2, top, bottom;
+
+    if (n*SU_ALPHAINV > N) {
+        vitter_a(rng, n, N, current, out);
+        return;
+    }
+
+    nreal = (double) n;
+    Nreal = (double) N;
+    ninv = 1.0/nreal;
+    Vprime = exp(log(esutil_rng_uniform(rng))*ninv);
+    qu1 = N - n + 1;
+    qu1real = Nreal - nreal + 1.0;
+    threshold = SU_ALPHAINV*n;
+
+    while (n > 1 && threshold < N) {
+        nmin1inv = 1.0/(nreal - 1.0);
+
+        while (1) {
+            // step D2: generate U and X
+            while (1) {
+                X = Nreal*(1.0 - Vprime);
+                S = (npy_int64) X;
+                if (S < qu1) {
+                    break;
+                }
+                Vprime = exp(log(esutil_rng_uniform(rng))*ninv);
+            }
+            U = esutil_rng_uniform(rng);
+            negSreal = (double) (-S);
+
+            // step D3: accept the test on the squeeze
+            y1 = exp(log(U*Nreal/qu1real)*nmin1inv);
+            Vprime = y1*(1.0 - X/Nreal)*(qu1real/(negSreal + qu1real));
+            if (Vprime <= 1.0) {
+                break;
+            }
+
+            // step D4: the exact test
+            y2 = 1.0;
+            top = Nreal - 1.0;
+            if (n-1 > S) {
+                bottom = Nreal - nreal;
+                limit = N - S;
+            } else {
+                bottom = Nreal + negSreal - 1.0;
+                limit = qu1;
+            }
+            for (t=N-1; t >= limit; t--) {
+                y2 = (y2*top)/bottom;
+                top -= 1.0;
+                bottom -= 1.0;
+            }
+            if (Nreal/(Nreal - X) >= y1*exp(log(y2)*nmin1inv)) {
+                Vprime = exp(log(esutil_rng_uniform(rng))*nmin1inv);
+                break;
+            }
+            Vprime = exp(log(esutil_rng_uniform(rng))*ninv);
+        }
+
+        // skip S and select the next
+        current += S+1;
+        *out++ = current;
+
+        N = N - S - 1;
+        Nreal = negSreal + Nreal - 1.0;
+        n -= 1;
+        nreal -= 1.0;
+        ninv = nmin1inv;
+        qu1 -= S;
+        qu1real += negSreal;
+        threshold -= SU_ALPHAINV;
+    }
+
+    if (n > 1) {
+        vitter_a(rng, n, N, current, out);
+    } else {
+        S = (npy_int64) (Nreal*Vprime);
+        current += S+1;
+        *out = current;
+    }
+}
+
+/*
+   randind = random_sample(nmax, nrand, seed, stream=0)
+
+   nrand unique indices in [0,nmax), sorted.  Different streams with the
+   same seed give independent samples.
+*/
 static PyObject *
 PyStatUtil_random_sample(PyObject *self, PyObject *args) 
 {
     PyObject* randind_obj=NULL;
     npy_intp *randind=NULL;
-    long int nmax=0, nrand=0, seed=0;
+    long int nmax=0, nrand=0, seed=0, stream=0;
     npy_intp dims[1];
-    long int i=0, ntoselect=0, ntocheck=0;
-    double prob=0;
-    if (!PyArg_ParseTuple(args, (char*)"lll", &nmax, &nrand, &seed)) {
+    struct esutil_rng rng;
+
+    if (!PyArg_ParseTuple(args, (char*)"lll|l", &nmax, &nrand, &seed, &stream)) {
         return NULL;
     }
 
@@ -22,37 +160,1341 @@ PyStatUtil_random_sample(PyObject *self, PyObject *args)
         PyErr_Format(PyExc_ValueError,"nrand must be <= nmax, got %ld/%ld", nmax, nrand);
         return NULL;
     }
-
-
-    srand48(seed);
+    if (stream < 0) {
+        PyErr_Format(PyExc_ValueError,"stream must be >= 0, got %ld", stream);
+        return NULL;
+    }
 
     dims[0] = nrand;
     randind_obj = PyArray_SimpleNew(1, dims, NPY_INTP);
+    if (randind_obj == NULL) {
+        return NULL;
+    }
     randind = PyArray_DATA(randind_obj);
 
-    ntoselect=nrand;
-    ntocheck=nmax;
+    esutil_rng_init(&rng, (npy_uint64) seed, (npy_uint64) stream);
 
-    ntocheck=nmax;
-    for (i=0; i<nmax; i++) {
+    Py_BEGIN_ALLOW_THREADS
+    vitter_d(&rng, nrand, nmax, randind);
+    Py_END_ALLOW_THREADS
 
-        prob = ( (double) ntoselect ) / ((double) ntocheck );
-        if (drand48() < prob) {
-            randind[nrand-ntoselect] = i;
-            ntoselect -= 1;
+    return randind_obj;
+}
+
+
+/*
+   Sigma clipping
+
+   The clipping is done in place using a mask, one byte per element, set to
+   1 for elements used in the statistics.  Groups of elements are given by
+   offsets into the data, as in a CSR matrix, so many small arrays can be
+   clipped in one call.
+*/
+
+/*
+   Mean, error and standard deviation of the elements with mask set.  If
+   weights are sent these are the weighted values as from wmom with
+   calcerr=True, otherwise the error is sdev/sqrt(n).  Two passes are made
+   for accuracy.
+*/
+static void
+sigma_clip_stats(const double* x, const double* w, const npy_uint8* mask,
+                 npy_intp n, double* mean, double* err, double* sdev)
+{
+    npy_intp i=0, nuse=0;
+    double wsum=0, sum=0, m=0, var=0, var2=0, diff=0;
+
+    for (i=0; i<n; i++) {
+        if (mask[i]) {
+            if (w) {
+                wsum += w[i];
+                sum += w[i]*x[i];
+            } else {
+                sum += x[i];
+            }
+            nuse++;
         }
-        if (ntoselect == 0) {
+    }
+
+    if (nuse == 0) {
+        *mean = *err = *sdev = Py_NAN;
+        return;
+    }
+    if (!w) {
+        wsum = (double) nuse;
+    }
+    m = sum/wsum;
+
+    for (i=0; i<n; i++) {
+        if (mask[i]) {
+            diff = x[i]-m;
+            if (w) {
+                var += w[i]*diff*diff;
+                var2 += w[i]*w[i]*diff*diff;
+            } else {
+                var += diff*diff;
+            }
+        }
+    }
+
+    *mean = m;
+    *sdev = sqrt(var/wsum);
+    if (w) {
+        *err = sqrt(var2)/wsum;
+    } else {
+        *err = (*sdev)/sqrt(wsum);
+    }
+}
+
+/*
+   Clip a single group.  If everything was clipped on an iteration the
+   stats from the previous iteration are kept, and the iteration number is
+   returned.  Otherwise 0 is returned.
+*/
+static long
+sigma_clip_group(const double* x, const double* w, npy_uint8* mask,
+                 npy_intp n, double nsig, long niter,
+                 double* mean, double* err, double* sdev, npy_intp* nuse)
+{
+    npy_intp i=0, nold=n, nkeep=0;
+    long iter=0;
+    double clip=0;
+    long allclipped=0;
+
+    for (i=0; i<n; i++) {
+        mask[i]=1;
+    }
+    sigma_clip_stats(x, w, mask, n, mean, err, sdev);
+
+    for (iter=1; iter<=niter; iter++) {
+        clip = nsig*(*sdev);
+
+        nkeep=0;
+        for (i=0; i<n; i++) {
+            if (mask[i] && fabs(x[i]-(*mean)) < clip) {
+                nkeep++;
+            }
+        }
+
+        if (nkeep == 0) {
+            allclipped=iter;
             break;
         }
+        if (nkeep == nold) {
+            break;
+        }
+
+        for (i=0; i<n; i++) {
+            if (mask[i] && !(fabs(x[i]-(*mean)) < clip)) {
+                mask[i]=0;
+            }
+        }
+        nold=nkeep;
 
-        ntocheck -= 1;
+        sigma_clip_stats(x, w, mask, n, mean, err, sdev);
     }
-    return randind_obj;
+
+    *nuse=nold;
+    return allclipped;
+}
+
+// check the array is a contiguous 1-d array of the given type
+static int
+check_contig_array(PyObject* obj, int type_num, const char* name,
+                   const char* type_name)
+{
+    if (!PyArray_Check(obj)
+            || PyArray_TYPE(obj) != type_num
+            || PyArray_NDIM(obj) != 1
+            || !PyArray_ISCONTIGUOUS(obj)
+            || !PyArray_ISNOTSWAPPED(obj)) {
+        PyErr_Format(PyExc_ValueError,
+                     "%s must be a contiguous, native 1-d %s array",
+                     name, type_name);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+   res = sigma_clip(arr, weights, offsets, nsig, niter)
+
+   arr must be float64, weights float64 or None, offsets int64 or None.
+   If offsets is None the whole array is one group.  Returns the tuple
+
+       (mean, err, sdev, nuse, allclipped, mask)
+
+   with one element per group in all but mask, which has one element per
+   element of arr.  allclipped is the iteration on which everything was
+   clipped, or zero.  When everything is clipped the stats and mask are
+   from the previous iteration.
+*/
+static PyObject *
+PyStatUtil_sigma_clip(PyObject *self, PyObject *args) 
+{
+    PyObject *arr_obj=NULL, *weights_obj=NULL, *offsets_obj=NULL;
+    PyObject *mean_obj=NULL, *err_obj=NULL, *sdev_obj=NULL;
+    PyObject *nuse_obj=NULL, *allclipped_obj=NULL, *mask_obj=NULL;
+    const double *x=NULL, *w=NULL;
+    const npy_int64 *offsets=NULL;
+    npy_int64 single_offsets[2];
+    double *mean=NULL, *err=NULL, *sdev=NULL;
+    npy_intp *nuse=NULL;
+    long *allclipped=NULL;
+    npy_uint8 *mask=NULL;
+    double nsig=0;
+    long niter=0;
+    npy_intp n=0, ngroup=0, g=0;
+
+    if (!PyArg_ParseTuple(args, (char*)"OOOdl", 
+                          &arr_obj, &weights_obj, &offsets_obj, &nsig, &niter)) {
+        return NULL;
+    }
+
+    if (!check_contig_array(arr_obj, NPY_FLOAT64, "arr", "float64")) {
+        return NULL;
+    }
+    n = PyArray_SIZE(arr_obj);
+    x = PyArray_DATA(arr_obj);
+
+    if (weights_obj != Py_None) {
+        if (!check_contig_array(weights_obj, NPY_FLOAT64, "weights", "float64")) {
+            return NULL;
+        }
+        if (PyArray_SIZE(weights_obj) != n) {
+            PyErr_SetString(PyExc_ValueError,"array and weights must be same size");
+            return NULL;
+        }
+        w = PyArray_DATA(weights_obj);
+    }
+
+    if (offsets_obj != Py_None) {
+        if (!check_contig_array(offsets_obj, NPY_INT64, "offsets", "int64")) {
+            return NULL;
+        }
+        ngroup = PyArray_SIZE(offsets_obj)-1;
+        if (ngroup < 1) {
+            PyErr_SetString(PyExc_ValueError,"offsets must have at least two elements");
+            return NULL;
+        }
+        offsets = PyArray_DATA(offsets_obj);
+        for (g=0; g<ngroup; g++) {
+            if (offsets[g] < 0 || offsets[g+1] < offsets[g] || offsets[g+1] > n) {
+                PyErr_Format(PyExc_ValueError,
+                        "offsets must be non-decreasing and within [0,%ld]", (long) n);
+                return NULL;
+            }
+        }
+    } else {
+        ngroup=1;
+        single_offsets[0] = 0;
+        single_offsets[1] = n;
+        offsets = single_offsets;
+    }
+
+    mean_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    err_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    sdev_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    nuse_obj = PyArray_ZEROS(1, &ngroup, NPY_INTP, 0);
+    allclipped_obj = PyArray_ZEROS(1, &ngroup, NPY_LONG, 0);
+    mask_obj = PyArray_ZEROS(1, &n, NPY_UINT8, 0);
+    if (!mean_obj || !err_obj || !sdev_obj || !nuse_obj || !allclipped_obj || !mask_obj) {
+        Py_XDECREF(mean_obj);
+        Py_XDECREF(err_obj);
+        Py_XDECREF(sdev_obj);
+        Py_XDECREF(nuse_obj);
+        Py_XDECREF(allclipped_obj);
+        Py_XDECREF(mask_obj);
+        return NULL;
+    }
+    mean = PyArray_DATA(mean_obj);
+    err = PyArray_DATA(err_obj);
+    sdev = PyArray_DATA(sdev_obj);
+    nuse = PyArray_DATA(nuse_obj);
+    allclipped = PyArray_DATA(allclipped_obj);
+    mask = PyArray_DATA(mask_obj);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (g=0; g<ngroup; g++) {
+        npy_intp beg=offsets[g];
+        allclipped[g] = sigma_clip_group(x+beg, w ? w+beg : NULL, mask+beg,
+                                         offsets[g+1]-beg, nsig, niter,
+                                         &mean[g], &err[g], &sdev[g], &nuse[g]);
+    }
+    Py_END_ALLOW_THREADS
+
+    return Py_BuildValue("NNNNNN",
+                         mean_obj, err_obj, sdev_obj,
+                         nuse_obj, allclipped_obj, mask_obj);
+}
+
+
+/*
+   Weighted moments and medians for groups of data
+
+   Group g is the elements offsets[g] to offsets[g+1]-1 of the data, or if
+   an index array is sent, the data at those elements of the index.  With
+   the reverse indices rev from a histogram of nbin bins, the groups are the
+   bins if offsets=rev[0:nbin+1] and index=rev.
+*/
+
+/*
+   Check the offsets and optional index, and get pointers to them.  Returns
+   0 and sets the error on failure.
+*/
+static int
+get_groups(PyObject* offsets_obj, PyObject* index_obj, npy_intp n,
+           npy_intp* ngroup, const npy_int64** offsets, const npy_int64** index)
+{
+    npy_intp g=0, i=0, nind=n;
+
+    *index=NULL;
+    if (index_obj != Py_None) {
+        if (!check_contig_array(index_obj, NPY_INT64, "index", "int64")) {
+            return 0;
+        }
+        nind = PyArray_SIZE(index_obj);
+        *index = PyArray_DATA(index_obj);
+    }
+
+    if (!check_contig_array(offsets_obj, NPY_INT64, "offsets", "int64")) {
+        return 0;
+    }
+    *ngroup = PyArray_SIZE(offsets_obj)-1;
+    if (*ngroup < 1) {
+        PyErr_SetString(PyExc_ValueError,"offsets must have at least two elements");
+        return 0;
+    }
+    *offsets = PyArray_DATA(offsets_obj);
+
+    for (g=0; g < *ngroup; g++) {
+        const npy_int64* off = *offsets;
+        if (off[g] < 0 || off[g+1] < off[g] || off[g+1] > nind) {
+            PyErr_Format(PyExc_ValueError,
+                    "offsets must be non-decreasing and within [0,%ld]", (long) nind);
+            return 0;
+        }
+        if (*index) {
+            for (i=off[g]; i<off[g+1]; i++) {
+                if ((*index)[i] < 0 || (*index)[i] >= n) {
+                    PyErr_Format(PyExc_ValueError,
+                            "index out of range [0,%ld)", (long) n);
+                    return 0;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+// the position in the data of element i of a group
+#define GROUP_ELEM(index, i) ( (index) ? (index)[(i)] : (i) )
+
+/*
+   wmean,werr,werr2,wsdev = wmom(arr, weights, offsets, index)
+
+   Weighted mean and errors for each group in one pass, using the weighted
+   version of Welford's method.  werr is 1/sqrt(wsum) and werr2 is the
+   error from the weighted scatter, as from wmom with calcerr=True.  Empty
+   groups have NaN for all.
+*/
+static PyObject *
+PyStatUtil_wmom(PyObject *self, PyObject *args) 
+{
+    PyObject *arr_obj=NULL, *weights_obj=NULL, *offsets_obj=NULL, *index_obj=NULL;
+    PyObject *wmean_obj=NULL, *werr_obj=NULL, *werr2_obj=NULL, *wsdev_obj=NULL;
+    const double *x=NULL, *w=NULL;
+    const npy_int64 *offsets=NULL, *index=NULL;
+    double *wmean=NULL, *werr=NULL, *werr2=NULL, *wsdev=NULL;
+    npy_intp n=0, ngroup=0, g=0;
+
+    if (!PyArg_ParseTuple(args, (char*)"OOOO", 
+                          &arr_obj, &weights_obj, &offsets_obj, &index_obj)) {
+        return NULL;
+    }
+
+    if (!check_contig_array(arr_obj, NPY_FLOAT64, "arr", "float64")
+            || !check_contig_array(weights_obj, NPY_FLOAT64, "weights", "float64")) {
+        return NULL;
+    }
+    n = PyArray_SIZE(arr_obj);
+    if (PyArray_SIZE(weights_obj) != n) {
+        PyErr_SetString(PyExc_ValueError,"array and weights must be same size");
+        return NULL;
+    }
+    x = PyArray_DATA(arr_obj);
+    w = PyArray_DATA(weights_obj);
+
+    if (!get_groups(offsets_obj, index_obj, n, &ngroup, &offsets, &index)) {
+        return NULL;
+    }
+
+    wmean_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    werr_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    werr2_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    wsdev_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    if (!wmean_obj || !werr_obj || !werr2_obj || !wsdev_obj) {
+        Py_XDECREF(wmean_obj);
+        Py_XDECREF(werr_obj);
+        Py_XDECREF(werr2_obj);
+        Py_XDECREF(wsdev_obj);
+        return NULL;
+    }
+    wmean = PyArray_DATA(wmean_obj);
+    werr = PyArray_DATA(werr_obj);
+    werr2 = PyArray_DATA(werr2_obj);
+    wsdev = PyArray_DATA(wsdev_obj);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (g=0; g<ngroup; g++) {
+        npy_int64 i=0;
+        // running sums with weights w and w^2
+        double wsum=0, mean=0, m2=0;
+        double w2sum=0, mean2=0, m22=0;
+        double delta=0, dm=0;
+
+        for (i=offsets[g]; i<offsets[g+1]; i++) {
+            npy_int64 j = GROUP_ELEM(index, i);
+            double wj=w[j], xj=x[j], w2j=wj*wj;
+            if (wj == 0) {
+                continue;
+            }
+
+            if (wsum == 0) {
+                // set the first exactly, to avoid roundoff in m2
+                wsum = wj;
+                mean = xj;
+                w2sum = w2j;
+                mean2 = xj;
+                continue;
+            }
+
+            wsum += wj;
+            delta = xj - mean;
+            mean += delta*wj/wsum;
+            m2 += wj*delta*(xj - mean);
+
+            w2sum += w2j;
+            delta = xj - mean2;
+            mean2 += delta*w2j/w2sum;
+            m22 += w2j*delta*(xj - mean2);
+        }
+
+        if (offsets[g+1] == offsets[g] || wsum == 0) {
+            wmean[g] = werr[g] = werr2[g] = wsdev[g] = Py_NAN;
+            continue;
+        }
+
+        wmean[g] = mean;
+        werr[g] = 1.0/sqrt(wsum);
+        wsdev[g] = sqrt(m2/wsum);
+
+        // sum of w^2 (x-mean)^2, shifted from the w^2 weighted mean
+        dm = mean2 - mean;
+        werr2[g] = sqrt(m22 + w2sum*dm*dm)/wsum;
+    }
+    Py_END_ALLOW_THREADS
+
+    return Py_BuildValue("NNNN", wmean_obj, werr_obj, werr2_obj, wsdev_obj);
+}
+
+struct valweight {
+    double val;
+    double weight;
+};
+
+/*
+   The weighted median of the n values, defined as for wmedian: the
+   smallest value, in sorted order, such that the weight of the values
+   after it is <= half the total.  The values are reordered.  This uses
+   quickselect with a three-way partition, recursing into the part that
+   contains the median, so the expected time is O(n).
+*/
+static double
+weighted_select(struct valweight* vw, npy_intp n)
+{
+    npy_intp lo=0, hi=n, i=0, lt=0, gt=0;
+    double wtot=0, half=0, above=0, pivot=0, wgreater=0, wequal=0;
+    struct valweight tmp;
+
+    for (i=0; i<n; i++) {
+        wtot += vw[i].weight;
+    }
+    half = 0.5*wtot;
+
+    while (1) {
+        // median of three pivot
+        double a=vw[lo].val, b=vw[lo+(hi-lo)/2].val, c=vw[hi-1].val;
+        if ((a <= b && b <= c) || (c <= b && b <= a)) {
+            pivot=b;
+        } else if ((b <= a && a <= c) || (c <= a && a <= b)) {
+            pivot=a;
+        } else {
+            pivot=c;
+        }
+
+        // [lo,lt) < pivot, [lt,gt) == pivot, [gt,hi) > pivot
+        lt=lo; gt=hi; i=lo;
+        while (i < gt) {
+            if (vw[i].val < pivot) {
+                tmp=vw[i]; vw[i]=vw[lt]; vw[lt]=tmp;
+                lt++; i++;
+            } else if (vw[i].val > pivot) {
+                gt--;
+                tmp=vw[i]; vw[i]=vw[gt]; vw[gt]=tmp;
+            } else {
+                i++;
+            }
+        }
+
+        wgreater=above;
+        for (i=gt; i<hi; i++) {
+            wgreater += vw[i].weight;
+        }
+
+        if (wgreater > half) {
+            // the median is above the pivot
+            lo=gt;
+            continue;
+        }
+
+        wequal=0;
+        for (i=lt; i<gt; i++) {
+            wequal += vw[i].weight;
+        }
+        if (lt == lo || wgreater + wequal > half) {
+            return pivot;
+        }
+
+        // the median is below the pivot
+        above = wgreater + wequal;
+        hi=lt;
+    }
+}
+
+/*
+   wmed = wmedian(arr, weights, offsets, index)
+
+   Weighted median of each group, NaN for empty groups.
+*/
+static PyObject *
+PyStatUtil_wmedian(PyObject *self, PyObject *args) 
+{
+    PyObject *arr_obj=NULL, *weights_obj=NULL, *offsets_obj=NULL, *index_obj=NULL;
+    PyObject *wmed_obj=NULL;
+    const double *x=NULL, *w=NULL;
+    const npy_int64 *offsets=NULL, *index=NULL;
+    double *wmed=NULL;
+    struct valweight* vw=NULL;
+    npy_intp n=0, ngroup=0, g=0, maxsize=1;
+
+    if (!PyArg_ParseTuple(args, (char*)"OOOO", 
+                          &arr_obj, &weights_obj, &offsets_obj, &index_obj)) {
+        return NULL;
+    }
+
+    if (!check_contig_array(arr_obj, NPY_FLOAT64, "arr", "float64")
+            || !check_contig_array(weights_obj, NPY_FLOAT64, "weights", "float64")) {
+        return NULL;
+    }
+    n = PyArray_SIZE(arr_obj);
+    if (PyArray_SIZE(weights_obj) != n) {
+        PyErr_SetString(PyExc_ValueError,"array and weights must be same size");
+        return NULL;
+    }
+    x = PyArray_DATA(arr_obj);
+    w = PyArray_DATA(weights_obj);
+
+    if (!get_groups(offsets_obj, index_obj, n, &ngroup, &offsets, &index)) {
+        return NULL;
+    }
+
+    for (g=0; g<ngroup; g++) {
+        if (offsets[g+1]-offsets[g] > maxsize) {
+            maxsize = offsets[g+1]-offsets[g];
+        }
+    }
+    vw = malloc(maxsize*sizeof(struct valweight));
+    if (vw == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    wmed_obj = PyArray_ZEROS(1, &ngroup, NPY_FLOAT64, 0);
+    if (wmed_obj == NULL) {
+        free(vw);
+        return NULL;
+    }
+    wmed = PyArray_DATA(wmed_obj);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (g=0; g<ngroup; g++) {
+        npy_intp i=0, ng=offsets[g+1]-offsets[g];
+        if (ng == 0) {
+            wmed[g] = Py_NAN;
+            continue;
+        }
+        for (i=0; i<ng; i++) {
+            npy_int64 j = GROUP_ELEM(index, offsets[g]+i);
+            vw[i].val = x[j];
+            vw[i].weight = w[j];
+        }
+        wmed[g] = weighted_select(vw, ng);
+    }
+    Py_END_ALLOW_THREADS
+
+    free(vw);
+    return wmed_obj;
+}
+
+
+/*
+   Sampling from tabulated distributions
+
+   Random number i of a call is drawn from the counter based generator at
+   a position set by i, so the samples do not depend on the number of
+   threads.  The tables used for the sampling are made once by guide_table
+   and alias_table and passed in with each call.
+*/
+
+// random numbers used per sample
+#define SU_RANDS_PER_SAMPLE 2
+
+enum su_sample_type {
+    SU_SAMPLE_INVCDF,
+    SU_SAMPLE_PWLINEAR
+};
+
+struct su_sample_job {
+    enum su_sample_type type;
+
+    // the table, x and either the cumulative or differential probability
+    const double* x;
+    const double* p;
+    npy_intp n;
+
+    // guide table for the inverse cdf
+    const npy_int64* guide;
+    npy_intp nguide;
+
+    // alias table for the segments of the piecewise linear distribution
+    const double* prob;
+    const npy_int64* alias;
+
+    npy_uint64 seed;
+    npy_uint64 stream;
+
+    npy_intp start;
+    npy_intp end;
+    double* out;
+};
+
+/*
+   Inverse of the cumulative distribution p at u, linearly interpolated as
+   in interplin(x, p, u).  The guide table gives the last interval that
+   starts below the bucket of u, and the interval is found by a short walk
+   from there.
+*/
+static double
+invcdf_sample(const struct su_sample_job* job, double u)
+{
+    const double *x=job->x, *p=job->p;
+    npy_intp n=job->n, i=0, k=0;
+
+    k = (npy_intp) (u*job->nguide);
+    if (k >= job->nguide) {
+        k = job->nguide-1;
+    }
+    i = job->guide[k];
+    while (i < n-2 && p[i+1] < u) {
+        i++;
+    }
+    return (u - p[i])*(x[i+1] - x[i])/(p[i+1] - p[i]) + x[i];
+}
+
+/*
+   Sample from the density that is the linear interpolation of p(x).  The
+   segment is chosen from the alias table with the first random number, and
+   the position within the segment by inverting the quadratic cumulative
+   distribution of the segment with the second.
+*/
+static double
+pwlinear_sample(const struct su_sample_job* job, double u1, double u2)
+{
+    const double *x=job->x, *p=job->p;
+    npy_intp nseg=job->n-1, j=0;
+    double f=0, a=0, b=0, t=0;
+
+    f = u1*nseg;
+    j = (npy_intp) f;
+    if (j >= nseg) {
+        j = nseg-1;
+    }
+    f -= j;
+    if (f >= job->prob[j]) {
+        j = job->alias[j];
+    }
+
+    a = p[j];
+    b = p[j+1];
+    if (a+b == 0) {
+        // zero area, never chosen by an exact alias table
+        return x[j];
+    }
+    // the root of ((b-a)/2) t^2 + a t = u2 (a+b)/2 in [0,1], in a form that
+    // is stable for a near b
+    t = u2*(a+b)/( a + sqrt(a*a + (b*b - a*a)*u2) );
+    return x[j] + t*(x[j+1] - x[j]);
+}
+
+static void*
+sample_worker(void* arg)
+{
+    struct su_sample_job* job = (struct su_sample_job*) arg;
+    struct esutil_rng rng;
+    npy_uint64 start_counter=0;
+    npy_intp i=0;
+    double u1=0, u2=0;
+
+    esutil_rng_init(&rng, job->seed, job->stream);
+    start_counter = rng.counter;
+
+    for (i=job->start; i<job->end; i++) {
+        rng.counter = start_counter + SU_RANDS_PER_SAMPLE*((npy_uint64) i);
+        u1 = esutil_rng_uniform(&rng);
+        if (job->type == SU_SAMPLE_INVCDF) {
+            job->out[i] = invcdf_sample(job, u1);
+        } else {
+            u2 = esutil_rng_uniform(&rng);
+            job->out[i] = pwlinear_sample(job, u1, u2);
+        }
+    }
+    return NULL;
+}
+
+/*
+   Split the samples over nthreads threads, including the calling thread.
+*/
+static PyObject*
+run_sampler(struct su_sample_job* proto, npy_intp nrand, long nthreads)
+{
+    PyObject* out_obj=NULL;
+    npy_intp dims[1], chunksize=0;
+    struct su_sample_job* jobs=NULL;
+    long t=0;
+
+    if (nrand < 0) {
+        PyErr_Format(PyExc_ValueError,"nrand must be >= 0, got %ld", (long) nrand);
+        return NULL;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > nrand) {
+        nthreads = nrand > 0 ? nrand : 1;
+    }
+
+    dims[0] = nrand;
+    out_obj = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+    if (out_obj == NULL) {
+        return NULL;
+    }
+
+    jobs = calloc(nthreads, sizeof(struct su_sample_job));
+    if (jobs == NULL) {
+        Py_DECREF(out_obj);
+        return PyErr_NoMemory();
+    }
+
+    chunksize = nrand/nthreads;
+    for (t=0; t<nthreads; t++) {
+        jobs[t] = *proto;
+        jobs[t].start = t*chunksize;
+        jobs[t].end = (t == nthreads-1) ? nrand : (t+1)*chunksize;
+        jobs[t].out = PyArray_DATA(out_obj);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    esutil_run_jobs(jobs, sizeof(struct su_sample_job), nthreads, sample_worker);
+    Py_END_ALLOW_THREADS
+
+    free(jobs);
+    return out_obj;
+}
+
+/*
+   Check the table x,p.  If cumulative, p must be non-decreasing, otherwise
+   x must be increasing and p non-negative.
+*/
+static int
+check_table(PyObject* x_obj, PyObject* p_obj, int cumulative, npy_intp* n)
+{
+    const double *x=NULL, *p=NULL;
+    npy_intp i=0;
+
+    if (!check_contig_array(x_obj, NPY_FLOAT64, "x", "float64")
+            || !check_contig_array(p_obj, NPY_FLOAT64, "p", "float64")) {
+        return 0;
+    }
+    *n = PyArray_SIZE(x_obj);
+    if (*n < 2 || PyArray_SIZE(p_obj) != *n) {
+        PyErr_SetString(PyExc_ValueError,"x and p must be the same size, at least 2");
+        return 0;
+    }
+
+    x = PyArray_DATA(x_obj);
+    p = PyArray_DATA(p_obj);
+    for (i=0; i<*n; i++) {
+        if (!cumulative && i > 0 && !(x[i] > x[i-1])) {
+            PyErr_SetString(PyExc_ValueError,"x must be increasing");
+            return 0;
+        }
+        if (cumulative && i > 0 && !(p[i] >= p[i-1])) {
+            PyErr_SetString(PyExc_ValueError,"cumulative p must be non-decreasing");
+            return 0;
+        }
+        if (!cumulative && !(p[i] >= 0)) {
+            PyErr_SetString(PyExc_ValueError,"p must be non-negative");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+   guide = guide_table(pcum, nguide)
+
+   guide[k] is the last interval of pcum that starts below k/nguide, limited
+   to the range [0,n-2] as in interplin.
+*/
+static PyObject *
+PyStatUtil_guide_table(PyObject *self, PyObject *args)
+{
+    PyObject *pcum_obj=NULL, *guide_obj=NULL;
+    const double* pcum=NULL;
+    npy_int64* guide=NULL;
+    npy_intp n=0, i=0, k=0, dims[1];
+    long nguide=0;
+
+    if (!PyArg_ParseTuple(args, (char*)"Ol", &pcum_obj, &nguide)) {
+        return NULL;
+    }
+    if (!check_contig_array(pcum_obj, NPY_FLOAT64, "pcum", "float64")) {
+        return NULL;
+    }
+    n = PyArray_SIZE(pcum_obj);
+    if (n < 2 || nguide < 1) {
+        PyErr_SetString(PyExc_ValueError,"pcum must have at least 2 elements, and nguide > 0");
+        return NULL;
+    }
+
+    dims[0] = nguide;
+    guide_obj = PyArray_SimpleNew(1, dims, NPY_INT64);
+    if (guide_obj == NULL) {
+        return NULL;
+    }
+    guide = PyArray_DATA(guide_obj);
+    pcum = PyArray_DATA(pcum_obj);
+
+    i=0;
+    for (k=0; k<nguide; k++) {
+        double u = ((double) k)/nguide;
+        while (i < n-2 && pcum[i+1] < u) {
+            i++;
+        }
+        guide[k] = i;
+    }
+    return guide_obj;
+}
+
+/*
+   prob, alias = alias_table(weights)
+
+   Walker's alias table, built with Vose's O(n) method.  Bin j is chosen
+   with probability prob[j]/n, and otherwise bin alias[j].  Bins with zero
+   weight are never chosen, even with roundoff in the construction.
+*/
+static PyObject *
+PyStatUtil_alias_table(PyObject *self, PyObject *args)
+{
+    PyObject *weights_obj=NULL, *prob_obj=NULL, *alias_obj=NULL;
+    const double* w=NULL;
+    double* prob=NULL;
+    npy_int64 *alias=NULL, *small=NULL, *large=NULL;
+    npy_intp n=0, i=0, nsmall=0, nlarge=0, dims[1];
+    npy_int64 ipos=0;
+    double wsum=0;
+
+    if (!PyArg_ParseTuple(args, (char*)"O", &weights_obj)) {
+        return NULL;
+    }
+    if (!check_contig_array(weights_obj, NPY_FLOAT64, "weights", "float64")) {
+        return NULL;
+    }
+    n = PyArray_SIZE(weights_obj);
+    w = PyArray_DATA(weights_obj);
+    for (i=0; i<n; i++) {
+        if (!(w[i] >= 0)) {
+            PyErr_SetString(PyExc_ValueError,"weights must be non-negative");
+            return NULL;
+        }
+        if (w[i] > 0) {
+            ipos = i;
+        }
+        wsum += w[i];
+    }
+    if (n < 1 || !(wsum > 0)) {
+        PyErr_SetString(PyExc_ValueError,"weights must have a positive sum");
+        return NULL;
+    }
+
+    dims[0] = n;
+    prob_obj = PyArray_SimpleNew(1, dims, NPY_FLOAT64);
+    alias_obj = PyArray_SimpleNew(1, dims, NPY_INT64);
+    small = malloc(n*sizeof(npy_int64));
+    large = malloc(n*sizeof(npy_int64));
+    if (prob_obj == NULL || alias_obj == NULL || small == NULL || large == NULL) {
+        Py_XDECREF(prob_obj);
+        Py_XDECREF(alias_obj);
+        free(small);
+        free(large);
+        return PyErr_NoMemory();
+    }
+    prob = PyArray_DATA(prob_obj);
+    alias = PyArray_DATA(alias_obj);
+
+    for (i=0; i<n; i++) {
+        prob[i] = w[i]*n/wsum;
+        alias[i] = i;
+        if (prob[i] < 1.0) {
+            small[nsmall++] = i;
+        } else {
+            large[nlarge++] = i;
+        }
+    }
+    while (nsmall > 0 && nlarge > 0) {
+        npy_int64 s = small[--nsmall];
+        npy_int64 l = large[nlarge-1];
+
+        alias[s] = l;
+        prob[l] -= 1.0 - prob[s];
+        if (prob[l] < 1.0) {
+            nlarge--;
+            small[nsmall++] = l;
+        }
+    }
+    // what remains is 1 up to roundoff, except for bins with zero weight
+    while (nlarge > 0) {
+        prob[large[--nlarge]] = 1.0;
+    }
+    while (nsmall > 0) {
+        npy_int64 s = small[--nsmall];
+        if (w[s] > 0) {
+            prob[s] = 1.0;
+        } else {
+            prob[s] = 0.0;
+            alias[s] = ipos;
+        }
+    }
+
+    free(small);
+    free(large);
+    return Py_BuildValue("NN", prob_obj, alias_obj);
+}
+
+/*
+   rand = sample_invcdf(x, pcum, guide, nrand, seed, stream, nthreads)
+
+   Samples of x(pcum) at uniform random pcum, as interplin(x, pcum, u).
+*/
+static PyObject *
+PyStatUtil_sample_invcdf(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj=NULL, *pcum_obj=NULL, *guide_obj=NULL;
+    struct su_sample_job job;
+    long nrand=0, seed=0, stream=0, nthreads=1;
+    npy_intp i=0, n=0;
+
+    if (!PyArg_ParseTuple(args, (char*)"OOOllll", &x_obj, &pcum_obj, &guide_obj,
+                          &nrand, &seed, &stream, &nthreads)) {
+        return NULL;
+    }
+    if (!check_table(x_obj, pcum_obj, 1, &n)
+            || !check_contig_array(guide_obj, NPY_INT64, "guide", "int64")) {
+        return NULL;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.type = SU_SAMPLE_INVCDF;
+    job.x = PyArray_DATA(x_obj);
+    job.p = PyArray_DATA(pcum_obj);
+    job.n = n;
+    job.guide = PyArray_DATA(guide_obj);
+    job.nguide = PyArray_SIZE(guide_obj);
+    job.seed = (npy_uint64) seed;
+    job.stream = (npy_uint64) stream;
+
+    if (job.nguide < 1) {
+        PyErr_SetString(PyExc_ValueError,"guide must not be empty");
+        return NULL;
+    }
+    for (i=0; i<job.nguide; i++) {
+        if (job.guide[i] < 0 || job.guide[i] > n-2) {
+            PyErr_SetString(PyExc_ValueError,"guide table out of range");
+            return NULL;
+        }
+    }
+
+    return run_sampler(&job, nrand, nthreads);
+}
+
+/*
+   rand = sample_pwlinear(x, p, prob, alias, nrand, seed, stream, nthreads)
+
+   Samples from the density given by the linear interpolation of p(x),
+   with the alias table from the areas of the segments.
+*/
+static PyObject *
+PyStatUtil_sample_pwlinear(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj=NULL, *p_obj=NULL, *prob_obj=NULL, *alias_obj=NULL;
+    struct su_sample_job job;
+    long nrand=0, seed=0, stream=0, nthreads=1;
+    npy_intp i=0, n=0;
+
+    if (!PyArg_ParseTuple(args, (char*)"OOOOllll", &x_obj, &p_obj, &prob_obj,
+                          &alias_obj, &nrand, &seed, &stream, &nthreads)) {
+        return NULL;
+    }
+    if (!check_table(x_obj, p_obj, 0, &n)
+            || !check_contig_array(prob_obj, NPY_FLOAT64, "prob", "float64")
+            || !check_contig_array(alias_obj, NPY_INT64, "alias", "int64")) {
+        return NULL;
+    }
+    if (PyArray_SIZE(prob_obj) != n-1 || PyArray_SIZE(alias_obj) != n-1) {
+        PyErr_SetString(PyExc_ValueError,"alias table must have one entry per segment");
+        return NULL;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.type = SU_SAMPLE_PWLINEAR;
+    job.x = PyArray_DATA(x_obj);
+    job.p = PyArray_DATA(p_obj);
+    job.n = n;
+    job.prob = PyArray_DATA(prob_obj);
+    job.alias = PyArray_DATA(alias_obj);
+    job.seed = (npy_uint64) seed;
+    job.stream = (npy_uint64) stream;
+
+    for (i=0; i<n-1; i++) {
+        if (job.alias[i] < 0 || job.alias[i] > n-2) {
+            PyErr_SetString(PyExc_ValueError,"alias table out of range");
+            return NULL;
+        }
+    }
+
+    return run_sampler(&job, nrand, nthreads);
+}
+
+
+/*
+   Multivariate normal samples
+
+   cholesky_batch factors a stack of covariance matrices once, and
+   mvn_sample writes correlated normal samples from them into an output
+   array.  Each matrix has its own generator key, made from the seed and
+   the matrix number, and sample j of a matrix always uses the same
+   positions in that stream, so the output does not depend on the number
+   of threads.
+*/
+
+// contiguous native array of any shape with at least mindim dimensions
+static int
+check_contig_nd(PyObject* obj, int type_num, int mindim, const char* name,
+                const char* type_name)
+{
+    if (!PyArray_Check(obj)
+            || PyArray_TYPE(obj) != type_num
+            || PyArray_NDIM(obj) < mindim
+            || !PyArray_ISCONTIGUOUS(obj)
+            || !PyArray_ISNOTSWAPPED(obj)) {
+        PyErr_Format(PyExc_ValueError,
+                     "%s must be a contiguous, native %s array with at "
+                     "least %d dimensions",
+                     name, type_name, mindim);
+        return 0;
+    }
+    return 1;
+}
+
+// the size of the square matrices in the last two dimensions of arr
+static int
+get_matrix_shape(PyObject* arr, const char* name, npy_intp* npar, npy_intp* nmat)
+{
+    int ndim = PyArray_NDIM(arr);
+    npy_intp* dims = PyArray_DIMS(arr);
+
+    *npar = dims[ndim-1];
+    if (dims[ndim-2] != *npar || *npar < 1) {
+        PyErr_Format(PyExc_ValueError,"%s must hold square matrices", name);
+        return 0;
+    }
+    *nmat = PyArray_SIZE(arr)/((*npar)*(*npar));
+    return 1;
+}
+
+/*
+   Replace the covariance in L by its lower triangular cholesky factor,
+   with L L^T = cov.  Only the lower triangle of cov is used.  Returns 0 if
+   the matrix is not positive definite.
+*/
+static int
+su_cholesky(double* L, npy_intp npar)
+{
+    npy_intp i=0, j=0, k=0;
+    double sum=0;
+
+    for (j=0; j<npar; j++) {
+        sum = L[j*npar+j];
+        for (k=0; k<j; k++) {
+            sum -= L[j*npar+k]*L[j*npar+k];
+        }
+        if (!(sum > 0)) {
+            return 0;
+        }
+        L[j*npar+j] = sqrt(sum);
+
+        for (i=j+1; i<npar; i++) {
+            sum = L[i*npar+j];
+            for (k=0; k<j; k++) {
+                sum -= L[i*npar+k]*L[j*npar+k];
+            }
+            L[i*npar+j] = sum/L[j*npar+j];
+        }
+        for (i=0; i<j; i++) {
+            L[i*npar+j] = 0;
+        }
+    }
+    return 1;
+}
+
+/*
+   L = cholesky_batch(cov)
+
+   cov is float64 with shape (..., npar, npar).  L has the same shape.
+*/
+static PyObject *
+PyStatUtil_cholesky_batch(PyObject *self, PyObject *args)
+{
+    PyObject *cov_obj=NULL, *L_obj=NULL;
+    npy_intp npar=0, nmat=0, m=0;
+    double* L=NULL;
+
+    if (!PyArg_ParseTuple(args, (char*)"O", &cov_obj)) {
+        return NULL;
+    }
+    if (!check_contig_nd(cov_obj, NPY_FLOAT64, 2, "cov", "float64")
+            || !get_matrix_shape(cov_obj, "cov", &npar, &nmat)) {
+        return NULL;
+    }
+
+    L_obj = PyArray_SimpleNew(PyArray_NDIM(cov_obj), PyArray_DIMS(cov_obj),
+                              NPY_FLOAT64);
+    if (L_obj == NULL) {
+        return NULL;
+    }
+    L = PyArray_DATA(L_obj);
+    memcpy(L, PyArray_DATA(cov_obj), nmat*npar*npar*sizeof(double));
+
+    for (m=0; m<nmat; m++) {
+        if (!su_cholesky(L + m*npar*npar, npar)) {
+            PyErr_Format(PyExc_ValueError,
+                         "covariance matrix %ld is not positive definite",
+                         (long) m);
+            Py_DECREF(L_obj);
+            return NULL;
+        }
+    }
+    return L_obj;
+}
+
+struct su_mvn_job {
+    const double* L;
+    const double* mean; // can be NULL
+    npy_intp npar;
+    npy_intp nper;      // samples per matrix
+
+    npy_uint64 seed;
+    npy_uint64 stream;
+
+    // samples [start,end) counting over all matrices
+    npy_intp start;
+    npy_intp end;
+    double* out;
+
+    int nomem;
+};
+
+// the stream for matrix m
+static void
+su_mvn_rng(struct esutil_rng* rng, const struct su_mvn_job* job, npy_intp m)
+{
+    esutil_rng_init(rng, job->seed, job->stream);
+    rng->key = esutil_mix64(rng->key + esutil_mix64(((npy_uint64) m) + 1));
+}
+
+static void*
+mvn_worker(void* arg)
+{
+    struct su_mvn_job* job = (struct su_mvn_job*) arg;
+    npy_intp npar=job->npar, nper=job->nper;
+    npy_intp npair=(npar+1)/2;
+    npy_intp g=0, m=-1, j=0, i=0, k=0;
+    struct esutil_rng rng={0,0};
+    npy_uint64 start_counter=0;
+    const double *L=NULL, *mean=NULL;
+    double *z=NULL, *out=NULL;
+    double u1=0, u2=0, r=0, sum=0;
+
+    z = malloc(2*npair*sizeof(double));
+    if (z == NULL) {
+        job->nomem = 1;
+        return NULL;
+    }
+
+    for (g=job->start; g<job->end; g++) {
+        if (g/nper != m) {
+            m = g/nper;
+            su_mvn_rng(&rng, job, m);
+            start_counter = rng.counter;
+            L = job->L + m*npar*npar;
+            mean = job->mean ? job->mean + m*npar : NULL;
+        }
+        j = g - m*nper;
+
+        // standard normals from pairs of uniforms, Box-Muller
+        rng.counter = start_counter + 2*npair*((npy_uint64) j);
+        for (k=0; k<npair; k++) {
+            u1 = esutil_rng_uniform(&rng);
+            u2 = esutil_rng_uniform(&rng);
+            r = sqrt(-2.0*log(u1));
+            z[2*k] = r*cos(2*M_PI*u2);
+            z[2*k+1] = r*sin(2*M_PI*u2);
+        }
+
+        out = job->out + g*npar;
+        for (i=0; i<npar; i++) {
+            sum = mean ? mean[i] : 0.0;
+            for (k=0; k<=i; k++) {
+                sum += L[i*npar+k]*z[k];
+            }
+            out[i] = sum;
+        }
+    }
+
+    free(z);
+    return NULL;
+}
+
+/*
+   mvn_sample(L, mean, out, seed, stream, nthreads)
+
+   L is float64 with shape (nmat, npar, npar), or (npar, npar), holding
+   lower triangular factors from cholesky_batch.  mean is None or float64
+   with nmat*npar elements.  out is float64 with nmat*n*npar elements, for
+   example with shape (nmat, n, npar), and is filled in place with n
+   samples from each matrix.
+*/
+static PyObject *
+PyStatUtil_mvn_sample(PyObject *self, PyObject *args)
+{
+    PyObject *L_obj=NULL, *mean_obj=NULL, *out_obj=NULL;
+    long seed=0, stream=0, nthreads=1;
+    npy_intp npar=0, nmat=0, nper=0, ntot=0, chunksize=0;
+    struct su_mvn_job* jobs=NULL;
+    int nomem=0;
+    long t=0;
+
+    if (!PyArg_ParseTuple(args, (char*)"OOOlll", &L_obj, &mean_obj, &out_obj,
+                          &seed, &stream, &nthreads)) {
+        return NULL;
+    }
+    if (!check_contig_nd(L_obj, NPY_FLOAT64, 2, "L", "float64")
+            || !get_matrix_shape(L_obj, "L", &npar, &nmat)
+            || !check_contig_nd(out_obj, NPY_FLOAT64, 1, "out", "float64")) {
+        return NULL;
+    }
+    if (!PyArray_ISWRITEABLE(out_obj)) {
+        PyErr_SetString(PyExc_ValueError,"out must be writeable");
+        return NULL;
+    }
+    if (nmat == 0 || PyArray_SIZE(out_obj) % (nmat*npar) != 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "out must have n*npar elements for each matrix");
+        return NULL;
+    }
+    if (mean_obj != Py_None) {
+        if (!check_contig_nd(mean_obj, NPY_FLOAT64, 1, "mean", "float64")) {
+            return NULL;
+        }
+        if (PyArray_SIZE(mean_obj) != nmat*npar) {
+            PyErr_SetString(PyExc_ValueError,"mean must have npar elements for each matrix");
+            return NULL;
+        }
+    }
+
+    nper = PyArray_SIZE(out_obj)/(nmat*npar);
+    ntot = nper*nmat;
+    if (nthreads > ntot) {
+        nthreads = ntot;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    jobs = calloc(nthreads, sizeof(struct su_mvn_job));
+    if (jobs == NULL) {
+        return PyErr_NoMemory();
+    }
+    chunksize = ntot/nthreads;
+    for (t=0; t<nthreads; t++) {
+        jobs[t].L = PyArray_DATA(L_obj);
+        jobs[t].mean = (mean_obj != Py_None) ? PyArray_DATA(mean_obj) : NULL;
+        jobs[t].npar = npar;
+        jobs[t].nper = nper;
+        jobs[t].seed = (npy_uint64) seed;
+        jobs[t].stream = (npy_uint64) stream;
+        jobs[t].start = t*chunksize;
+        jobs[t].end = (t == nthreads-1) ? ntot : (t+1)*chunksize;
+        jobs[t].out = PyArray_DATA(out_obj);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    esutil_run_jobs(jobs, sizeof(struct su_mvn_job), nthreads, mvn_worker);
+    Py_END_ALLOW_THREADS
+
+    for (t=0; t<nthreads; t++) {
+        nomem |= jobs[t].nomem;
+    }
+    free(jobs);
+
+    if (nomem) {
+        return PyErr_NoMemory();
+    }
+    Py_RETURN_NONE;
 }
 
 
 static PyMethodDef stat_util_module_methods[] = {
-    {"random_sample", (PyCFunction)PyStatUtil_random_sample, METH_VARARGS,  "r=random_sample(nmax,nrand)"},
+    {"random_sample", (PyCFunction)PyStatUtil_random_sample, METH_VARARGS,  "r=random_sample(nmax,nrand,seed,stream=0)"},
+    {"sigma_clip", (PyCFunction)PyStatUtil_sigma_clip, METH_VARARGS,  "mean,err,sdev,nuse,allclipped,mask=sigma_clip(arr,weights,offsets,nsig,niter)"},
+    {"wmom", (PyCFunction)PyStatUtil_wmom, METH_VARARGS,  "wmean,werr,werr2,wsdev=wmom(arr,weights,offsets,index)"},
+    {"wmedian", (PyCFunction)PyStatUtil_wmedian, METH_VARARGS,  "wmed=wmedian(arr,weights,offsets,index)"},
+    {"guide_table", (PyCFunction)PyStatUtil_guide_table, METH_VARARGS,  "guide=guide_table(pcum,nguide)"},
+    {"alias_table", (PyCFunction)PyStatUtil_alias_table, METH_VARARGS,  "prob,alias=alias_table(weights)"},
+    {"sample_invcdf", (PyCFunction)PyStatUtil_sample_invcdf, METH_VARARGS,  "rand=sample_invcdf(x,pcum,guide,nrand,seed,stream,nthreads)"},
+    {"sample_pwlinear", (PyCFunction)PyStatUtil_sample_pwlinear, METH_VARARGS,  "rand=sample_pwlinear(x,p,prob,alias,nrand,seed,stream,nthreads)"},
+    {"cholesky_batch", (PyCFunction)PyStatUtil_cholesky_batch, METH_VARARGS,  "L=cholesky_batch(cov)"},
+    {"mvn_sample", (PyCFunction)PyStatUtil_mvn_sample, METH_VARARGS,  "mvn_sample(L,mean,out,seed,stream,nthreads)"},
     {NULL}  /* Sentinel */
 };
 
@@ -1,8 +1,177 @@
 #include "chist.h"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <pthread.h>
 #include "numpy/arrayobject.h"
 #include "NumpyVector.h"
+#include "ParallelJobs.h"
 
-PyObject* chist(
+/*
+   The histogram kernels are templated over the data type, and the type is
+   chosen at runtime from the numpy type number.  Arrays of a supported type
+   in native byte order are used in place without a copy.  Anything else is
+   converted to double.
+*/
+
+// the type number used for dispatch
+static int get_type_num(PyObject* obj) {
+    if (PyArray_Check(obj)) {
+        return PyArray_TYPE(obj);
+    }
+    return NPY_DOUBLE;
+}
+
+/*
+   Call func.call<T>() with T the supported type for the data.  Each entry
+   point wraps its arguments in a small struct with a templated call method,
+   so a new type only needs a case here.
+*/
+template <class Func>
+static PyObject* dispatch_type(PyObject* data_pyobj, const Func& func) throw (const char *) {
+    switch (get_type_num(data_pyobj)) {
+        case NPY_BYTE:
+            return func.template call<signed char>();
+        case NPY_UBYTE:
+            return func.template call<unsigned char>();
+        case NPY_SHORT:
+            return func.template call<short>();
+        case NPY_USHORT:
+            return func.template call<unsigned short>();
+        case NPY_INT:
+            return func.template call<int>();
+        case NPY_UINT:
+            return func.template call<unsigned int>();
+        case NPY_LONG:
+            return func.template call<long>();
+        case NPY_ULONG:
+            return func.template call<unsigned long>();
+        case NPY_LONGLONG:
+            return func.template call<long long>();
+        case NPY_ULONGLONG:
+            return func.template call<unsigned long long>();
+        case NPY_FLOAT:
+            return func.template call<float>();
+        default:
+            return func.template call<double>();
+    }
+}
+
+// wide integer type used for exact binning of integer type T
+template <class T> struct WideInt { typedef npy_int64 type; };
+template <> struct WideInt<unsigned long> { typedef npy_uint64 type; };
+template <> struct WideInt<unsigned long long> { typedef npy_uint64 type; };
+
+// get the value as a W if it is exactly representable
+template <class W>
+static bool get_exact(PyObject* obj, double dval, W& wval) throw (const char *) {
+    if (std::numeric_limits<W>::is_signed) {
+        if (!(dval > -9.2e18 && dval < 9.2e18)
+                || dval != (double)(npy_int64) dval) {
+            return false;
+        }
+    } else {
+        if (!(dval >= 0 && dval < 1.8e19)
+                || dval != (double)(npy_uint64) dval) {
+            return false;
+        }
+    }
+    NumpyVector<W> vec(obj);
+    wval = vec[0];
+    return ((double) wval == dval);
+}
+
+/*
+   Bin number calculation for data of type T.  Values outside of
+   [datamin,datamax] give -1, as do bins >= nbin.
+
+   For integer data with whole number datamin, datamax and binsize the
+   calculation uses exact integer arithmetic, so that large integers such as
+   HTM ids are binned correctly.  Otherwise double precision is used.
+*/
+template <class T>
+class BinCalc {
+    public:
+        typedef typename WideInt<T>::type W;
+
+        // datamax_pyobj may be NULL, meaning no upper limit
+        BinCalc(PyObject* datamin_pyobj,
+                PyObject* datamax_pyobj,
+                PyObject* binsize_pyobj,
+                npy_int64 nbin) throw (const char *) {
+
+            NumpyVector<double> datamin_array(datamin_pyobj);
+            NumpyVector<double> binsize_array(binsize_pyobj);
+
+            mNbin = nbin;
+            mDmin = datamin_array[0];
+            mBinsize = binsize_array[0];
+            if (datamax_pyobj != NULL) {
+                NumpyVector<double> datamax_array(datamax_pyobj);
+                mDmax = datamax_array[0];
+            } else {
+                mDmax = std::numeric_limits<double>::infinity();
+            }
+
+            mExact = false;
+            if (std::numeric_limits<T>::is_integer
+                    && get_exact(datamin_pyobj, mDmin, mLo)
+                    && get_exact(binsize_pyobj, mBinsize, mBs)
+                    && mBs > 0) {
+
+                if (datamax_pyobj == NULL) {
+                    mHi = std::numeric_limits<W>::max();
+                    mExact = true;
+                } else if (get_exact(datamax_pyobj, mDmax, mHi)) {
+                    mExact = true;
+                }
+            }
+        }
+
+        inline npy_int64 operator()(T val) const {
+            if (mExact) {
+                W wval = (W) val;
+                if (wval < mLo || wval > mHi) {
+                    return -1;
+                }
+                // wval >= mLo, so the difference fits unsigned even
+                // when it overflows W, e.g. a negative min with large ids
+                npy_uint64 binnum =
+                    ((npy_uint64) wval - (npy_uint64) mLo)/(npy_uint64) mBs;
+                if (binnum >= (npy_uint64) mNbin) {
+                    return -1;
+                }
+                return (npy_int64) binnum;
+            } else {
+                double dval = (double) val;
+                if (!(dval >= mDmin && dval <= mDmax)) {
+                    return -1;
+                }
+                npy_int64 binnum = (npy_int64) ( (dval-mDmin)/mBinsize);
+                if (binnum >= mNbin) {
+                    return -1;
+                }
+                return binnum;
+            }
+        }
+
+    private:
+        npy_int64 mNbin;
+        bool mExact;
+
+        double mDmin;
+        double mDmax;
+        double mBinsize;
+
+        W mLo;
+        W mHi;
+        W mBs;
+};
+
+
+template <class T>
+static PyObject* chist_sorted(
         PyObject* data_pyobj,
         PyObject* datamin_pyobj,
         PyObject* sort_pyobj,
@@ -10,43 +179,35 @@ PyObject* chist(
         PyObject* nbin_pyobj,
         bool dorev) throw (const char *) {
 
-    // For now, to keep things simple, just convert to double if it isn't
-    // already.  This will cost us a factor of two in memory, so some day
-    // might want to do something better.
+    // no copy is made if the data are already of type T
+    NumpyVector<T> data(data_pyobj);
 
-    NumpyVector<double> data(data_pyobj);
-
-    // this should end up as a 1-element array
-    NumpyVector<double> datamin_array(datamin_pyobj);
-
-    // sort vector converted to 64-bit integer
+    // sort vector as 64-bit integer; argsort returns this type on 64-bit
+    // systems so no copy is made
     NumpyVector<npy_int64> sort(sort_pyobj);
-    
-    NumpyVector<double> binsize_array(binsize_pyobj);
 
     NumpyVector<npy_int64> nbin_array(nbin_pyobj);
-
-    
-    // copy out scalars
-    double datamin = datamin_array[0];
-    double binsize = binsize_array[0];
     npy_int64 nbin = nbin_array[0];
 
+    BinCalc<T> calc(datamin_pyobj, NULL, binsize_pyobj, nbin);
+
     // Make the histogram
-    //std::cout<<"Creating histogram with nbin="<<nbin<<"\n";
     NumpyVector<npy_int64> hist(nbin);
+    npy_int64* hptr = hist.ptr();
 
     // Check if rev is sent, if so we'll fill it in
     NumpyVector<npy_int64> rev;
+    npy_int64* rptr = NULL;
     if (dorev) {
         npy_int64 revsize = sort.size() + nbin + 1;
-        //std::cout<<"Will do reverse indices, size: "<<revsize<<"\n";
         rev.init(revsize);
-    } else {
-        //std::cout<<"Not doing reverse indices\n";
+        rptr = rev.ptr();
     }
 
-
+    const char* dptr = (const char*) data.void_ptr();
+    npy_intp dstride = data.stride();
+    const char* sptr = (const char*) sort.void_ptr();
+    npy_intp sstride = sort.stride();
 
     // this is my reverse engineering of the IDL reverse
     // indices
@@ -55,40 +216,36 @@ PyObject* chist(
     for (npy_int64 i=0; i<sort.size(); i++) {
 
         npy_int64 offset = i+nbin+1;
-        npy_int64 data_index = sort[i];
-
+        npy_int64 data_index = *(const npy_int64*) (sptr + i*sstride);
 
         if (dorev) {
-            rev[offset] = data_index;
+            rptr[offset] = data_index;
         }
 
-        npy_int64 binnum = (npy_int64) ( (data[data_index]-datamin)/binsize);
+        npy_int64 binnum = calc( *(const T*) (dptr + data_index*dstride) );
 
-        if (binnum >= 0 && binnum < nbin) {
+        if (binnum >= 0) {
             // Should we upate the reverse indices?
             if (dorev && (binnum > binnum_old) ) {
                 npy_int64 tbin = binnum_old + 1;
                 while (tbin <= binnum) {
-                    rev[tbin] = offset;
+                    rptr[tbin] = offset;
                     tbin++;
                 }
             }
             // Update the histogram
-            hist[binnum] = hist[binnum] + 1;
+            hptr[binnum] += 1;
             binnum_old = binnum;
         }
     }
 
-    npy_int64 tbin = binnum_old + 1;
-    while (tbin <= nbin) {
-        if (dorev) {
-            rev[tbin] = rev.size();
+    if (dorev) {
+        npy_int64 tbin = binnum_old + 1;
+        while (tbin <= nbin) {
+            rptr[tbin] = rev.size();
+            tbin++;
         }
-        tbin++;
-    }
 
-
-    if (dorev) {
         PyObject* output_tuple = PyTuple_New(2);
 		PyTuple_SetItem(output_tuple, 0, hist.getref());
 		PyTuple_SetItem(output_tuple, 1, rev.getref());
@@ -99,4 +256,1501 @@ PyObject* chist(
     }
 }
 
+struct ChistSortedCall {
+    PyObject* data_pyobj;
+    PyObject* datamin_pyobj;
+    PyObject* sort_pyobj;
+    PyObject* binsize_pyobj;
+    PyObject* nbin_pyobj;
+    bool dorev;
+
+    template <class T>
+    PyObject* call() const {
+        return chist_sorted<T>(data_pyobj, datamin_pyobj, sort_pyobj,
+                               binsize_pyobj, nbin_pyobj, dorev);
+    }
+};
+
+PyObject* chist(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* sort_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* nbin_pyobj,
+        bool dorev) throw (const char *) {
+
+    ChistSortedCall func = {data_pyobj, datamin_pyobj, sort_pyobj,
+                            binsize_pyobj, nbin_pyobj, dorev};
+    return dispatch_type(data_pyobj, func);
+}
+
+
+/*
+   One contiguous chunk of the data.  In the first pass counts are
+   accumulated for the chunk.  In the second pass the indices are scattered
+   into rev at cursor, which holds the offset of the next free slot in each
+   bin for this chunk.
+*/
+template <class T>
+struct CountingJob {
+    const char* data;
+    npy_intp stride;
+    npy_intp start;
+    npy_intp end;
+
+    const BinCalc<T>* calc;
+
+    bool scatter;
+    std::vector<npy_int64> counts; // becomes the cursor for the scatter
+    npy_int64* rev;
+
+    static void* run(void* arg) {
+        CountingJob* job = (CountingJob*) arg;
+        const BinCalc<T>& calc = *job->calc;
+        const char* p = job->data + job->start*job->stride;
+
+        for (npy_intp i=job->start; i<job->end; i++) {
+            npy_int64 binnum = calc( *(const T*) p );
+            p += job->stride;
+
+            if (binnum < 0) {
+                continue;
+            }
+            if (job->scatter) {
+                job->rev[ job->counts[binnum]++ ] = i;
+            } else {
+                job->counts[binnum]++;
+            }
+        }
+        return NULL;
+    }
+};
+
+template <class T>
+static PyObject* chist_counting_typed(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* nbin_pyobj,
+        bool dorev,
+        long nthreads) throw (const char *) {
+
+    NumpyVector<T> data(data_pyobj);
+    NumpyVector<npy_int64> nbin_array(nbin_pyobj);
+    npy_int64 nbin = nbin_array[0];
+
+    if (nbin < 1) {
+        throw "nbin must be >= 1";
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    BinCalc<T> calc(datamin_pyobj, datamax_pyobj, binsize_pyobj, nbin);
+
+    npy_intp ndata = data.size();
+    if (nthreads > ndata) {
+        nthreads = ndata > 0 ? ndata : 1;
+    }
+
+    NumpyVector<npy_int64> hist(nbin);
+    npy_int64* hptr = hist.ptr();
+
+    std::vector< CountingJob<T> > jobs(nthreads);
+    npy_intp chunksize = ndata/nthreads;
+    for (long t=0; t<nthreads; t++) {
+        CountingJob<T>& job = jobs[t];
+        job.data = (const char*) data.void_ptr();
+        job.stride = data.stride();
+        job.start = t*chunksize;
+        job.end = (t == nthreads-1) ? ndata : (t+1)*chunksize;
+        job.calc = &calc;
+        job.scatter = false;
+        job.counts.assign(nbin, 0);
+        job.rev = NULL;
+    }
+
+    // first pass: counts
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    npy_int64 ntot=0;
+    for (npy_int64 b=0; b<nbin; b++) {
+        for (long t=0; t<nthreads; t++) {
+            hptr[b] += jobs[t].counts[b];
+        }
+        ntot += hptr[b];
+    }
+
+    if (!dorev) {
+        return hist.getref();
+    }
+
+    // The reverse indices: rev[b] is the offset of bin b, followed by the
+    // indices.  Chunks are in order of index, so each chunk starts writing
+    // in bin b after the earlier chunks
+    NumpyVector<npy_int64> rev(nbin + 1 + ntot);
+    npy_int64* rptr = rev.ptr();
+
+    rptr[0] = nbin+1;
+    for (npy_int64 b=0; b<nbin; b++) {
+        rptr[b+1] = rptr[b] + hptr[b];
+
+        npy_int64 offset = rptr[b];
+        for (long t=0; t<nthreads; t++) {
+            npy_int64 count = jobs[t].counts[b];
+            jobs[t].counts[b] = offset;
+            offset += count;
+        }
+    }
+
+    for (long t=0; t<nthreads; t++) {
+        jobs[t].scatter = true;
+        jobs[t].rev = rptr;
+    }
+
+    // second pass: scatter
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    PyObject* output_tuple = PyTuple_New(2);
+    PyTuple_SetItem(output_tuple, 0, hist.getref());
+    PyTuple_SetItem(output_tuple, 1, rev.getref());
+    return output_tuple;
+}
+
+struct ChistCountingCall {
+    PyObject* data_pyobj;
+    PyObject* datamin_pyobj;
+    PyObject* datamax_pyobj;
+    PyObject* binsize_pyobj;
+    PyObject* nbin_pyobj;
+    bool dorev;
+    long nthreads;
+
+    template <class T>
+    PyObject* call() const {
+        return chist_counting_typed<T>(data_pyobj, datamin_pyobj,
+                                       datamax_pyobj, binsize_pyobj,
+                                       nbin_pyobj, dorev, nthreads);
+    }
+};
+
+PyObject* chist_counting(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* nbin_pyobj,
+        bool dorev,
+        long nthreads) throw (const char *) {
+
+    ChistCountingCall func = {data_pyobj, datamin_pyobj, datamax_pyobj,
+                              binsize_pyobj, nbin_pyobj, dorev, nthreads};
+    return dispatch_type(data_pyobj, func);
+}
+
+
+/*
+   Per-bin statistics from the reverse indices
+*/
+
+/*
+   Running mean and sum of squared deviations using Welford's method,
+   extended to weighted data following West (1979).  Objects with zero
+   weight do not contribute.
+*/
+struct Welford {
+    double wsum;
+    double mean;
+    double m2;
+
+    Welford() : wsum(0), mean(0), m2(0) {}
+
+    inline void add(double val, double w) {
+        if (w == 0) {
+            return;
+        }
+        if (wsum == 0) {
+            // set the first exactly, to avoid roundoff in m2
+            wsum = w;
+            mean = val;
+            return;
+        }
+        wsum += w;
+        double delta = val - mean;
+        mean += delta*w/wsum;
+        m2 += w*delta*(val - mean);
+    }
+};
+
+// median of the first n elements, which are reordered in place.  For even n
+// this is the mean of the two central values, as in numpy.median
+static double median_inplace(double* vals, npy_intp n) {
+    double* mid = vals + n/2;
+    std::nth_element(vals, mid, vals+n);
+    double med = *mid;
+    if ( (n % 2) == 0 ) {
+        med = 0.5*(med + *std::max_element(vals, mid));
+    }
+    return med;
+}
+
+/*
+   Statistics for one variable: x or y.  Weighted statistics are calculated
+   if the weights are sent.  Output arrays are NULL if not wanted.
+*/
+struct BinStatsVar {
+    const char* data;
+    npy_intp stride;
+
+    double* mean;
+    double* std;
+    double* err;
+    double* median;
+
+    double* wmean;
+    double* wstd;
+    double* werr;
+    double* werr2;
+
+    void calc(npy_int64 bin,
+              const npy_int64* ind,
+              npy_intp n,
+              const char* wdata,
+              npy_intp wstride,
+              double* buf) const {
+
+        if (n == 1) {
+            // this matches the pure python calculation for a single object
+            double val = *(const double*) (data + ind[0]*stride);
+            mean[bin] = val;
+            median[bin] = val;
+            std[bin] = 0;
+            err[bin] = val;
+            if (wdata != NULL) {
+                wmean[bin] = val;
+                wstd[bin] = 0;
+                werr[bin] = val;
+                werr2[bin] = val;
+            }
+            return;
+        }
+
+        Welford acc, wacc, w2acc;
+        for (npy_intp i=0; i<n; i++) {
+            double val = *(const double*) (data + ind[i]*stride);
+            buf[i] = val;
+            acc.add(val, 1.0);
+            if (wdata != NULL) {
+                double w = *(const double*) (wdata + ind[i]*wstride);
+                wacc.add(val, w);
+                w2acc.add(val, w*w);
+            }
+        }
+
+        mean[bin] = acc.mean;
+        std[bin] = sqrt(acc.m2/n);
+        err[bin] = std[bin]/sqrt((double) n);
+        median[bin] = median_inplace(buf, n);
+
+        if (wdata != NULL) {
+            double wtot = wacc.wsum;
+            double wm = wacc.mean;
+            if (wtot == 0) {
+                wm = std::numeric_limits<double>::quiet_NaN();
+            }
+            wmean[bin] = wm;
+            wstd[bin] = sqrt(wacc.m2/wtot);
+            werr[bin] = 1.0/sqrt(wtot);
+
+            // sum of w^2 (val-wm)^2, shifted from the w^2 weighted mean
+            double dm = w2acc.mean - wm;
+            werr2[bin] = sqrt(w2acc.m2 + w2acc.wsum*dm*dm)/wtot;
+        }
+    }
+};
+
+// new array filled with the default value
+static double* new_stat_array(NumpyVector<double>& vec,
+                              npy_intp nbin,
+                              double defval) throw (const char *) {
+    vec.init(nbin);
+    double* p = vec.ptr();
+    std::fill(p, p+nbin, defval);
+    return p;
+}
+
+template <class T>
+static void set_stat_item(PyObject* dict,
+                          const char* name,
+                          NumpyVector<T>& vec) {
+    PyObject* arr = vec.getref();
+    PyDict_SetItemString(dict, name, arr);
+    Py_XDECREF(arr);
+}
+
+PyObject* chist_bin_stats(
+        PyObject* x_pyobj,
+        PyObject* y_pyobj,
+        PyObject* weights_pyobj,
+        PyObject* rev_pyobj) throw (const char *) {
+
+    const double defval = -9999.0;
+
+    NumpyVector<double> x(x_pyobj);
+    NumpyVector<npy_int64> rev(rev_pyobj);
+
+    bool doy = (y_pyobj != NULL && y_pyobj != Py_None);
+    bool dow = (weights_pyobj != NULL && weights_pyobj != Py_None);
+
+    NumpyVector<double> y, weights;
+    if (doy) {
+        y.init(y_pyobj);
+        if (y.size() != x.size()) {
+            throw "y must be the same size as x";
+        }
+    }
+    if (dow) {
+        weights.init(weights_pyobj);
+        if (weights.size() != x.size()) {
+            throw "weights must be the same size as x";
+        }
+    }
+
+    // check the reverse indices before releasing the GIL
+    if (rev.size() < 2) {
+        throw "reverse indices must have at least two elements";
+    }
+    const char* rev_data = (const char*) rev.void_ptr();
+    npy_intp rev_stride = rev.stride();
+    std::vector<npy_int64> rind(rev.size());
+    for (npy_intp i=0; i<rev.size(); i++) {
+        rind[i] = *(const npy_int64*) (rev_data + i*rev_stride);
+    }
+
+    npy_intp nbin = rind[0]-1;
+    if (nbin < 1 || nbin+1 > rev.size() || rind[nbin] != rev.size()) {
+        throw "reverse indices are inconsistent";
+    }
+    npy_intp maxcount = 0;
+    for (npy_intp b=0; b<nbin; b++) {
+        if (rind[b+1] < rind[b]) {
+            throw "reverse indices are inconsistent";
+        }
+        if (rind[b+1]-rind[b] > maxcount) {
+            maxcount = rind[b+1]-rind[b];
+        }
+    }
+    for (npy_intp i=nbin+1; i<rev.size(); i++) {
+        if (rind[i] < 0 || rind[i] >= x.size()) {
+            throw "reverse indices out of range for input data";
+        }
+    }
+
+    NumpyVector<double> xmean, xstd, xerr, xmedian;
+    NumpyVector<double> ymean, ystd, yerr, ymedian;
+    NumpyVector<double> whist, wxmean, wxstd, wxerr, wxerr2;
+    NumpyVector<double> wymean, wystd, wyerr, wyerr2;
+
+    BinStatsVar xvar, yvar;
+    xvar.data = (const char*) x.void_ptr();
+    xvar.stride = x.stride();
+    xvar.mean = new_stat_array(xmean, nbin, defval);
+    xvar.std = new_stat_array(xstd, nbin, defval);
+    xvar.err = new_stat_array(xerr, nbin, defval);
+    xvar.median = new_stat_array(xmedian, nbin, defval);
+    xvar.wmean = xvar.wstd = xvar.werr = xvar.werr2 = NULL;
+
+    if (doy) {
+        yvar.data = (const char*) y.void_ptr();
+        yvar.stride = y.stride();
+        yvar.mean = new_stat_array(ymean, nbin, defval);
+        yvar.std = new_stat_array(ystd, nbin, defval);
+        yvar.err = new_stat_array(yerr, nbin, defval);
+        yvar.median = new_stat_array(ymedian, nbin, defval);
+        yvar.wmean = yvar.wstd = yvar.werr = yvar.werr2 = NULL;
+    }
+
+    const char* wdata = NULL;
+    npy_intp wstride = 0;
+    double* whist_ptr = NULL;
+    if (dow) {
+        wdata = (const char*) weights.void_ptr();
+        wstride = weights.stride();
+        whist_ptr = new_stat_array(whist, nbin, 0.0);
+
+        xvar.wmean = new_stat_array(wxmean, nbin, defval);
+        xvar.wstd = new_stat_array(wxstd, nbin, defval);
+        xvar.werr = new_stat_array(wxerr, nbin, defval);
+        xvar.werr2 = new_stat_array(wxerr2, nbin, defval);
+        if (doy) {
+            yvar.wmean = new_stat_array(wymean, nbin, defval);
+            yvar.wstd = new_stat_array(wystd, nbin, defval);
+            yvar.werr = new_stat_array(wyerr, nbin, defval);
+            yvar.werr2 = new_stat_array(wyerr2, nbin, defval);
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+
+    // values of a bin are gathered here for the median
+    std::vector<double> buf(maxcount > 0 ? maxcount : 1);
+
+    for (npy_intp b=0; b<nbin; b++) {
+        npy_intp n = rind[b+1]-rind[b];
+        if (n == 0) {
+            continue;
+        }
+        const npy_int64* ind = &rind[ rind[b] ];
+
+        xvar.calc(b, ind, n, wdata, wstride, &buf[0]);
+        if (doy) {
+            yvar.calc(b, ind, n, wdata, wstride, &buf[0]);
+        }
+
+        if (dow) {
+            if (n == 1) {
+                // this matches the pure python calculation for a single object
+                whist_ptr[b] = xvar.mean[b]*(*(const double*) (wdata + ind[0]*wstride));
+            } else {
+                double wsum=0;
+                for (npy_intp i=0; i<n; i++) {
+                    wsum += *(const double*) (wdata + ind[i]*wstride);
+                }
+                whist_ptr[b] = wsum;
+            }
+        }
+    }
+
+    Py_END_ALLOW_THREADS
+
+    PyObject* dict = PyDict_New();
+    set_stat_item(dict, "xmean", xmean);
+    set_stat_item(dict, "xstd", xstd);
+    set_stat_item(dict, "xerr", xerr);
+    set_stat_item(dict, "xmedian", xmedian);
+    if (doy) {
+        set_stat_item(dict, "ymean", ymean);
+        set_stat_item(dict, "ystd", ystd);
+        set_stat_item(dict, "yerr", yerr);
+        set_stat_item(dict, "ymedian", ymedian);
+    }
+    if (dow) {
+        set_stat_item(dict, "whist", whist);
+        set_stat_item(dict, "wxmean", wxmean);
+        set_stat_item(dict, "wxstd", wxstd);
+        set_stat_item(dict, "wxerr", wxerr);
+        set_stat_item(dict, "wxerr2", wxerr2);
+        if (doy) {
+            set_stat_item(dict, "wymean", wymean);
+            set_stat_item(dict, "wystd", wystd);
+            set_stat_item(dict, "wyerr", wyerr);
+            set_stat_item(dict, "wyerr2", wyerr2);
+        }
+    }
+    return dict;
+}
+
+
+/*
+   N-dimensional histograms
+*/
+
+// bins in each dimension; cells are numbered in row-major order
+struct NDBinner {
+    std::vector<const char*> data;
+    std::vector<npy_intp> stride;
+    std::vector<double> min;
+    std::vector<double> max;
+    std::vector<double> binsize;
+    std::vector<npy_int64> nbin;
+
+    // the cell for object i, or -1 if outside the range in any dimension.
+    // Values equal to max go in the last bin
+    inline npy_int64 cell(npy_intp i) const {
+        npy_int64 cell=0;
+        for (size_t d=0; d<data.size(); d++) {
+            double val = *(const double*) (data[d] + i*stride[d]);
+            if (!(val >= min[d] && val <= max[d])) {
+                return -1;
+            }
+            npy_int64 binnum = (npy_int64) ( (val-min[d])/binsize[d] );
+            if (binnum >= nbin[d]) {
+                binnum = nbin[d]-1;
+            }
+            cell = cell*nbin[d] + binnum;
+        }
+        return cell;
+    }
+};
+
+/*
+   The counting and scatter passes work on contiguous chunks of the data,
+   with counts for all cells kept separately for each chunk.  The reduce
+   pass works on contiguous ranges of cells, using the reverse indices.
+*/
+struct NDJob {
+    enum Pass { COUNT, SCATTER, REDUCE };
+
+    Pass pass;
+    const NDBinner* binner;
+    npy_intp start;
+    npy_intp end;
+
+    std::vector<npy_int64> counts; // becomes the cursor for the scatter
+    npy_int64* rev;
+
+    // for the reductions
+    const char* wdata;
+    npy_intp wstride;
+    const char* zdata;
+    npy_intp zstride;
+    double* whist;
+    double* zmean;
+    double* zvar;
+
+    static void* run(void* arg) {
+        NDJob* job = (NDJob*) arg;
+        if (job->pass == REDUCE) {
+            job->reduce();
+            return NULL;
+        }
+
+        for (npy_intp i=job->start; i<job->end; i++) {
+            npy_int64 cell = job->binner->cell(i);
+            if (cell < 0) {
+                continue;
+            }
+            if (job->pass == SCATTER) {
+                job->rev[ job->counts[cell]++ ] = i;
+            } else {
+                job->counts[cell]++;
+            }
+        }
+        return NULL;
+    }
+
+    void reduce() {
+        for (npy_intp cell=start; cell<end; cell++) {
+            if (wdata != NULL) {
+                double wsum=0;
+                for (npy_int64 j=rev[cell]; j<rev[cell+1]; j++) {
+                    wsum += *(const double*) (wdata + rev[j]*wstride);
+                }
+                whist[cell] = wsum;
+            }
+            if (zdata != NULL) {
+                Welford acc;
+                for (npy_int64 j=rev[cell]; j<rev[cell+1]; j++) {
+                    acc.add(*(const double*) (zdata + rev[j]*zstride), 1.0);
+                }
+                if (acc.wsum > 0) {
+                    zmean[cell] = acc.mean;
+                    zvar[cell] = acc.m2/acc.wsum;
+                }
+            }
+        }
+    }
+};
+
+// get the i'th element of a sequence as a double or integer
+static double get_seq_double(PyObject* seq, npy_intp i) throw (const char *) {
+    PyObject* item = PySequence_GetItem(seq, i);
+    if (item == NULL) {
+        throw "could not get item from sequence";
+    }
+    NumpyVector<double> vec(item);
+    Py_DECREF(item);
+    return vec[0];
+}
+static npy_int64 get_seq_int64(PyObject* seq, npy_intp i) throw (const char *) {
+    PyObject* item = PySequence_GetItem(seq, i);
+    if (item == NULL) {
+        throw "could not get item from sequence";
+    }
+    NumpyVector<npy_int64> vec(item);
+    Py_DECREF(item);
+    return vec[0];
+}
+
+PyObject* chist_nd(
+        PyObject* data_pyobj,
+        PyObject* min_pyobj,
+        PyObject* max_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* nbin_pyobj,
+        PyObject* weights_pyobj,
+        PyObject* z_pyobj,
+        bool dorev,
+        long nthreads) throw (const char *) {
 
+    if (!PySequence_Check(data_pyobj)) {
+        throw "data must be a sequence of arrays";
+    }
+    npy_intp ndim = PySequence_Size(data_pyobj);
+    if (ndim < 1) {
+        throw "data must have at least one dimension";
+    }
+    if (PySequence_Size(min_pyobj) != ndim
+            || PySequence_Size(max_pyobj) != ndim
+            || PySequence_Size(binsize_pyobj) != ndim
+            || PySequence_Size(nbin_pyobj) != ndim) {
+        throw "min, max, binsize and nbin must have an entry for each dimension";
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    // keep references to the data, converted to double if needed
+    std::vector< NumpyVector<double> > data(ndim);
+    NDBinner binner;
+    npy_int64 ncell=1;
+    npy_intp ndata=0;
+    for (npy_intp d=0; d<ndim; d++) {
+        PyObject* item = PySequence_GetItem(data_pyobj, d);
+        if (item == NULL) {
+            throw "could not get item from sequence";
+        }
+        try {
+            data[d].init(item);
+        } catch (const char* err) {
+            Py_DECREF(item);
+            throw err;
+        }
+        Py_DECREF(item);
+
+        if (d == 0) {
+            ndata = data[d].size();
+        } else if (data[d].size() != ndata) {
+            throw "data must be the same size in each dimension";
+        }
+
+        binner.data.push_back( (const char*) data[d].void_ptr() );
+        binner.stride.push_back( data[d].stride() );
+        binner.min.push_back( get_seq_double(min_pyobj, d) );
+        binner.max.push_back( get_seq_double(max_pyobj, d) );
+        binner.binsize.push_back( get_seq_double(binsize_pyobj, d) );
+        binner.nbin.push_back( get_seq_int64(nbin_pyobj, d) );
+
+        if (!(binner.binsize[d] > 0)) {
+            throw "binsize must be > 0";
+        }
+        if (binner.nbin[d] < 1) {
+            throw "nbin must be >= 1";
+        }
+        if (binner.nbin[d] > std::numeric_limits<npy_intp>::max()/ncell) {
+            throw "too many cells";
+        }
+        ncell *= binner.nbin[d];
+    }
+
+    bool dow = (weights_pyobj != NULL && weights_pyobj != Py_None);
+    bool doz = (z_pyobj != NULL && z_pyobj != Py_None);
+    NumpyVector<double> weights, z;
+    if (dow) {
+        weights.init(weights_pyobj);
+        if (weights.size() != ndata) {
+            throw "weights must be the same size as the data";
+        }
+    }
+    if (doz) {
+        z.init(z_pyobj);
+        if (z.size() != ndata) {
+            throw "z must be the same size as the data";
+        }
+    }
+
+    // the reductions are done using the reverse indices
+    bool needrev = dorev || dow || doz;
+
+    if (nthreads > ndata) {
+        nthreads = ndata > 0 ? ndata : 1;
+    }
+
+    NumpyVector<npy_int64> hist(ncell);
+    npy_int64* hptr = hist.ptr();
+
+    std::vector<NDJob> jobs(nthreads);
+    npy_intp chunksize = ndata/nthreads;
+    for (long t=0; t<nthreads; t++) {
+        NDJob& job = jobs[t];
+        job.pass = NDJob::COUNT;
+        job.binner = &binner;
+        job.start = t*chunksize;
+        job.end = (t == nthreads-1) ? ndata : (t+1)*chunksize;
+        job.counts.assign(ncell, 0);
+        job.rev = NULL;
+        job.wdata = job.zdata = NULL;
+        job.wstride = job.zstride = 0;
+        job.whist = job.zmean = job.zvar = NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    npy_int64 ntot=0;
+    for (npy_int64 c=0; c<ncell; c++) {
+        for (long t=0; t<nthreads; t++) {
+            hptr[c] += jobs[t].counts[c];
+        }
+        ntot += hptr[c];
+    }
+
+    PyObject* dict = PyDict_New();
+    set_stat_item(dict, "hist", hist);
+
+    if (!needrev) {
+        return dict;
+    }
+
+    NumpyVector<npy_int64> rev(ncell + 1 + ntot);
+    npy_int64* rptr = rev.ptr();
+
+    rptr[0] = ncell+1;
+    for (npy_int64 c=0; c<ncell; c++) {
+        rptr[c+1] = rptr[c] + hptr[c];
+
+        npy_int64 offset = rptr[c];
+        for (long t=0; t<nthreads; t++) {
+            npy_int64 count = jobs[t].counts[c];
+            jobs[t].counts[c] = offset;
+            offset += count;
+        }
+    }
+
+    for (long t=0; t<nthreads; t++) {
+        jobs[t].pass = NDJob::SCATTER;
+        jobs[t].rev = rptr;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    if (dorev) {
+        set_stat_item(dict, "rev", rev);
+    }
+
+    if (dow || doz) {
+        NumpyVector<double> whist, zmean, zvar;
+        if (dow) {
+            whist.init(ncell);
+        }
+        if (doz) {
+            zmean.init(ncell);
+            zvar.init(ncell);
+        }
+
+        long nred = nthreads;
+        if (nred > ncell) {
+            nred = ncell;
+        }
+        jobs.resize(nred);
+        npy_intp cellchunk = ncell/nred;
+        for (long t=0; t<nred; t++) {
+            NDJob& job = jobs[t];
+            job.pass = NDJob::REDUCE;
+            job.start = t*cellchunk;
+            job.end = (t == nred-1) ? ncell : (t+1)*cellchunk;
+            std::vector<npy_int64>().swap(job.counts);
+            if (dow) {
+                job.wdata = (const char*) weights.void_ptr();
+                job.wstride = weights.stride();
+                job.whist = whist.ptr();
+            }
+            if (doz) {
+                job.zdata = (const char*) z.void_ptr();
+                job.zstride = z.stride();
+                job.zmean = zmean.ptr();
+                job.zvar = zvar.ptr();
+            }
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        run_jobs(jobs);
+        Py_END_ALLOW_THREADS
+
+        if (dow) {
+            set_stat_item(dict, "whist", whist);
+        }
+        if (doz) {
+            set_stat_item(dict, "zmean", zmean);
+            set_stat_item(dict, "zvar", zvar);
+        }
+    }
+
+    return dict;
+}
+
+
+/*
+   Equal number binning by selection.  The data in range are gathered as
+   value,index pairs.  The pairs are then partitioned at the bin edges with
+   nth_element, recursively, so that each bin is a contiguous block.  The
+   blocks are not sorted internally.
+*/
+
+template <class T>
+struct ValInd {
+    T val;
+    npy_int64 ind;
+    bool operator<(const ValInd& rhs) const {
+        return val < rhs.val;
+    }
+};
+
+/*
+   Place the elements with the ranks [rbeg,rend) in their sorted positions,
+   with no larger elements before and no smaller elements after.  The first
+   element has the given rank.  The depth of the recursion is log2 of the
+   number of ranks.
+*/
+template <class T>
+static void multi_select(ValInd<T>* first,
+                         ValInd<T>* last,
+                         npy_int64 rank,
+                         const npy_int64* rbeg,
+                         const npy_int64* rend) {
+    if (rbeg >= rend) {
+        return;
+    }
+    const npy_int64* rmid = rbeg + (rend-rbeg)/2;
+    ValInd<T>* nth = first + (*rmid - rank);
+
+    std::nth_element(first, nth, last);
+
+    multi_select(first, nth, rank, rbeg, rmid);
+    multi_select(nth+1, last, *rmid+1, rmid+1, rend);
+}
+
+/*
+   Gather the data in [datamin,datamax].  In the first pass the number in
+   range is counted for each chunk; in the second they are copied starting
+   at offset.
+*/
+template <class T>
+struct GatherJob {
+    const char* data;
+    npy_intp stride;
+    npy_intp start;
+    npy_intp end;
+    double datamin;
+    double datamax;
+
+    bool fill;
+    npy_intp count;
+    ValInd<T>* out; // already offset for this chunk
+
+    static void* run(void* arg) {
+        GatherJob* job = (GatherJob*) arg;
+        const char* p = job->data + job->start*job->stride;
+        npy_intp count=0;
+        for (npy_intp i=job->start; i<job->end; i++) {
+            T val = *(const T*) p;
+            p += job->stride;
+
+            double dval = (double) val;
+            if (!(dval >= job->datamin && dval <= job->datamax)) {
+                continue;
+            }
+            if (job->fill) {
+                job->out[count].val = val;
+                job->out[count].ind = i;
+            }
+            count++;
+        }
+        job->count = count;
+        return NULL;
+    }
+};
+
+/*
+   Select the edges for the bins [bin1,bin2), which are contiguous in the
+   pairs, and fill in the reverse indices and the low and high values.
+*/
+template <class T>
+struct SelectJob {
+    ValInd<T>* pairs;
+    npy_intp npairs;
+    npy_int64 nperbin;
+    npy_int64 bin1;
+    npy_int64 bin2;
+
+    const npy_int64* edges; // first rank in each bin
+    npy_int64* rev;
+    npy_int64 nbin;
+    double* low;
+    double* high;
+
+    static void* run(void* arg) {
+        SelectJob* job = (SelectJob*) arg;
+        npy_int64 nperbin = job->nperbin;
+
+        npy_int64 rank1 = job->bin1*nperbin;
+        npy_int64 rank2 = job->bin2*nperbin;
+        if (rank2 > job->npairs) {
+            rank2 = job->npairs;
+        }
+        ValInd<T>* first = job->pairs + rank1;
+        ValInd<T>* last = job->pairs + rank2;
+
+        // the first edge is already in place
+        multi_select(first, last, rank1,
+                     job->edges + job->bin1 + 1,
+                     job->edges + job->bin2);
+
+        for (npy_int64 b=job->bin1; b<job->bin2; b++) {
+            npy_int64 r1 = b*nperbin;
+            npy_int64 r2 = r1 + nperbin;
+            if (r2 > job->npairs) {
+                r2 = job->npairs;
+            }
+            T lowval = job->pairs[r1].val;
+            T highval = lowval;
+            for (npy_int64 r=r1; r<r2; r++) {
+                const ValInd<T>& vi = job->pairs[r];
+                if (vi.val < lowval) {
+                    lowval = vi.val;
+                }
+                if (vi.val > highval) {
+                    highval = vi.val;
+                }
+                job->rev[job->nbin + 1 + r] = vi.ind;
+            }
+            job->low[b] = (double) lowval;
+            job->high[b] = (double) highval;
+        }
+        return NULL;
+    }
+};
+
+template <class T>
+static PyObject* chist_nperbin_typed(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* nperbin_pyobj,
+        long nthreads) throw (const char *) {
+
+    NumpyVector<T> data(data_pyobj);
+    NumpyVector<double> datamin_array(datamin_pyobj);
+    NumpyVector<double> datamax_array(datamax_pyobj);
+    NumpyVector<npy_int64> nperbin_array(nperbin_pyobj);
+
+    npy_int64 nperbin = nperbin_array[0];
+    if (nperbin < 1) {
+        throw "nperbin must be >= 1";
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    npy_intp ndata = data.size();
+    long ngather = nthreads;
+    if (ngather > ndata) {
+        ngather = ndata > 0 ? ndata : 1;
+    }
+
+    std::vector< GatherJob<T> > gjobs(ngather);
+    npy_intp chunksize = ndata/ngather;
+    for (long t=0; t<ngather; t++) {
+        GatherJob<T>& job = gjobs[t];
+        job.data = (const char*) data.void_ptr();
+        job.stride = data.stride();
+        job.start = t*chunksize;
+        job.end = (t == ngather-1) ? ndata : (t+1)*chunksize;
+        job.datamin = datamin_array[0];
+        job.datamax = datamax_array[0];
+        job.fill = false;
+        job.count = 0;
+        job.out = NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(gjobs);
+    Py_END_ALLOW_THREADS
+
+    npy_intp npairs=0;
+    for (long t=0; t<ngather; t++) {
+        npairs += gjobs[t].count;
+    }
+    if (npairs == 0) {
+        throw "No data in specified min/max range";
+    }
+
+    std::vector< ValInd<T> > pairs(npairs);
+    npy_intp offset=0;
+    for (long t=0; t<ngather; t++) {
+        gjobs[t].fill = true;
+        gjobs[t].out = &pairs[offset];
+        offset += gjobs[t].count;
+    }
+
+    npy_int64 nbin = (npairs-1)/nperbin + 1;
+
+    NumpyVector<npy_int64> hist(nbin);
+    NumpyVector<npy_int64> rev(nbin + 1 + npairs);
+    NumpyVector<double> low(nbin);
+    NumpyVector<double> high(nbin);
+
+    npy_int64* hptr = hist.ptr();
+    npy_int64* rptr = rev.ptr();
+    std::vector<npy_int64> edges(nbin);
+    for (npy_int64 b=0; b<nbin; b++) {
+        edges[b] = b*nperbin;
+        hptr[b] = (b == nbin-1) ? npairs - edges[b] : nperbin;
+        rptr[b] = nbin + 1 + edges[b];
+    }
+    rptr[nbin] = nbin + 1 + npairs;
+
+    // Split the bins into groups for the threads.  The edges between groups
+    // are selected first, after which the groups are independent
+    long nselect = nthreads;
+    if (nselect > nbin) {
+        nselect = nbin;
+    }
+    std::vector< SelectJob<T> > sjobs(nselect);
+    std::vector<npy_int64> split_ranks;
+    for (long t=0; t<nselect; t++) {
+        SelectJob<T>& job = sjobs[t];
+        job.pairs = &pairs[0];
+        job.npairs = npairs;
+        job.nperbin = nperbin;
+        job.bin1 = (t*nbin)/nselect;
+        job.bin2 = ((t+1)*nbin)/nselect;
+        job.edges = &edges[0];
+        job.rev = rptr;
+        job.nbin = nbin;
+        job.low = low.ptr();
+        job.high = high.ptr();
+        if (t > 0) {
+            split_ranks.push_back(edges[job.bin1]);
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(gjobs);
+    if (!split_ranks.empty()) {
+        multi_select(&pairs[0], &pairs[0] + npairs, 0,
+                     &split_ranks[0], &split_ranks[0] + split_ranks.size());
+    }
+    run_jobs(sjobs);
+    Py_END_ALLOW_THREADS
+
+    PyObject* output_tuple = PyTuple_New(4);
+    PyTuple_SetItem(output_tuple, 0, hist.getref());
+    PyTuple_SetItem(output_tuple, 1, rev.getref());
+    PyTuple_SetItem(output_tuple, 2, low.getref());
+    PyTuple_SetItem(output_tuple, 3, high.getref());
+    return output_tuple;
+}
+
+struct ChistNperbinCall {
+    PyObject* data_pyobj;
+    PyObject* datamin_pyobj;
+    PyObject* datamax_pyobj;
+    PyObject* nperbin_pyobj;
+    long nthreads;
+
+    template <class T>
+    PyObject* call() const {
+        return chist_nperbin_typed<T>(data_pyobj, datamin_pyobj,
+                                      datamax_pyobj, nperbin_pyobj, nthreads);
+    }
+};
+
+PyObject* chist_nperbin(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* nperbin_pyobj,
+        long nthreads) throw (const char *) {
+
+    ChistNperbinCall func = {data_pyobj, datamin_pyobj, datamax_pyobj,
+                             nperbin_pyobj, nthreads};
+    return dispatch_type(data_pyobj, func);
+}
+
+
+/*
+   Accumulation of a histogram over chunks of data.  The state is kept in a
+   dict of arrays, which are updated in place
+*/
+
+// get a contiguous array of the given type and size from the state dict,
+// or NULL if it is not present
+static void* get_state_array(PyObject* state_pyobj,
+                             const char* name,
+                             int type_num,
+                             npy_intp size) throw (const char *) {
+
+    PyObject* arr = PyDict_GetItemString(state_pyobj, name);
+    if (arr == NULL) {
+        return NULL;
+    }
+    if (!PyArray_Check(arr)
+            || PyArray_TYPE(arr) != type_num
+            || PyArray_NDIM(arr) != 1
+            || !PyArray_ISCARRAY(arr)) {
+        throw "accumulator arrays must be contiguous, writeable, native 1-d arrays of the right type";
+    }
+    if (size >= 0 && PyArray_SIZE(arr) != size) {
+        throw "accumulator arrays must all be the same size";
+    }
+    return PyArray_DATA(arr);
+}
+
+template <class T>
+struct AccumJob {
+    const char* data;
+    npy_intp stride;
+    npy_intp ndata;
+    const BinCalc<T>* calc;
+
+    const char* wdata;
+    npy_intp wstride;
+    const char* ydata;
+    npy_intp ystride;
+
+    npy_int64* hist;
+    double* whist;
+    double* xmean;
+    double* xm2;
+    double* ymean;
+    double* ym2;
+
+    void run() {
+        for (npy_intp i=0; i<ndata; i++) {
+            T val = *(const T*) (data + i*stride);
+            npy_int64 binnum = (*calc)(val);
+            if (binnum < 0) {
+                continue;
+            }
+
+            npy_int64 n = ++hist[binnum];
+            if (whist != NULL) {
+                whist[binnum] += *(const double*) (wdata + i*wstride);
+            }
+            if (xmean != NULL) {
+                double x = (double) val;
+                double delta = x - xmean[binnum];
+                xmean[binnum] += delta/n;
+                xm2[binnum] += delta*(x - xmean[binnum]);
+            }
+            if (ymean != NULL) {
+                double y = *(const double*) (ydata + i*ystride);
+                double delta = y - ymean[binnum];
+                ymean[binnum] += delta/n;
+                ym2[binnum] += delta*(y - ymean[binnum]);
+            }
+        }
+    }
+};
+
+template <class T>
+static void chist_accumulate_typed(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* weights_pyobj,
+        PyObject* y_pyobj,
+        PyObject* state_pyobj) throw (const char *) {
+
+    if (!PyDict_Check(state_pyobj)) {
+        throw "accumulator state must be a dict";
+    }
+
+    NumpyVector<T> data(data_pyobj);
+
+    AccumJob<T> job;
+    job.hist = (npy_int64*) get_state_array(state_pyobj, "hist", NPY_INT64, -1);
+    if (job.hist == NULL) {
+        throw "accumulator state has no hist";
+    }
+    npy_intp nbin = PyArray_SIZE(PyDict_GetItemString(state_pyobj, "hist"));
+    if (nbin < 1) {
+        throw "nbin must be >= 1";
+    }
+
+    job.whist = (double*) get_state_array(state_pyobj, "whist", NPY_DOUBLE, nbin);
+    job.xmean = (double*) get_state_array(state_pyobj, "xmean", NPY_DOUBLE, nbin);
+    job.xm2 = (double*) get_state_array(state_pyobj, "xm2", NPY_DOUBLE, nbin);
+    job.ymean = (double*) get_state_array(state_pyobj, "ymean", NPY_DOUBLE, nbin);
+    job.ym2 = (double*) get_state_array(state_pyobj, "ym2", NPY_DOUBLE, nbin);
+
+    if ( (job.xmean == NULL) != (job.xm2 == NULL)
+            || (job.ymean == NULL) != (job.ym2 == NULL) ) {
+        throw "accumulator state must have both the mean and m2";
+    }
+
+    bool dow = (weights_pyobj != NULL && weights_pyobj != Py_None);
+    bool doy = (y_pyobj != NULL && y_pyobj != Py_None);
+    if (dow != (job.whist != NULL)) {
+        throw "weights must be sent if and only if the accumulator has whist";
+    }
+    if (doy != (job.ymean != NULL)) {
+        throw "y must be sent if and only if the accumulator has ymean";
+    }
+
+    NumpyVector<double> weights, y;
+    job.wdata = job.ydata = NULL;
+    job.wstride = job.ystride = 0;
+    if (dow) {
+        weights.init(weights_pyobj);
+        if (weights.size() != data.size()) {
+            throw "weights must be the same size as the data";
+        }
+        job.wdata = (const char*) weights.void_ptr();
+        job.wstride = weights.stride();
+    }
+    if (doy) {
+        y.init(y_pyobj);
+        if (y.size() != data.size()) {
+            throw "y must be the same size as the data";
+        }
+        job.ydata = (const char*) y.void_ptr();
+        job.ystride = y.stride();
+    }
+
+    BinCalc<T> calc(datamin_pyobj, datamax_pyobj, binsize_pyobj, nbin);
+
+    job.data = (const char*) data.void_ptr();
+    job.stride = data.stride();
+    job.ndata = data.size();
+    job.calc = &calc;
+
+    Py_BEGIN_ALLOW_THREADS
+    job.run();
+    Py_END_ALLOW_THREADS
+}
+
+// the state is updated in place, so there is nothing to return
+struct ChistAccumulateCall {
+    PyObject* data_pyobj;
+    PyObject* datamin_pyobj;
+    PyObject* datamax_pyobj;
+    PyObject* binsize_pyobj;
+    PyObject* weights_pyobj;
+    PyObject* y_pyobj;
+    PyObject* state_pyobj;
+
+    template <class T>
+    PyObject* call() const {
+        chist_accumulate_typed<T>(data_pyobj, datamin_pyobj, datamax_pyobj,
+                                  binsize_pyobj, weights_pyobj, y_pyobj,
+                                  state_pyobj);
+        return NULL;
+    }
+};
+
+PyObject* chist_accumulate(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* weights_pyobj,
+        PyObject* y_pyobj,
+        PyObject* state_pyobj) throw (const char *) {
+
+    ChistAccumulateCall func = {data_pyobj, datamin_pyobj, datamax_pyobj,
+                                binsize_pyobj, weights_pyobj, y_pyobj,
+                                state_pyobj};
+    dispatch_type(data_pyobj, func);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+/*
+   Linear interpolation on a monotone grid.  For each query point the
+   interval is the last grid point below u, limited to [0,n-2] so points
+   outside the grid are extrapolated from the end intervals.  This is the
+   same interval and formula as the python interplin, so the results are
+   identical.
+*/
+
+struct InterpJob {
+    const double* x;
+    npy_intp nx;
+    bool uniform;
+    double x0;
+    double inv_dx;
+
+    const char* v;
+    npy_intp v_stride;
+    npy_intp ntab;
+
+    const char* u;
+    npy_intp u_stride;
+    npy_intp nu;
+    npy_intp start;
+    npy_intp end;
+
+    double* out;
+
+    inline double uval(npy_intp j) const {
+        return *(const double*) (u + j*u_stride);
+    }
+    inline double vval(npy_intp tab, npy_intp i) const {
+        return *(const double*) (v + (tab*nx + i)*v_stride);
+    }
+
+    // the interval from a binary search
+    inline npy_intp search(double uj) const {
+        npy_intp i = (std::lower_bound(x, x+nx, uj) - x) - 1;
+        if (i < 0) {
+            i = 0;
+        } else if (i > nx-2) {
+            i = nx-2;
+        }
+        return i;
+    }
+
+    // the interval from a guess, by walking to the right one
+    inline npy_intp walk(double uj, npy_intp i) const {
+        while (i > 0 && x[i] >= uj) {
+            i--;
+        }
+        while (i < nx-2 && x[i+1] < uj) {
+            i++;
+        }
+        return i;
+    }
+
+    inline npy_intp guess(double uj) const {
+        double g = (uj - x0)*inv_dx;
+        if (!(g >= 0)) {
+            return 0;
+        } else if (g > nx-2) {
+            return nx-2;
+        }
+        return (npy_intp) g;
+    }
+
+    static void* run(void* arg) {
+        InterpJob* job = (InterpJob*) arg;
+        job->interpolate();
+        return NULL;
+    }
+
+    void interpolate() {
+        if (start >= end) {
+            return;
+        }
+
+        // for sorted query points sweep along the grid, merge style
+        bool sorted = true;
+        for (npy_intp j=start+1; j<end; j++) {
+            if (!(uval(j) >= uval(j-1))) {
+                sorted = false;
+                break;
+            }
+        }
+
+        npy_intp i = 0;
+        if (sorted && !uniform) {
+            i = search(uval(start));
+        }
+        for (npy_intp j=start; j<end; j++) {
+            double uj = uval(j);
+            if (uniform) {
+                i = walk(uj, guess(uj));
+            } else if (sorted) {
+                i = walk(uj, i);
+            } else {
+                i = search(uj);
+            }
+
+            double du = uj - x[i];
+            double dx = x[i+1] - x[i];
+            for (npy_intp tab=0; tab<ntab; tab++) {
+                double v0 = vval(tab, i);
+                double v1 = vval(tab, i+1);
+                out[tab*nu + j] = du*(v1 - v0)/dx + v0;
+            }
+        }
+    }
+};
+
+PyObject* chist_interplin(
+        PyObject* v_pyobj,
+        PyObject* x_pyobj,
+        PyObject* u_pyobj,
+        long nthreads) throw (const char *) {
+
+    NumpyVector<double> xvec(x_pyobj);
+    NumpyVector<double> v(v_pyobj);
+    NumpyVector<double> u(u_pyobj);
+
+    npy_intp nx = xvec.size();
+    if (nx < 2) {
+        throw "x must have at least two elements";
+    }
+    if (v.size() == 0 || v.size() % nx != 0) {
+        throw "v must have a multiple of the size of x";
+    }
+
+    std::vector<double> x(nx);
+    const char* xdata = (const char*) xvec.void_ptr();
+    for (npy_intp i=0; i<nx; i++) {
+        x[i] = *(const double*) (xdata + i*xvec.stride());
+        if (i > 0 && !(x[i] >= x[i-1])) {
+            throw "x must be non-decreasing";
+        }
+    }
+
+    // With a nearly uniform grid the interval is computed directly and then
+    // corrected, rather than searched for
+    double x0 = x[0];
+    double dx = (x[nx-1] - x0)/(nx-1);
+    bool uniform = (dx > 0);
+    for (npy_intp i=1; uniform && i<nx; i++) {
+        if (std::fabs(x[i] - (x0 + i*dx)) > 1.e-8*dx) {
+            uniform = false;
+        }
+    }
+
+    npy_intp ntab = v.size()/nx;
+    npy_intp nu = u.size();
+    NumpyVector<double> out(ntab*nu);
+
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > nu) {
+        nthreads = nu > 0 ? nu : 1;
+    }
+
+    std::vector<InterpJob> jobs(nthreads);
+    npy_intp chunksize = nu/nthreads;
+    for (long t=0; t<nthreads; t++) {
+        InterpJob& job = jobs[t];
+        job.x = &x[0];
+        job.nx = nx;
+        job.uniform = uniform;
+        job.x0 = x0;
+        job.inv_dx = uniform ? 1.0/dx : 0.0;
+        job.v = (const char*) v.void_ptr();
+        job.v_stride = v.stride();
+        job.ntab = ntab;
+        job.u = (const char*) u.void_ptr();
+        job.u_stride = u.stride();
+        job.nu = nu;
+        job.start = t*chunksize;
+        job.end = (t == nthreads-1) ? nu : (t+1)*chunksize;
+        job.out = out.ptr();
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    run_jobs(jobs);
+    Py_END_ALLOW_THREADS
+
+    return out.getref();
+}
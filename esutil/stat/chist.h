@@ -11,4 +11,83 @@ PyObject* chist(
         PyObject* nbin_pyobj,
         bool dorev) throw (const char *);
 
+// Histogram without sorting.  The reverse indices are built with a counting
+// sort in two linear passes, and are in index order within each bin.  Data
+// outside of [datamin,datamax] are ignored.  The work is split over nthreads
+// threads; the result does not depend on the number of threads.
+PyObject* chist_counting(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* nbin_pyobj,
+        bool dorev,
+        long nthreads) throw (const char *);
+
+// Statistics of the data in each bin, using the reverse indices from chist
+// or chist_counting.  Returns a dict of arrays with the mean, std, err and
+// median of x and optionally y, and the weighted moments if weights are sent.
+// y and weights may be None.  Empty bins are set to -9999.
+PyObject* chist_bin_stats(
+        PyObject* x_pyobj,
+        PyObject* y_pyobj,
+        PyObject* weights_pyobj,
+        PyObject* rev_pyobj) throw (const char *);
+
+// N-dimensional histogram.  data is a sequence of arrays, one for each
+// dimension, and min, max, binsize and nbin are sequences with an entry for
+// each dimension.  Cells are numbered in row-major order.  Returns a dict
+// with the flattened 'hist', 'rev' if dorev is true, 'whist' if weights are
+// sent, and the per-cell 'zmean' and 'zvar' of the extra column z if sent.
+// weights and z may be None.  The work is split over nthreads threads.
+PyObject* chist_nd(
+        PyObject* data_pyobj,
+        PyObject* min_pyobj,
+        PyObject* max_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* nbin_pyobj,
+        PyObject* weights_pyobj,
+        PyObject* z_pyobj,
+        bool dorev,
+        long nthreads) throw (const char *);
+
+// Bins with nperbin objects each, except the last, for data in
+// [datamin,datamax].  The bin edges are found by selection rather than a
+// full sort, so the indices in each bin of the reverse indices are not
+// sorted.  Returns a tuple (hist, rev, low, high) where low and high are the
+// smallest and largest value in each bin.
+PyObject* chist_nperbin(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* nperbin_pyobj,
+        long nthreads) throw (const char *);
+
+// Add a chunk of data to an accumulated histogram.  The state is a dict of
+// arrays updated in place: 'hist' (int64), 'whist' if weights are sent, and
+// the running per-bin mean and sum of squared deviations 'xmean','xm2' of
+// the data and 'ymean','ym2' of y if present.  y and weights may be None.
+// The binning is the same as chist_counting, so the accumulated histogram
+// matches that of all the data at once.
+PyObject* chist_accumulate(
+        PyObject* data_pyobj,
+        PyObject* datamin_pyobj,
+        PyObject* datamax_pyobj,
+        PyObject* binsize_pyobj,
+        PyObject* weights_pyobj,
+        PyObject* y_pyobj,
+        PyObject* state_pyobj) throw (const char *);
+
+// Linear interpolation of v(x) to the points u, extrapolating outside the
+// grid from the end intervals.  x must be non-decreasing.  v may hold
+// several tables on the same grid, concatenated, in which case the result
+// holds the interpolation of each table in turn.  Sorted u are found by a
+// sweep along the grid, and a uniform grid is indexed directly; otherwise a
+// binary search is used.  The work is split over nthreads threads.
+PyObject* chist_interplin(
+        PyObject* v_pyobj,
+        PyObject* x_pyobj,
+        PyObject* u_pyobj,
+        long nthreads) throw (const char *);
+
 #endif
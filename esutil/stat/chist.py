@@ -71,4 +71,28 @@ def chist(*args):
   return _chist.chist(*args)
 chist = _chist.chist
 
+def chist_counting(*args):
+  return _chist.chist_counting(*args)
+chist_counting = _chist.chist_counting
+
+def chist_bin_stats(*args):
+  return _chist.chist_bin_stats(*args)
+chist_bin_stats = _chist.chist_bin_stats
+
+def chist_nd(*args):
+  return _chist.chist_nd(*args)
+chist_nd = _chist.chist_nd
+
+def chist_nperbin(*args):
+  return _chist.chist_nperbin(*args)
+chist_nperbin = _chist.chist_nperbin
+
+def chist_accumulate(*args):
+  return _chist.chist_accumulate(*args)
+chist_accumulate = _chist.chist_accumulate
+
+def chist_interplin(*args):
+  return _chist.chist_interplin(*args)
+chist_interplin = _chist.chist_interplin
+
 
@@ -36,6 +36,445 @@ def test():
 
 
 
+def test_counting():
+    """
+    Compare the counting sort histogram to the sorted version.  The
+    reverse indices should contain the same indices in each bin.
+    """
+    print 'Testing histogram with sort=False'
+
+    data = numpy.random.random(10000)
+    binsize=0.013
+    for nthreads in [1,3]:
+        h1,r1 = esutil.stat.histogram(data, binsize=binsize, rev=True)
+        h2,r2 = esutil.stat.histogram(data, binsize=binsize, rev=True,
+                                      sort=False, nthreads=nthreads)
+
+        nbad=0
+        if (h1 != h2).any() or (r1[0:h1.size+1] != r2[0:h2.size+1]).any():
+            nbad += 1
+        else:
+            for i in xrange(h1.size):
+                w1 = numpy.sort(r1[ r1[i]:r1[i+1] ])
+                w2 = r2[ r2[i]:r2[i+1] ]
+                if (w1 != w2).any():
+                    nbad += 1
+
+        if nbad != 0:
+            print '%s Errors found for nthreads=%s' % (nbad,nthreads)
+        else:
+            print 'OK'
+
+
+def test_big_integers():
+    """
+    Exact binning of int64 data whose range is wider than the largest int64,
+    e.g. a negative minimum with values near 2**63
+    """
+    print 'Testing histogram of int64 spanning more than 2**63'
+
+    dmin = -2**62
+    dmax = 9000000000000000000
+    bsize = 2**59
+    data = numpy.array([dmin, -1, 0, 2**62, 2**62+1, 
+                        8999999999999999999, dmax], dtype='i8')
+    nbin = (dmax-dmin)//bsize + 1
+    expected = numpy.zeros(nbin, dtype='i8')
+    for v in data:
+        expected[ (long(v)-dmin)//bsize ] += 1
+
+    s = data.argsort()
+    h1 = chist.chist(data, numpy.int64(dmin), s, numpy.int64(bsize), 
+                     numpy.int64(nbin), False)
+    h2 = chist.chist_counting(data, numpy.int64(dmin), numpy.int64(dmax),
+                              numpy.int64(bsize), numpy.int64(nbin), False, 2)
+
+    nbad=0
+    if (h1 != expected).any():
+        print '    sorted histogram mismatch'
+        nbad += 1
+    if (h2 != expected).any():
+        print '    counting histogram mismatch'
+        nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_bin_stats():
+    """
+    Compare the statistics from the C++ code to the python version
+    """
+    print 'Testing Binner.calc_stats'
+
+    x = numpy.random.random(10000)
+    y = x + numpy.random.normal(size=x.size)
+    w = numpy.random.random(x.size)
+
+    b1 = esutil.stat.Binner(x, y, weights=w)
+    b1.dohist(binsize=0.01)
+    b1.calc_stats()
+
+    b2 = esutil.stat.Binner(x, y, weights=w)
+    b2.dohist(binsize=0.01)
+    esutil.stat.util.have_chist=False
+    try:
+        b2.calc_stats()
+    finally:
+        esutil.stat.util.have_chist=True
+
+    nbad=0
+    for key in b2:
+        if not numpy.allclose(b1[key], b2[key], rtol=1.e-10, atol=1.e-12):
+            print '    mismatch for',key
+            nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_histogram2d():
+    """
+    Compare the 2d histogram from the C++ code to the python version
+    """
+    print 'Testing histogram2d'
+
+    x = numpy.random.random(10000)
+    y = numpy.random.random(x.size)
+    z = x + y
+
+    keys=dict(nx=13, ny=17, xmin=0.0, xmax=1.0, ymin=0.0, ymax=1.0)
+    r1 = esutil.stat.histogram2d(x, y, z=z, nthreads=2, **keys)
+    esutil.stat.util.have_chist=False
+    try:
+        r2 = esutil.stat.histogram2d(x, y, z=z, **keys)
+    finally:
+        esutil.stat.util.have_chist=True
+
+    nbad=0
+    if (r1['hist'] != r2['hist']).any():
+        print '    hist mismatch'
+        nbad += 1
+    if not numpy.allclose(r1['zmean'], r2['zmean'], rtol=1.e-12):
+        print '    zmean mismatch'
+        nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_nperbin_select():
+    """
+    Compare the nperbin histogram using selection to the sorted version.
+    """
+    print 'Testing nperbin with sort=False'
+
+    data = numpy.random.random(10000)
+    nperbin=137
+    nbad=0
+    for nthreads in [1,3]:
+        b1 = esutil.stat.Binner(data)
+        b1.dohist(nperbin=nperbin)
+        b2 = esutil.stat.Binner(data)
+        b2.dohist(nperbin=nperbin, sort=False, nthreads=nthreads)
+
+        for key in ['hist','low','high']:
+            if (b1[key] != b2[key]).any():
+                print '    mismatch for',key
+                nbad += 1
+
+        r1,r2=b1['rev'],b2['rev']
+        for i in xrange(b1['hist'].size):
+            w1 = numpy.sort(r1[ r1[i]:r1[i+1] ])
+            w2 = numpy.sort(r2[ r2[i]:r2[i+1] ])
+            if (w1 != w2).any():
+                nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_accumulator():
+    """
+    Compare a histogram accumulated in chunks to one of all the data
+    """
+    print 'Testing HistAccumulator'
+
+    data = numpy.random.random(10000)
+    weights = numpy.random.random(data.size)
+    binsize=0.013
+
+    res = esutil.stat.histogram(data, weights=weights, binsize=binsize,
+                                min=0.0, max=1.0, sort=False)
+
+    acc1 = esutil.stat.HistAccumulator(0.0, 1.0, binsize=binsize,
+                                       weights=True, moments=True)
+    acc2 = esutil.stat.HistAccumulator(0.0, 1.0, binsize=binsize,
+                                       weights=True, moments=True)
+    for i in xrange(0, data.size, 999):
+        acc = acc1 if i < data.size/2 else acc2
+        acc.add(data[i:i+999], weights=weights[i:i+999])
+    acc1.merge(acc2)
+    acc1.calc_stats()
+
+    nbad=0
+    if (acc1['hist'] != res['hist']).any():
+        print '    hist mismatch'
+        nbad += 1
+    if not numpy.allclose(acc1['whist'], res['whist'], rtol=1.e-12):
+        print '    whist mismatch'
+        nbad += 1
+    if not numpy.allclose(acc1['xstd'], res['std'], rtol=1.e-8):
+        print '    std mismatch'
+        nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_sigma_clip_batch():
+    """
+    Compare batched sigma clipping to clipping each group separately
+    """
+    print 'Testing sigma_clip_batch'
+
+    ngroup=100
+    sizes = numpy.random.randint(1, 50, ngroup)
+    offsets = numpy.zeros(ngroup+1, dtype='i8')
+    offsets[1:] = sizes.cumsum()
+    data = numpy.random.normal(size=offsets[-1])
+    data[::7] += 10.0
+
+    mean,sdev,err,nuse = esutil.stat.sigma_clip_batch(data, offsets, nsig=3.0)
+
+    nbad=0
+    for i in xrange(ngroup):
+        extra={}
+        m,s,e = esutil.stat.sigma_clip(data[offsets[i]:offsets[i+1]],
+                                       nsig=3.0, get_err=True, extra=extra,
+                                       silent=True)
+        if (abs(m-mean[i]) > 1.e-12 or abs(s-sdev[i]) > 1.e-12
+                or extra['indices'].size != nuse[i]):
+            nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_wmom_batch():
+    """
+    Compare batched weighted moments and medians to wmom for each bin of
+    a histogram
+    """
+    print 'Testing wmom_batch and wmedian_batch'
+
+    x = numpy.random.random(10000)
+    y = x + numpy.random.normal(size=x.size)
+    w = numpy.random.random(x.size)
+
+    h,rev = esutil.stat.histogram(x, binsize=0.01, rev=True)
+    offsets = rev[0:h.size+1]
+
+    wmean,werr,wsdev = esutil.stat.wmom_batch(y, w, offsets, index=rev,
+                                              calcerr=True, sdev=True)
+    wmed = esutil.stat.wmedian_batch(y, w, offsets, index=rev)
+
+    nbad=0
+    for i in xrange(h.size):
+        if h[i] == 0:
+            continue
+        ind = rev[ rev[i]:rev[i+1] ]
+        m,e,s = esutil.stat.wmom(y[ind], w[ind], calcerr=True, sdev=True)
+        if (abs(m-wmean[i]) > 1.e-12 or abs(e-werr[i]) > 1.e-12
+                or abs(s-wsdev[i]) > 1.e-12):
+            nbad += 1
+
+        # reference median from a full sort
+        s = y[ind].argsort()
+        wsum = w[ind][s][::-1].cumsum()[::-1]
+        k, = where(wsum - w[ind][s] <= 0.5*wsum[0])
+        if y[ind][s[k[0]]] != wmed[i]:
+            nbad += 1
+
+    # 64-bit integers are not exact as doubles, the median must still be
+    # one of the elements
+    big = numpy.array([2**60+1, 2**60+3, 2**60+5], dtype='i8')
+    wbig = numpy.ones(big.size)
+    if esutil.stat.wmedian(big, wbig) != big[1]:
+        nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_interplin():
+    """
+    Compare interplin from the C++ code to the python version
+    """
+    print 'Testing interplin'
+
+    nbad=0
+    for x in [numpy.linspace(0.0, 1.0, 101),
+              numpy.sort(numpy.random.random(100))]:
+        v = numpy.random.random((3, x.size))
+        u = numpy.random.uniform(-0.1, 1.1, 10000)
+        for uu in [u, numpy.sort(u)]:
+            res = esutil.stat.interplin(v, x, uu, nthreads=2)
+            for i in xrange(v.shape[0]):
+                pres = esutil.stat.util._interplin_python(v[i], x, uu)
+                if not numpy.allclose(res[i], pres, rtol=1.e-15, atol=0.0):
+                    nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+
+def test_random_sample():
+    """
+    Check the indices from random_sample are unique, sorted, in range and
+    reproducible
+    """
+    print 'Testing random_sample'
+
+    nbad=0
+    for nmax,nrand in [(10,10),(1000,900),(1000,20),(10**10,1000)]:
+        r1 = esutil.stat._stat_util.random_sample(nmax, nrand, 35)
+        r2 = esutil.stat._stat_util.random_sample(nmax, nrand, 35)
+        r3 = esutil.stat._stat_util.random_sample(nmax, nrand, 35, 1)
+        if (r1.size != nrand or (r1 != r2).any()
+                or r1[0] < 0 or r1[-1] >= nmax
+                or (r1[1:] <= r1[:-1]).any()):
+            nbad += 1
+        if nrand < nmax and (r1 == r3).all():
+            nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+def test_samplers():
+    """
+    Check the guide table lookup agrees with interplin, the samples do not
+    depend on the number of threads, and the alias table sampler gives the
+    mean of a linear p(x)
+    """
+    print 'Testing samplers'
+
+    su = esutil.stat._stat_util
+    nbad=0
+
+    x = numpy.linspace(-2.0, 3.0, 37)
+    pcum = numpy.cumsum(numpy.exp(-0.5*x**2))
+    pcum /= pcum[-1]
+    guide = su.guide_table(pcum, pcum.size)
+
+    r1 = su.sample_invcdf(x, pcum, guide, 10000, 35, 0, 1)
+    r4 = su.sample_invcdf(x, pcum, guide, 10000, 35, 0, 4)
+    if (r1 != r4).any():
+        nbad += 1
+
+    # the same uniform randoms go through the inverse of interplin, so
+    # mapping back with interplin must recover values in [0,1)
+    u = esutil.stat.interplin(pcum, x, r1)
+    if (u < pcum[0]-1.e-12).any() or (u >= 1.0).any():
+        nbad += 1
+
+    # p(x) = x on [0,1], mean 2/3
+    x = numpy.array([0.0, 0.25, 1.0])
+    p = x.copy()
+    areas = 0.5*(p[1:]+p[:-1])*(x[1:]-x[:-1])
+    prob, alias = su.alias_table(areas)
+    r = su.sample_pwlinear(x, p, prob, alias, 200000, 35, 0, 3)
+    if (r < 0).any() or (r > 1).any() or abs(r.mean() - 2./3.) > 0.003:
+        nbad += 1
+
+    # segments with zero area are never chosen
+    x = numpy.linspace(0.0, 10.0, 101)
+    p = 1.0 + numpy.sin(x)**2
+    p[31:60] = 0.0
+    areas = 0.5*(p[1:]+p[:-1])*(x[1:]-x[:-1])
+    prob, alias = su.alias_table(areas)
+    w, = where(areas == 0)
+    if (prob[w] != 0).any() or (areas[alias[w]] == 0).any():
+        nbad += 1
+    r = su.sample_pwlinear(x, p, prob, alias, 200000, 35, 0, 3)
+    if (not numpy.isfinite(r).all()
+            or ((r > x[31]+1.e-12) & (r < x[59]-1.e-12)).any()):
+        nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
+def test_mvn_sample():
+    """
+    Check cholesky_batch against numpy, and that mvn_sample gives the mean
+    and covariance and does not depend on the number of threads
+    """
+    print 'Testing mvn_sample'
+
+    su = esutil.stat._stat_util
+    nbad=0
+
+    cov = numpy.zeros( (2,3,3) )
+    cov[0] = [[1.0,0.1,0.1],[0.1,2.0,0.1],[0.1,0.1,3.0]]
+    cov[1] = [[4.0,-1.0,0.5],[-1.0,1.0,0.2],[0.5,0.2,0.5]]
+    mean = numpy.array([[5.0,4.0,8.0],[-1.0,0.0,1.0]])
+
+    L = su.cholesky_batch(cov)
+    for m in xrange(2):
+        if numpy.abs(L[m] - numpy.linalg.cholesky(cov[m])).max() > 1.e-12:
+            nbad += 1
+
+    n=100000
+    out1 = numpy.zeros( (2,n,3) )
+    out4 = numpy.zeros( (2,n,3) )
+    su.mvn_sample(L, mean, out1, 35, 0, 1)
+    su.mvn_sample(L, mean, out4, 35, 0, 4)
+    if (out1 != out4).any():
+        nbad += 1
+
+    for m in xrange(2):
+        mdiff = numpy.abs(out1[m].mean(axis=0) - mean[m]).max()
+        cdiff = numpy.abs(numpy.cov(out1[m].T) - cov[m]).max()
+        if mdiff > 0.03 or cdiff > 0.05:
+            nbad += 1
+
+    if nbad != 0:
+        print '%s Errors found' % nbad
+    else:
+        print 'OK'
+
 
 if __name__=='__main__':
     test()
+    test_counting()
+    test_big_integers()
+    test_bin_stats()
+    test_histogram2d()
+    test_nperbin_select()
+    test_accumulator()
+    test_sigma_clip_batch()
+    test_wmom_batch()
+    test_interplin()
+    test_random_sample()
+    test_samplers()
+    test_mvn_sample()
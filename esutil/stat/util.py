@@ -8,6 +8,8 @@ classes
 -------
 Binner: 
     A class for binning data.
+HistAccumulator:
+    Accumulate a histogram over chunks of data, with fixed binning.
 
 functions
 -------
@@ -22,8 +24,14 @@ wmom:
     Calculate weighted mean and error for the given input data.
 wmedian:
     Calculate the weighted median.
+wmom_batch:
+    Weighted mean and error for many groups of data in a single call.
+wmedian_batch:
+    Weighted median for many groups of data in a single call.
 sigma_clip:  
     Return the sigma-clipped mean and error for the input data.
+sigma_clip_batch:
+    Sigma clip many groups of data in a single call.
 interplin:  
     Perform linear interpolation.  This function is less powerful than
     scipy.interpolate.interp1d but behaves like the IDL interpol()
@@ -138,10 +146,21 @@ class Binner(dict):
 
 
 
-    def dohist(self, binsize=None, nbin=None, nperbin=None, min=None, max=None, rev=False, mergelast=True):
+    def dohist(self, binsize=None, nbin=None, nperbin=None, min=None, max=None, rev=False, mergelast=True,
+               sort=True, nthreads=1):
         """
         Perform the basic histogram, optionally getting reverse indices. Note
         if weights were sent, reverse indices will always be calculated
+
+        If sort=False and binsize or nbin are sent, the data are not sorted.
+        The reverse indices are instead built with a counting sort in O(n),
+        using nthreads threads, and are in index order within each bin rather
+        than sorted by value.
+
+        If sort=False and nperbin is sent, the bin edges are found by
+        selection in O(n log(nbin)) rather than a full sort, using nthreads
+        threads.  The indices within each bin of the reverse indices are then
+        not sorted by value.
         """
 
         # this method inherited from dict
@@ -151,17 +170,25 @@ class Binner(dict):
         if self.y is not None:
             rev=True
 
-        # get self['wsort'] and self.dmin, self.dmax
-        self._get_minmax_and_indices(min=min, max=max)
-
         if nperbin is not None:
-            self._hist_by_num(nperbin, mergelast=mergelast)
+            if sort or not have_chist:
+                # get self['wsort'] and self.dmin, self.dmax
+                self._get_minmax_and_indices(min=min, max=max)
+                self._hist_by_num(nperbin, mergelast=mergelast)
+            else:
+                self._get_minmax(min=min, max=max)
+                self._hist_by_num_select(nperbin, mergelast=mergelast,
+                                         nthreads=nthreads)
         elif nbin is not None or binsize is not None:
-            self._hist_by_binsize_or_nbin(binsize, nbin, rev)
+            if sort or not have_chist:
+                self._get_minmax_and_indices(min=min, max=max)
+            else:
+                self._get_minmax(min=min, max=max)
+            self._hist_by_binsize_or_nbin(binsize, nbin, rev, nthreads=nthreads)
         else:
             raise ValueError("Send binsize or nbin or nperbin")
 
-    def _hist_by_binsize_or_nbin(self, binsize, nbin, rev):
+    def _hist_by_binsize_or_nbin(self, binsize, nbin, rev, nthreads=1):
 
         if binsize is not None:
             nbin = numpy.int64( (self.dmax-self.dmin)/binsize ) + 1
@@ -172,7 +199,10 @@ class Binner(dict):
         self['binsize'] = binsize
         self['nbin'] = nbin
 
-        h,r = self._do_hist(self.x, self.dmin, self['wsort'], binsize, nbin, rev=rev)
+        if 'wsort' in self:
+            h,r = self._do_hist(self.x, self.dmin, self['wsort'], binsize, nbin, rev=rev)
+        else:
+            h,r = self._do_hist_counting(binsize, nbin, rev=rev, nthreads=nthreads)
 
         self['hist'] = h
         if r is not None:
@@ -213,6 +243,22 @@ class Binner(dict):
         if hist[-1] != nperbin and mergelast:
             self._merge_last()
 
+    def _hist_by_num_select(self, nperbin, mergelast=True, nthreads=1):
+        """
+        Bins with nperbin objects, with the edges found by selection in
+        the C++ code rather than a sort
+        """
+        hist, rev, low, high = chist.chist_nperbin(self.x, self.dmin, self.dmax,
+                                                   nperbin, nthreads)
+        self['hist'] = hist
+        self['rev'] = rev
+        self['low'] = low
+        self['high'] = high
+        self['nperbin'] = nperbin
+
+        if hist[-1] != nperbin and mergelast:
+            self._merge_last()
+
     def _merge_last(self):
         rev=self['rev']
 
@@ -267,6 +313,48 @@ class Binner(dict):
         return hist, revind
 
 
+    def _do_hist_counting(self, bsize, nbin, rev=False, nthreads=1):
+        """
+        Histogram without a sort, using the counting sort in chist
+        """
+        dorev = rev
+        if self.weights is not None:
+            # force rev so we can add up in bins with weights
+            dorev=True
+
+        if dorev:
+            hist, revind = chist.chist_counting(self.x, self.dmin, self.dmax,
+                                                bsize, nbin, dorev, nthreads)
+        else:
+            hist         = chist.chist_counting(self.x, self.dmin, self.dmax,
+                                                bsize, nbin, dorev, nthreads)
+            revind=None
+
+        if hist.sum() == 0:
+            raise ValueError("No data in specified min/max range: [%s,%s]" % (self.dmin,self.dmax))
+
+        return hist, revind
+
+    def _get_minmax(self, min=None, max=None):
+        """
+        Get min/max without sorting
+        """
+        if min is not None:
+            xmin = min
+        else:
+            xmin = self.x.min()
+
+        if max is not None:
+            xmax = max
+        else:
+            xmax = self.x.max()
+
+        self.dmin = xmin
+        self.dmax = xmax
+
+        self[self.xpref+'min'] = xmin
+        self[self.xpref+'max'] = xmax
+
     def _get_sort_index(self):
         if self.sort_index is None:
             self.sort_index = self.x.argsort()
@@ -336,7 +424,9 @@ class Binner(dict):
             self[xpref+'center'] = center
 
 
-        if 'rev' in self:
+        if 'rev' in self and have_chist:
+            self._calc_stats_c()
+        elif 'rev' in self:
             revind = self['rev']
             # calculate the mean in the bins
             xmean   = numpy.zeros(nhist) - 9999.0
@@ -444,12 +534,213 @@ class Binner(dict):
                     self['wyerr']  = wyerr
                     self['wyerr2'] = wyerr2
 
+    def _calc_stats_c(self):
+        """
+        Calculate the statistics in all bins in a single call to the C++ code
+        """
+        stats = chist.chist_bin_stats(self.x, self.y, self.weights, self['rev'])
+
+        xpref=self.xpref
+        for name in ['mean','std','err','median']:
+            self[xpref+name] = stats['x'+name]
+            if self.y is not None:
+                self['y'+name] = stats['y'+name]
+
+        if self.weights is not None:
+            self['whist'] = stats['whist']
+            for name in ['mean','std','err','err2']:
+                self['w'+xpref+name] = stats['wx'+name]
+                if self.y is not None:
+                    self['wy'+name] = stats['wy'+name]
+
+
+
+class HistAccumulator(dict):
+    """
+    Accumulate a histogram over chunks of data, for data that do not fit in
+    memory.  The binning is fixed at construction, and only O(nbin) memory
+    is used.  The result for all chunks matches that from histogram() of all
+    the data at once with sort=False and the same min, max and binsize.
+
+    acc = HistAccumulator(min, max, binsize=None, nbin=None,
+                          weights=False, moments=False, y=False)
+
+    Parameters
+    ----------
+    min, max: scalars
+        The range of the data to histogram.
+    binsize, nbin: optional
+        Send one of these.  If binsize is sent nbin is determined from the
+        range as in histogram().
+    weights: bool, optional
+        If True, weights must be sent to add() and the weighted histogram
+        is accumulated in 'whist'.
+    moments: bool, optional
+        If True accumulate the mean and variance of the data in each bin.
+    y: bool, optional
+        If True, a y value must be sent to add() for each object, and the
+        mean and variance of y are accumulated in each bin.
+
+    Examples
+    --------
+        acc = HistAccumulator(0.0, 1.0, binsize=0.01, moments=True)
+        for chunk in chunks:
+            acc.add(chunk['x'])
+        acc.calc_stats()
+        acc['hist'], acc['xmean'], acc['xstd'], acc['xerr']
+
+        # combine accumulators from several workers
+        acc1.merge(acc2)
+
+    The running state is kept in the 'hist', 'whist', 'xmean', 'xm2',
+    'ymean' and 'ym2' arrays.  The arrays are updated in place and should
+    not be modified.
+    """
+    def __init__(self, min, max, binsize=None, nbin=None,
+                 weights=False, moments=False, y=False):
+
+        if min > max:
+            raise ValueError("min must be <= max")
+        if binsize is not None:
+            nbin = numpy.int64( (max-min)/binsize ) + 1
+        elif nbin is not None:
+            binsize = float(max-min)/nbin
+        else:
+            raise ValueError("Send binsize or nbin")
+
+        self['min'] = min
+        self['max'] = max
+        self['binsize'] = binsize
+        self['nbin'] = nbin
+
+        self['hist'] = numpy.zeros(nbin, dtype='i8')
+        if weights:
+            self['whist'] = numpy.zeros(nbin, dtype='f8')
+        if moments:
+            self['xmean'] = numpy.zeros(nbin, dtype='f8')
+            self['xm2'] = numpy.zeros(nbin, dtype='f8')
+        if y:
+            self['ymean'] = numpy.zeros(nbin, dtype='f8')
+            self['ym2'] = numpy.zeros(nbin, dtype='f8')
+
+        low = self['min'] + self['binsize']*numpy.arange(nbin, dtype='f8')
+        self['low'] = low
+        self['high'] = low + self['binsize']
+        self['center'] = low + 0.5*self['binsize']
+
+    def add(self, x, weights=None, y=None):
+        """
+        Add a chunk of data to the histogram.
+        """
+        x = numpy.array(x, ndmin=1, copy=False)
+        if weights is not None:
+            weights = numpy.array(weights, ndmin=1, dtype='f8', copy=False)
+        if y is not None:
+            y = numpy.array(y, ndmin=1, dtype='f8', copy=False)
+
+        if ('whist' in self) != (weights is not None):
+            raise ValueError("weights must be sent if and only if the "
+                             "accumulator was created with weights=True")
+        if ('ymean' in self) != (y is not None):
+            raise ValueError("y must be sent if and only if the "
+                             "accumulator was created with y=True")
+
+        if have_chist:
+            chist.chist_accumulate(x, self['min'], self['max'],
+                                   self['binsize'], weights, y, self)
+        else:
+            self._add_python(x, weights, y)
+
+    def _add_python(self, x, weights, y):
+        """
+        Add a chunk by combining with the statistics of the chunk
+        """
+        w, = numpy.where( (x >= self['min']) & (x <= self['max']) )
+        if w.size == 0:
+            return
+        binnum = ( (x[w]-self['min'])/self['binsize'] ).astype('i8')
+        keep, = numpy.where(binnum < self['nbin'])
+        w = w[keep]
+        binnum = binnum[keep]
+
+        nbin = self['nbin']
+        h = numpy.bincount(binnum, minlength=nbin)
+        other = {'hist':h}
+        if weights is not None:
+            other['whist'] = numpy.bincount(binnum, weights=weights[w],
+                                            minlength=nbin)
+        for pref,data in [('x',x),('y',y)]:
+            if pref+'mean' not in self:
+                continue
+            vals = numpy.array(data[w], dtype='f8')
+            hsafe = h.clip(1, None)
+            mean = numpy.bincount(binnum, weights=vals, minlength=nbin)/hsafe
+            diff = vals-mean[binnum]
+            m2 = numpy.bincount(binnum, weights=diff*diff, minlength=nbin)
+            other[pref+'mean'] = mean
+            other[pref+'m2'] = m2
+
+        self._combine(other)
+
+    def merge(self, other):
+        """
+        Merge in the histogram accumulated by another HistAccumulator with
+        the same binning, for example from another worker.
+        """
+        for key in ['min','max','binsize','nbin']:
+            if self[key] != other[key]:
+                raise ValueError("cannot merge: %s differs" % key)
+        for key in ['whist','xmean','ymean']:
+            if (key in self) != (key in other):
+                raise ValueError("cannot merge: %s is not in both" % key)
+        self._combine(other)
+
+    def _combine(self, other):
+        """
+        Combine the counts and moments, the latter following Chan et al.
+        """
+        na = self['hist']
+        nb = other['hist']
+        n = na + nb
+        nsafe = n.clip(1, None)
+
+        for pref in ['x','y']:
+            if pref+'mean' not in self:
+                continue
+            mean = self[pref+'mean']
+            m2 = self[pref+'m2']
+            delta = other[pref+'mean'] - mean
+            m2 += other[pref+'m2'] + delta*delta*na*nb/nsafe
+            mean += delta*nb/nsafe
+
+        if 'whist' in self:
+            self['whist'] += other['whist']
+        na += nb
+
+    def calc_stats(self):
+        """
+        Calculate the standard deviation 'xstd' and error on the mean 'xerr'
+        in each bin from the accumulated moments, and similarly for y.
+        These are -9999 in empty bins.
+        """
+        h = self['hist']
+        w, = numpy.where(h > 0)
+        for pref in ['x','y']:
+            if pref+'mean' not in self:
+                continue
+            std = numpy.zeros(h.size) - 9999.0
+            err = std.copy()
+            std[w] = numpy.sqrt( self[pref+'m2'][w]/h[w] )
+            err[w] = std[w]/numpy.sqrt(h[w])
+            self[pref+'std'] = std
+            self[pref+'err'] = err
+
 
 
 def histogram(data, weights=None, binsize=1., nbin=None, 
               nperbin=None, mergelast=True,
               min=None, max=None, 
-              rev=False, more=False, **keys):
+              rev=False, more=False, sort=True, nthreads=1, **keys):
     """
     Calculate the histogram of the input data.  
     
@@ -489,6 +780,15 @@ def histogram(data, weights=None, binsize=1., nbin=None,
         Where rev is the reverse indices.   Default is false.  Note if weights
         are sent, or more=True, the result is always a dictionary.  See below.
 
+    sort: boolean, optional
+        If False, do not sort the data.  The reverse indices are then built
+        with a counting sort in O(n) time, and within each bin are in index
+        order rather than sorted by value.  For nperbin the bin edges are
+        found by selection in O(n log(nbin)) time, and the indices within
+        each bin are not sorted.  Default True.
+    nthreads: integer, optional
+        Number of threads to use when sort=False.  Default 1.
+
     more:
 
         If more is True, or weights are sent, then return more statistics, with
@@ -537,7 +837,7 @@ def histogram(data, weights=None, binsize=1., nbin=None,
 
     b = Binner(data, weights=weights)
     b.dohist(binsize=binsize, nbin=nbin, nperbin=nperbin, mergelast=mergelast,
-             min=min, max=max, rev=rev)
+             min=min, max=max, rev=rev, sort=sort, nthreads=nthreads)
 
     if more or weights is not None:
         b.calc_stats()
@@ -662,7 +962,8 @@ def histogram2d(x, y,
                 ymin=None, 
                 ymax=None, 
                 rev=False,
-                more=False):
+                more=False,
+                nthreads=1):
     """
     Name:
         histogram2d
@@ -680,14 +981,16 @@ def histogram2d(x, y,
                     ymin=None, 
                     ymax=None, 
                     rev=False,
-                    more=False)
+                    more=False,
+                    nthreads=1)
 
     Inputs:
         x,y:  The x and y values for the data.  Must be same length.
 
     Keywords:
         z: optional z third dimension.
-            If sent 'zmean' is in the output dictionary
+            If sent 'zmean' is in the output dictionary, and 'zvar' if the
+            C++ code is available.
 
         nx: Number of bins in the x direction.
         ny: Number of bins in the y direction.
@@ -705,6 +1008,14 @@ def histogram2d(x, y,
 
             If z is sent, more is implied. 
 
+        nthreads: Number of threads to use in the C++ code.  Default 1.
+
+    Notes:
+        When the C++ code is available the histogram, reverse indices and
+        z statistics are calculated in a single call, and the reverse
+        indices are into the input arrays.  Values equal to the max go in
+        the last bin.
+
     """
 
     x = numpy.array(x, ndmin=1, copy=False)
@@ -737,10 +1048,6 @@ def histogram2d(x, y,
     if ymax is None:
         ymax=y.max()
 
-    w, = numpy.where( (x >= xmin) & (x <= xmax) & (y >= ymin) & (y <= ymax) )
-    if w.size == 0:
-        raise ValueError("No data in specified min/max range\n")
-
     if dobinsizes:
         # determine nx,ny from binsizes
         nx = numpy.int64(  (xmax-xmin)/float(xbin) ) + 1
@@ -749,23 +1056,26 @@ def histogram2d(x, y,
         xbin = (xmax-xmin)/float(nx)
         ybin = (ymax-ymin)/float(ny)
 
-    xind=numpy.floor((x[w]-xmin)*(float(nx)/(xmax-xmin)))
-    yind=numpy.floor((y[w]-ymin)*(float(ny)/(ymax-ymin)))
-
-    #ind=xind+nx*yind
-    # fixed so that row,col is the indexing
-    ind=yind+ny*xind
+    if have_chist:
+        res = chist.chist_nd([x,y], [xmin,ymin], [xmax,ymax], [xbin,ybin],
+                             [nx,ny], weights, z, rev, nthreads)
+        hist = res['hist']
+        if hist.sum() == 0:
+            raise ValueError("No data in specified min/max range\n")
 
-    if weights is not None:
-        more=True
-        res = histogram(ind, min=0, max=nx*ny-1, weights=weights[w])
-        hist=res['hist']
-        whist=res['whist'].reshape(nx,ny)
-        revind=res['rev']
-    elif rev:
-        hist, revind = histogram(ind, min=0, max=nx*ny-1, rev=True)
+        if weights is not None:
+            more=True
+            whist=res['whist'].reshape(nx,ny)
+        if rev:
+            revind=res['rev']
     else:
-        hist = histogram(ind, min=0, max=nx*ny-1)
+        hist, whist, revind, w = _histogram2d_python(x, y, weights,
+                                                     nx, ny,
+                                                     xmin, xmax,
+                                                     ymin, ymax,
+                                                     rev)
+        if weights is not None:
+            more=True
 
     hist = hist.reshape(nx,ny)
 
@@ -819,15 +1129,49 @@ def histogram2d(x, y,
             output['rev'] = revind
 
         if z is not None:
-            zmean=numpy.zeros(nx*ny)
-            for i in xrange(hist.size):
-                if revind[i] != revind[i+1]:
-                    wbin=revind[ revind[i]:revind[i+1] ]
-                    zmean[i] = z[w[wbin]].mean()
-
-            output['zmean'] = zmean.reshape(nx,ny)
+            if have_chist:
+                output['zmean'] = res['zmean'].reshape(nx,ny)
+                output['zvar'] = res['zvar'].reshape(nx,ny)
+            else:
+                zmean=numpy.zeros(nx*ny)
+                for i in xrange(hist.size):
+                    if revind[i] != revind[i+1]:
+                        wbin=revind[ revind[i]:revind[i+1] ]
+                        zmean[i] = z[w[wbin]].mean()
+                output['zmean'] = zmean.reshape(nx,ny)
         return output
 
+def _histogram2d_python(x, y, weights, nx, ny, xmin, xmax, ymin, ymax, rev):
+    """
+    The 2d histogram as a 1d histogram of the flattened index, for when the
+    C++ code is not available.  Also returns the indices of the data in
+    the range, which the reverse indices refer to.
+    """
+    w, = numpy.where( (x >= xmin) & (x <= xmax) & (y >= ymin) & (y <= ymax) )
+    if w.size == 0:
+        raise ValueError("No data in specified min/max range\n")
+
+    xind=numpy.floor((x[w]-xmin)*(float(nx)/(xmax-xmin)))
+    yind=numpy.floor((y[w]-ymin)*(float(ny)/(ymax-ymin)))
+
+    #ind=xind+nx*yind
+    # fixed so that row,col is the indexing
+    ind=yind+ny*xind
+
+    whist=None
+    revind=None
+    if weights is not None:
+        res = histogram(ind, min=0, max=nx*ny-1, weights=weights[w])
+        hist=res['hist']
+        whist=res['whist'].reshape(nx,ny)
+        revind=res['rev']
+    elif rev:
+        hist, revind = histogram(ind, min=0, max=nx*ny-1, rev=True)
+    else:
+        hist = histogram(ind, min=0, max=nx*ny-1)
+
+    return hist, whist, revind, w
+
 def boxcar_average(x, N):
     """
     convolve the data with a boxcar window of the specified length
@@ -920,11 +1264,41 @@ def wmedian(arr_in, weights_in):
     # no copy made if they are already arrays
     arr = numpy.array(arr_in, ndmin=1, copy=False)
 
-    sind=arr.argsort()
+    # the C selection works in double precision; for other types, e.g.
+    # 64-bit integers, sort so the element itself is returned
+    if not _f8_exact(arr.dtype):
+        return _wmedian_sort(arr, weights_in)
+
+    # the median is found by weighted selection in C, no sort needed
+    xarr = numpy.ascontiguousarray(arr, dtype='f8')
+    weights = numpy.ascontiguousarray(weights_in, dtype='f8').ravel()
+    if weights.size != xarr.size:
+        raise ValueError("array and weights must be same size")
+
+    offsets = numpy.array([0, xarr.size], dtype='i8')
+    wmed = _stat_util.wmedian(xarr.ravel(), weights, offsets, None)
+
+    return arr.dtype.type(wmed[0])
+
+def _f8_exact(dtype):
+    """
+    True if every value of the type is exactly representable as float64
+    """
+    if dtype.kind == 'f':
+        return dtype.itemsize <= 8
+    if dtype.kind in ('i','u','b'):
+        return dtype.itemsize <= 4
+    return False
+
+def _wmedian_sort(arr, weights_in):
+    sind=arr.argsort(axis=None)
+    arr = arr.ravel()
     
     # Weights is forced to be type double. All resulting calculations
     # will also be double
-    weights = numpy.array(weights_in, ndmin=1, dtype='f8', copy=False)
+    weights = numpy.array(weights_in, ndmin=1, dtype='f8', copy=False).ravel()
+    if weights.size != arr.size:
+        raise ValueError("array and weights must be same size")
 
     wtot = weights.sum()
     wtot2 = wtot/2.
@@ -938,6 +1312,89 @@ def wmedian(arr_in, weights_in):
 
     return arr[sind[k]]
 
+def _get_group_args(arr, weights, offsets, index):
+    arr = numpy.ascontiguousarray(arr, dtype='f8').ravel()
+    weights = numpy.ascontiguousarray(weights, dtype='f8').ravel()
+    offsets = numpy.ascontiguousarray(offsets, dtype='i8').ravel()
+    if index is not None:
+        index = numpy.ascontiguousarray(index, dtype='i8').ravel()
+    if weights.size != arr.size:
+        raise ValueError("array and weights must be same size")
+    return arr, weights, offsets, index
+
+def wmom_batch(arr, weights, offsets, index=None, calcerr=False, sdev=False):
+    """
+    Weighted mean and error for many groups of data in a single call.
+
+    The groups are given by CSR offsets, with group i being
+    arr[offsets[i]:offsets[i+1]], or if index is sent
+    arr[index[offsets[i]:offsets[i+1]]].  For example, to get the weighted
+    mean in the bins of a histogram using the reverse indices
+
+        h,rev = histogram(x, binsize=0.1, rev=True)
+        wmean,werr = wmom_batch(y, weights, rev[0:h.size+1], index=rev)
+
+    The moments are calculated in a single pass over the data.
+
+    parameters
+    ----------
+    arr: array or sequence
+        A numpy array or sequence
+    weights: array or sequence
+        The weight for each element of arr
+    offsets: array or sequence
+        The offsets of the groups, with ngroup+1 elements.
+    index: array or sequence, optional
+        Indices into arr for the elements of the groups.
+    calcerr: bool, optional
+        Calculate the error from the weighted scatter, as in wmom
+    sdev: bool, optional
+        If True also return the weighted standard deviation
+
+    returns
+    -------
+    wmean,werr: arrays with one element per group.  If sdev=True returns
+    wmean,werr,wsdev.  Empty groups have NaN stats.
+    """
+    arr, weights, offsets, index = \
+            _get_group_args(arr, weights, offsets, index)
+
+    wmean,werr,werr2,wsdev = _stat_util.wmom(arr, weights, offsets, index)
+    if calcerr:
+        werr = werr2
+
+    if sdev:
+        return wmean, werr, wsdev
+    else:
+        return wmean, werr
+
+def wmedian_batch(arr, weights, offsets, index=None):
+    """
+    Weighted median for many groups of data in a single call.
+
+    The groups are given by CSR offsets and an optional index as in
+    wmom_batch.  The medians are found by weighted selection rather than
+    sorting each group.
+
+    parameters
+    ----------
+    arr: array or sequence
+        A numpy array or sequence
+    weights: array or sequence
+        The weight for each element of arr
+    offsets: array or sequence
+        The offsets of the groups, with ngroup+1 elements.
+    index: array or sequence, optional
+        Indices into arr for the elements of the groups.
+
+    returns
+    -------
+    An array with the weighted median of each group, NaN for empty groups.
+    """
+    arr, weights, offsets, index = \
+            _get_group_args(arr, weights, offsets, index)
+    return _stat_util.wmedian(arr, weights, offsets, index)
+
 
 def sigma_clip(arrin, weights=None, niter=4, nsig=4, get_err=False, get_indices=False, extra={}, 
                verbose=False, silent=False):
@@ -979,6 +1436,11 @@ def sigma_clip(arrin, weights=None, niter=4, nsig=4, get_err=False, get_indices=
         weights = numpy.array(weights, ndmin=1, copy=False)
         assert weights.size==arr.size,"array and weights must be same size"
 
+    if not verbose:
+        # the iterations are done in C
+        return _sigma_clip_c(arr, weights, niter, nsig, get_err, get_indices,
+                             extra, silent)
+
     indices = numpy.arange( arr.size )
     nold = arr.size
 
@@ -1020,6 +1482,84 @@ def sigma_clip(arrin, weights=None, niter=4, nsig=4, get_err=False, get_indices=
 
     return res 
 
+def _sigma_clip_c(arr, weights, niter, nsig, get_err, get_indices, extra,
+                  silent):
+    xarr = numpy.ascontiguousarray(arr, dtype='f8')
+    if weights is not None:
+        weights = numpy.ascontiguousarray(weights, dtype='f8')
+
+    mean,err,sdev,nuse,allclipped,mask = \
+            _stat_util.sigma_clip(xarr, weights, None, float(nsig), int(niter))
+
+    if allclipped[0] != 0 and not silent:
+        stderr.write("nsig too small. Everything clipped on "
+                     "iteration %d\n" % allclipped[0])
+
+    res=[mean[0], sdev[0]]
+    if get_err:
+        res.append(err[0])
+
+    indices, = numpy.where(mask)
+    if get_indices:
+        res.append(indices)
+
+    extra['indices'] = indices
+
+    return res
+
+def sigma_clip_batch(arr, offsets, weights=None, niter=4, nsig=4,
+                     get_mask=False):
+    """
+    Sigma clip many groups of data in a single call.
+
+    The groups are contiguous slices of the data, with group i being
+    arr[offsets[i]:offsets[i+1]] as for a CSR matrix.  Each group is
+    clipped as in sigma_clip().  For example, to clip the data in the bins
+    of a histogram using the reverse indices
+
+        h,rev = histogram(x, binsize=0.1, rev=True)
+        nbin = h.size
+        mean,sdev,err,nuse = sigma_clip_batch(y[rev[nbin+1:]],
+                                              rev[0:nbin+1]-(nbin+1))
+
+    parameters
+    ----------
+    arr: array or sequence
+        A numpy array or sequence
+    offsets: array or sequence
+        The offsets of the groups into the data, with ngroup+1 elements.
+    weights: array or sequence, optional
+        If sent, the weighted mean, err and stdev are used as in wmom with
+        calcerr=True.
+    niter: int, optional
+        number of iterations, defaults to 4
+    nsig: float, optional
+        number of sigma, defaults to 4
+    get_mask: bool, optional
+        If True, also return a boolean array, the same size as arr, that is
+        True for the data used in the final stats of each group.
+
+    returns
+    -------
+    mean,stdev,err,nuse: arrays with one element per group, where nuse is
+    the number used for the final stats.  Empty groups have NaN stats.  If
+    get_mask=True returns mean,stdev,err,nuse,mask
+    """
+
+    arr = numpy.ascontiguousarray(arr, dtype='f8')
+    offsets = numpy.ascontiguousarray(offsets, dtype='i8')
+    if weights is not None:
+        weights = numpy.ascontiguousarray(weights, dtype='f8')
+
+    mean,err,sdev,nuse,allclipped,mask = \
+            _stat_util.sigma_clip(arr, weights, offsets,
+                                  float(nsig), int(niter))
+
+    if get_mask:
+        return mean, sdev, err, nuse, mask.astype('bool')
+    else:
+        return mean, sdev, err, nuse
+
 def _get_sigma_clip_stats(arr, indices, weights=None):
     if weights is not None:
         m,e,s=wmom(arr[indices], weights[indices], calcerr=True, sdev=True)
@@ -1034,7 +1574,7 @@ def _print_sigma_clip_stats(iter, nuse, mean, stdev):
     mess='iter: %d  nuse: %d mean: %10.3g stdev: %10.3g'
     print mess % (iter, nuse, mean, stdev)
 
-def interplin(vin, xin, uin):
+def interplin(vin, xin, uin, nthreads=1):
     """
     NAME:
       interplin()
@@ -1047,12 +1587,22 @@ def interplin(vin, xin, uin):
       which makes it compatible with the IDL interpol() function.
 
     CALLING SEQUENCE:
-      yint = interplin(y, x, u)
+      yint = interplin(y, x, u, nthreads=1)
 
     INPUTS:
-      y, x:  The y and x values of the data.
+      y, x:  The y and x values of the data.  x must be increasing.  y may
+          also be a 2-d array of shape (ntab, x.size) holding several
+          tables on the same grid, in which case the result has shape
+          (ntab, u.size).
       u: The x-values to which will be interpolated.
 
+    OPTIONAL INPUTS:
+      nthreads: The number of threads to use for the C++ code.
+
+    The interpolation is done in C++ when available.  Sorted u are located
+    by a single sweep along the grid, a uniform grid is indexed directly,
+    and otherwise a binary search is used.
+
     REVISION HISTORY:
       Created: 2006-10-24, Erin Sheldon, NYU
     """
@@ -1061,6 +1611,28 @@ def interplin(vin, xin, uin):
     x=numpy.array(xin, ndmin=1, copy=False)
     u=numpy.array(uin, ndmin=1, copy=False)
 
+    batch = (v.ndim == 2)
+    if batch and v.shape[1] != x.size:
+        raise ValueError("tables must have shape (ntab, %d), "
+                         "got %s" % (x.size, v.shape))
+
+    if (have_chist and x.size > 1
+            and not numpy.iscomplexobj(v) and not numpy.iscomplexobj(u)):
+        res = chist.chist_interplin(numpy.ascontiguousarray(v, dtype='f8').ravel(),
+                                    numpy.ascontiguousarray(x, dtype='f8').ravel(),
+                                    numpy.ascontiguousarray(u, dtype='f8').ravel(),
+                                    int(nthreads))
+        if batch:
+            return res.reshape(v.shape[0], u.size)
+        else:
+            return res.reshape(u.shape)
+
+    if batch:
+        return numpy.array([_interplin_python(vi, x, u) for vi in v])
+    return _interplin_python(v, x, u)
+
+def _interplin_python(v, x, u):
+
     # Find closest indices
     xm = x.searchsorted(u) - 1
     
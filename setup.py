@@ -62,6 +62,7 @@ if have_numpy:
     recfile_module = Extension('esutil.recfile._records', 
                                extra_compile_args=extra_compile_args, 
                                extra_link_args=extra_link_args,
+                               libraries=['pthread'],
                                sources=recfile_sources)
     ext_modules.append(recfile_module)
     packages.append('esutil.recfile')
@@ -71,6 +72,7 @@ if have_numpy:
     cosmo_module = Extension('esutil.cosmology._cosmolib', 
                              extra_compile_args=extra_compile_args, 
                              extra_link_args=extra_link_args,
+                             libraries=['pthread'],
                              sources=cosmo_sources)
     ext_modules.append(cosmo_module)
     packages.append('esutil.cosmology')
@@ -84,6 +86,7 @@ if have_numpy:
     htm_module = Extension('esutil.htm._htmc',
                            extra_compile_args=extra_compile_args, 
                            extra_link_args=extra_link_args,
+                           libraries=['pthread'],
                            sources=htm_sources)
 
     ext_modules.append(htm_module)
@@ -99,6 +102,7 @@ if have_numpy:
     chist_module = Extension('esutil.stat._chist', 
                              extra_compile_args=extra_compile_args, 
                              extra_link_args=extra_link_args,
+                             libraries=['pthread'],
                              sources=chist_sources)
     ext_modules.append(chist_module)
     stat_util_sources = ['_stat_util.c']
@@ -106,6 +110,7 @@ if have_numpy:
     stat_util_module = Extension('esutil.stat._stat_util', 
                                  extra_compile_args=extra_compile_args, 
                                  extra_link_args=extra_link_args,
+                                 libraries=['pthread'],
                                  sources=stat_util_sources)
     ext_modules.append(stat_util_module)
     packages.append('esutil.stat')
@@ -117,6 +122,7 @@ if have_numpy:
     cgauleg_module = Extension('esutil.integrate._cgauleg', 
                                extra_compile_args=extra_compile_args, 
                                extra_link_args=extra_link_args,
+                               libraries=['pthread'],
                                sources=cgauleg_sources)
     ext_modules.append(cgauleg_module)
     packages.append('esutil.integrate')